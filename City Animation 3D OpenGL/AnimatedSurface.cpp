@@ -0,0 +1,193 @@
+#include "AnimatedSurface.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// vertices along the side of a patch and in its slot
+const int SIDE = (1 << AnimatedSurface::LEVEL) + 1;
+const int SLOT_VERTICES = SIDE * SIDE;
+const int VERTEX_SIZE = BezierSurface<3, float>::VERTEX_SIZE;
+const size_t SLOT_SIZE = SLOT_VERTICES * VERTEX_SIZE * sizeof(float);
+
+// weight of the latest update in the averaged tessellation time per patch
+const double TIMING_SMOOTHING = 0.1;
+
+AnimatedSurface::AnimatedSurface(int patchesPerSide, float patchSize, const glm::vec3& origin, const std::function<float(float, float, float)>& height,
+    float amplitude, double budgetMilliseconds)
+    : patchesPerSide(patchesPerSide), patchSize(patchSize), origin(origin), height(height), patches(patchesPerSide * patchesPerSide),
+    budgetMilliseconds(budgetMilliseconds), patchMilliseconds(0.0), updatesCount(0), streamedCount(0),
+    stream(patches.size() * SLOT_SIZE)
+{
+    float side = patchesPerSide * patchSize;
+    std::vector<glm::vec3> corners;
+    for (int k = 0; k < 8; k++)
+        corners.push_back(origin + glm::vec3((k & 1) ? side : 0.0f, (k & 2) ? amplitude : -amplitude, (k & 4) ? side : 0.0f));
+    bounds = BoundingSphere::FromPoints(corners);
+
+    // every slot is drawn with the same grid, the vertices written here are thrown away
+    std::vector<float> gridVertices(SLOT_VERTICES * VERTEX_SIZE);
+    std::vector<unsigned int> indices(BezierSurface<3, float>::GetGridIndexCount(1 << LEVEL));
+    patches[0].surface.FillGrid(gridVertices.data(), indices.data(), 1 << LEVEL);
+    indicesCount = (unsigned int)indices.size();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+
+    // only written by copies from the stream buffer, every frame
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, patches.size() * SLOT_SIZE, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+AnimatedSurface::~AnimatedSurface()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void AnimatedSurface::Update(float time, JobSystem& jobs)
+{
+    PROFILE_SCOPE("Animated surface update");
+
+    updatesCount++;
+    streamedCount = 0;
+
+    // control heights at the new time; neighbours sample their shared edge at the same points
+    pendingPatches.clear();
+    for (int pz = 0; pz < patchesPerSide; pz++)
+    {
+        for (int px = 0; px < patchesPerSide; px++)
+        {
+            int index = pz * patchesPerSide + px;
+            Patch& patch = patches[index];
+
+            // a patch keeps its vertices while its heights stay exactly the same, any tolerance would
+            // let it lag behind a neighbour that was streamed and open a seam between them
+            float control[16];
+            bool isMoved = !patch.isStreamed;
+            for (int k = 0; k < 4; k++)
+            {
+                for (int l = 0; l < 4; l++)
+                {
+                    control[k * 4 + l] = height(origin.x + (px + k / 3.0f) * patchSize, origin.z + (pz + l / 3.0f) * patchSize, time);
+                    isMoved |= control[k * 4 + l] != patch.streamedControl[k * 4 + l];
+                }
+            }
+            patch.surface.SetBaseZValues(control);
+
+            if (!isMoved)
+            {
+                patch.pendingSince = 0;
+                continue;
+            }
+            if (patch.pendingSince == 0)
+                patch.pendingSince = updatesCount;
+            pendingPatches.push_back(index);
+        }
+    }
+    if (pendingPatches.empty())
+        return;
+
+    // the longest waiting patches first, the budget decides how many of them fit into this update
+    std::stable_sort(pendingPatches.begin(), pendingPatches.end(), [this](int a, int b) {
+        return patches[a].pendingSince < patches[b].pendingSince;
+    });
+    size_t count = pendingPatches.size();
+    if (patchMilliseconds > 0.0)
+        count = std::min(count, std::max((size_t)(budgetMilliseconds / patchMilliseconds), (size_t)1));
+
+    // the GPU is still reading the region, the patches stay pending
+    float* region = (float*)stream.BeginWrite();
+    if (region == NULL)
+        return;
+
+    streamedPatches.assign(pendingPatches.begin(), pendingPatches.begin() + count);
+    {
+        PROFILE_SCOPE("Animated surface tessellation");
+        auto start = std::chrono::steady_clock::now();
+        jobs.ParallelFor(0, count, 1, [this, region](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                tessellate(streamedPatches[i], region + i * SLOT_VERTICES * VERTEX_SIZE);
+        });
+
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / count;
+        patchMilliseconds = patchMilliseconds > 0.0 ? patchMilliseconds + (milliseconds - patchMilliseconds) * TIMING_SMOOTHING : milliseconds;
+    }
+    stream.EndWrite(count * SLOT_SIZE);
+
+    // the copies run on the GPU in order with the draws, the region is free again once they're done
+    glBindBuffer(GL_COPY_READ_BUFFER, stream.GetBuffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    for (size_t i = 0; i < count; i++)
+    {
+        int index = streamedPatches[i];
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stream.GetOffset() + i * SLOT_SIZE, index * SLOT_SIZE, SLOT_SIZE);
+
+        // the patch lies within the convex hull of its control points
+        Patch& patch = patches[index];
+        std::vector<glm::vec3> positions;
+        for (int k = 0; k < 4; k++)
+        {
+            for (int l = 0; l < 4; l++)
+            {
+                float x, y;
+                patch.surface.GetControlPoint(k, l, x, y, patch.streamedControl[k * 4 + l]);
+                positions.push_back(origin + glm::vec3((index % patchesPerSide + x) * patchSize, patch.streamedControl[k * 4 + l], (index / patchesPerSide + y) * patchSize));
+            }
+        }
+        patch.bounds = BoundingSphere::FromPoints(positions);
+        patch.isStreamed = true;
+        patch.pendingSince = 0;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    stream.Fence();
+
+    streamedCount = count;
+}
+
+void AnimatedSurface::Draw(const Frustum& frustum)
+{
+    glBindVertexArray(VAO);
+    renderStats.vertexArrayBinds++;
+
+    for (size_t index = 0; index < patches.size(); index++)
+    {
+        const Patch& patch = patches[index];
+        if (!patch.isStreamed || !frustum.Intersects(patch.bounds))
+            continue;
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, indicesCount, GL_UNSIGNED_INT, 0, (int)index * SLOT_VERTICES);
+        renderStats.AddDraw(indicesCount / 3);
+    }
+
+    glBindVertexArray(0);
+}
+
+void AnimatedSurface::tessellate(int index, float* vertices) const
+{
+    // the region is mapped write-only, every float of the slot is written and none is read back
+    patches[index].surface.FillTile(vertices, SIDE - 1, origin, index % patchesPerSide, index / patchesPerSide, patchSize);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef ANIMATED_SURFACE_H
+#define ANIMATED_SURFACE_H
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "Bezier.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "StreamBuffer.h"
+
+// Grid of bicubic Bezier patches whose control heights follow a function of position and time.
+// Every update samples the control nets again and re-tessellates only the patches whose net moved,
+// as many as fit into a CPU time budget, the rest wait for the next frames. The new vertices are
+// written into a StreamBuffer and copied on the GPU into the patch's slot of the vertex buffer the
+// draws read, so neither the tessellation nor the upload waits for the GPU. A patch left for a later
+// update keeps its old edge against a streamed neighbour for those frames.
+class AnimatedSurface
+{
+public:
+    // every patch has 2^LEVEL cells along each side
+    static const int LEVEL = 4;
+
+    // patchesPerSide * patchesPerSide square patches spreading from origin along +x and +z, the
+    // control heights are height(x, z, time) and stay within [-amplitude, amplitude];
+    // budgetMilliseconds bounds the tessellation per update. Needs the OpenGL context.
+    AnimatedSurface(int patchesPerSide, float patchSize, const glm::vec3& origin, const std::function<float(float, float, float)>& height,
+        float amplitude, double budgetMilliseconds);
+    ~AnimatedSurface();
+
+    AnimatedSurface(const AnimatedSurface&) = delete;
+    AnimatedSurface& operator=(const AnimatedSurface&) = delete;
+
+    // moves the control points to the given time and streams the patches that changed, spread over
+    // the job system's workers; must be called on the thread owning the context
+    void Update(float time, JobSystem& jobs);
+    // draws the patches intersecting the frustum
+    void Draw(const Frustum& frustum);
+
+    // bounds of the surface at any time
+    const BoundingSphere& GetBounds() const { return bounds; }
+    // patches whose vertices lag behind their control points
+    size_t GetPendingCount() const { return pendingPatches.size() - streamedCount; }
+    // patches tessellated by the last update
+    size_t GetStreamedCount() const { return streamedCount; }
+
+private:
+    struct Patch
+    {
+        BezierSurface<3, float> surface;
+        // control heights the vertices on the GPU were tessellated from
+        float streamedControl[16] = {};
+        BoundingSphere bounds;
+        // update the control points last moved away from the streamed ones, for the queue order
+        unsigned int pendingSince = 0;
+        bool isStreamed = false;
+    };
+
+    int patchesPerSide;
+    float patchSize;
+    glm::vec3 origin;
+    std::function<float(float, float, float)> height;
+    std::vector<Patch> patches;
+    BoundingSphere bounds;
+
+    // tessellation time per patch, averaged over the updates, turns the budget into a patch count
+    double budgetMilliseconds;
+    double patchMilliseconds;
+    unsigned int updatesCount;
+
+    std::vector<int> pendingPatches;
+    std::vector<int> streamedPatches;
+    size_t streamedCount;
+
+    StreamBuffer stream;
+    unsigned int indicesCount;
+    unsigned int VAO, VBO, EBO;
+
+    void tessellate(int index, float* vertices) const;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(size_t blockSize) : blockSize(blockSize)
+{
+}
+
+void* Arena::Allocate(size_t bytes, size_t alignment)
+{
+    if (!blocks.empty())
+    {
+        Block& block = blocks.back();
+        uintptr_t start = reinterpret_cast<uintptr_t>(block.data.get()) + offset;
+        size_t padding = (alignment - start % alignment) % alignment;
+        if (offset + padding + bytes <= block.size)
+        {
+            offset += padding + bytes;
+            bytesAllocated += bytes;
+            return block.data.get() + offset - bytes;
+        }
+    }
+
+    // a new block, with room for the alignment padding; the rest of the previous one stays unused
+    Block block;
+    block.size = std::max(blockSize, bytes + alignment);
+    block.data.reset(new unsigned char[block.size]);
+    bytesReserved += block.size;
+    blocks.push_back(std::move(block));
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+    size_t padding = (alignment - start % alignment) % alignment;
+    offset = padding + bytes;
+    bytesAllocated += bytes;
+    return blocks.back().data.get() + padding;
+}
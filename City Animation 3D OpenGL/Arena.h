@@ -0,0 +1,51 @@
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that dies all at once. An allocation bumps an offset through blocks
+// taken from the heap, nothing is freed on its own; the destructor frees every block in one go.
+// One thread allocates, any number may fill what it was handed.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 1 << 20);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // bytes aligned to a power of two, larger requests than the block size get a block of their own
+    void* Allocate(size_t bytes, size_t alignment);
+
+    // uninitialized room for count elements of plain data
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // bytes handed out, and bytes taken from the heap for them
+    size_t GetBytesAllocated() const { return bytesAllocated; }
+    size_t GetBytesReserved() const { return bytesReserved; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    // offset of the first free byte in the last block
+    size_t offset = 0;
+    size_t bytesAllocated = 0;
+    size_t bytesReserved = 0;
+};
+
+#endif
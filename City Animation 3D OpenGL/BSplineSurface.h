@@ -0,0 +1,19 @@
+#pragma once
+#ifndef BSPLINE_SURFACE_H
+#define BSPLINE_SURFACE_H
+
+#include "PatchSurface.h"
+
+// Uniform B-spline patch of the given degree over any controlCount * controlCount net (at least
+// Degree + 1 per side). Unlike a Bezier patch a control point only moves the Degree + 1 spans
+// around it, and the surface stays smooth across them, so large nets need no stitching.
+template <int Degree = 3, typename Scalar = double>
+class BSplineSurface : public PatchSurface<UniformBSplineBasis<Degree>, Scalar>
+{
+public:
+    BSplineSurface(int controlCount) : PatchSurface<UniformBSplineBasis<Degree>, Scalar>(controlCount)
+    {
+    }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "Benchmark.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+const unsigned int CAMERAS_COUNT = 4;
+const unsigned int SHADINGS_COUNT = 3;
+const unsigned int MODES_COUNT = CAMERAS_COUNT * SHADINGS_COUNT * 2 * 2;
+
+// nearest-rank percentile of the given samples
+static double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0.0;
+
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)(fraction * values.size() + 0.5);
+    rank = std::min(std::max(rank, (size_t)1), values.size());
+    return values[rank - 1];
+}
+
+static double mean(const std::vector<double>& values)
+{
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+Benchmark::Benchmark(unsigned int framesCount, const GpuTimer& gpuTimer) : framesCount(framesCount), frame(0), gpuTimer(gpuTimer), gpuFrameOffset(0)
+{
+    records.reserve(framesCount);
+
+    // default flythrough: a loop around the city block with the car, looking at its center
+    const int keyframesCount = 8;
+    std::vector<glm::vec3> positions, targets;
+    for (int i = 0; i < keyframesCount; i++)
+    {
+        float angle = glm::radians(360.0f * i / keyframesCount);
+        float radius = (i % 2 == 0) ? 7.0f : 4.5f;
+        positions.push_back(glm::vec3(cos(angle) * radius, 1.5f + 0.5f * (i % 3), 2.0f + sin(angle) * radius));
+        targets.push_back(glm::vec3(0.0f, 0.0f, 2.0f));
+    }
+    positionPath = SplinePath::FromCatmullRom(positions, true);
+    targetPath = SplinePath::FromCatmullRom(targets, true);
+}
+
+bool Benchmark::LoadCameraPath(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCHMARK::CAMERA_PATH_NOT_FOUND: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions, targets;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream values(line);
+        glm::vec3 position, target;
+        if (values >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z)
+        {
+            positions.push_back(position);
+            targets.push_back(target);
+        }
+    }
+
+    if (positions.size() < 2)
+    {
+        std::cout << "ERROR::BENCHMARK::CAMERA_PATH_TOO_SHORT: " << path << std::endl;
+        return false;
+    }
+
+    positionPath = SplinePath::FromCatmullRom(positions, true);
+    targetPath = SplinePath::FromCatmullRom(targets, true);
+    return true;
+}
+
+bool Benchmark::IsFinished() const
+{
+    return frame >= framesCount;
+}
+
+BenchmarkStep Benchmark::GetStep(unsigned int frame) const
+{
+    // every combination of modes gets an equal share of the frames
+    unsigned int segmentFrames = std::max(framesCount / MODES_COUNT, 1u);
+    unsigned int mode = (frame / segmentFrames) % MODES_COUNT;
+
+    BenchmarkStep step;
+    step.camera = (CameraMode)(mode % CAMERAS_COUNT);
+    step.shading = (ShadingMode)((mode / CAMERAS_COUNT) % SHADINGS_COUNT);
+    step.isDay = (mode / (CAMERAS_COUNT * SHADINGS_COUNT)) % 2 == 0;
+    step.isFogEnabled = (mode / (CAMERAS_COUNT * SHADINGS_COUNT * 2)) % 2 == 1;
+
+    // the free camera goes around the closed path once during the whole run, covering the same
+    // distance every frame however far apart the keyframes are
+    float parameter = positionPath.ParameterAt((float)frame / framesCount * positionPath.GetLength());
+    step.cameraPosition = positionPath.Evaluate(parameter).position;
+    step.cameraTarget = targetPath.Evaluate(parameter).position;
+    return step;
+}
+
+void Benchmark::BeginFrame()
+{
+    if (frame == 0)
+        gpuFrameOffset = gpuTimer.GetFrame();
+
+    frameStart = std::chrono::steady_clock::now();
+}
+
+void Benchmark::EndFrame(double trafficMilliseconds)
+{
+    FrameRecord record;
+    record.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    record.gpuTime = -1.0;
+    record.trafficTime = trafficMilliseconds;
+    record.drawCalls = renderStats.drawCalls;
+    record.triangles = renderStats.triangles;
+    record.stateChanges = renderStats.StateChanges();
+    record.textureBinds = renderStats.textureBinds;
+    record.uniformUpdates = renderStats.uniformUpdates;
+    record.step = GetStep();
+    records.push_back(record);
+
+    frame++;
+    collectGpuTimes();
+}
+
+void Benchmark::collectGpuTimes()
+{
+    // the last few frames never get their results, they're left out of the GPU statistics
+    if (!gpuTimer.HasResults())
+        return;
+
+    const GpuFrameTimes& results = gpuTimer.GetResults();
+    if (results.frame < gpuFrameOffset || results.frame - gpuFrameOffset >= records.size())
+        return;
+
+    FrameRecord& record = records[results.frame - gpuFrameOffset];
+    record.gpuTime = results.totalMilliseconds;
+    record.gpuPasses = results.passes;
+}
+
+bool Benchmark::WriteReport(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCHMARK::REPORT_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    bool isCsv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (isCsv)
+        writeCsv(file);
+    else
+        writeJson(file);
+
+    std::cout << "Benchmark report written to " << path << std::endl;
+    return true;
+}
+
+void Benchmark::writeJson(std::ostream& stream) const
+{
+    std::vector<double> cpuTimes, gpuTimes, trafficTimes, drawCalls, triangles, stateChanges, textureBinds, uniformUpdates;
+    // per-pass GPU times, in the order the passes first appeared
+    std::vector<std::pair<std::string, std::vector<double>>> gpuPasses;
+    for (const FrameRecord& record : records)
+    {
+        cpuTimes.push_back(record.cpuTime);
+        if (record.gpuTime >= 0.0)
+            gpuTimes.push_back(record.gpuTime);
+        trafficTimes.push_back(record.trafficTime);
+        drawCalls.push_back(record.drawCalls);
+        triangles.push_back((double)record.triangles);
+        stateChanges.push_back(record.stateChanges);
+        textureBinds.push_back(record.textureBinds);
+        uniformUpdates.push_back(record.uniformUpdates);
+
+        for (const GpuPassTime& pass : record.gpuPasses)
+        {
+            auto found = std::find_if(gpuPasses.begin(), gpuPasses.end(), [&pass](const auto& entry) { return entry.first == pass.name; });
+            if (found == gpuPasses.end())
+            {
+                gpuPasses.push_back({ pass.name, std::vector<double>() });
+                found = gpuPasses.end() - 1;
+            }
+            found->second.push_back(pass.milliseconds);
+        }
+    }
+
+    auto writeDistribution = [&stream](const char* name, const std::vector<double>& values, bool isLast) {
+        stream << "    \"" << name << "\": { \"mean\": " << mean(values)
+            << ", \"p50\": " << percentile(values, 0.50)
+            << ", \"p95\": " << percentile(values, 0.95)
+            << ", \"p99\": " << percentile(values, 0.99) << " }" << (isLast ? "\n" : ",\n");
+    };
+
+    stream << "{\n";
+    stream << "  \"frames\": " << records.size() << ",\n";
+    stream << "  \"timeStep\": " << TIME_STEP << ",\n";
+    stream << "  \"metrics\": {\n";
+    writeDistribution("cpuFrameTimeMs", cpuTimes, false);
+    writeDistribution("gpuFrameTimeMs", gpuTimes, false);
+    writeDistribution("trafficUpdateMs", trafficTimes, false);
+    writeDistribution("drawCalls", drawCalls, false);
+    writeDistribution("triangles", triangles, false);
+    writeDistribution("stateChanges", stateChanges, false);
+    writeDistribution("textureBinds", textureBinds, false);
+    writeDistribution("uniformUpdates", uniformUpdates, true);
+    stream << "  },\n";
+    stream << "  \"gpuPassTimeMs\": {\n";
+    for (size_t i = 0; i < gpuPasses.size(); i++)
+        writeDistribution(gpuPasses[i].first.c_str(), gpuPasses[i].second, i + 1 == gpuPasses.size());
+    stream << "  }\n";
+    stream << "}\n";
+}
+
+void Benchmark::writeCsv(std::ostream& stream) const
+{
+    // the passes column lists "name=milliseconds" pairs separated by semicolons
+    stream << "frame,cpuFrameTimeMs,gpuFrameTimeMs,trafficUpdateMs,drawCalls,triangles,stateChanges,textureBinds,uniformUpdates,camera,shading,isDay,isFogEnabled,gpuPassTimeMs\n";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const FrameRecord& record = records[i];
+        stream << i << "," << record.cpuTime << "," << record.gpuTime << "," << record.trafficTime << "," << record.drawCalls << "," << record.triangles << ","
+            << record.stateChanges << "," << record.textureBinds << "," << record.uniformUpdates << ","
+            << record.step.camera << "," << record.step.shading << "," << record.step.isDay << "," << record.step.isFogEnabled << ",";
+        for (size_t pass = 0; pass < record.gpuPasses.size(); pass++)
+            stream << (pass > 0 ? ";" : "") << record.gpuPasses[pass].name << "=" << record.gpuPasses[pass].milliseconds;
+        stream << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "GpuTimer.h"
+#include "FramePacket.h"
+#include "SplinePath.h"
+
+// scene configuration the benchmark script prescribes for a frame
+struct BenchmarkStep
+{
+    CameraMode camera;
+    ShadingMode shading;
+    bool isDay;
+    bool isFogEnabled;
+    // pose of the free camera
+    glm::vec3 cameraPosition;
+    glm::vec3 cameraTarget;
+};
+
+// Deterministic benchmark: runs a fixed number of frames with a fixed simulated timestep, cycles
+// through every camera, shading, day/night and fog mode, flies the free camera at a constant speed
+// along a spline through scripted keyframes and reports CPU/GPU frame time percentiles together with the submitted work.
+class Benchmark
+{
+public:
+    // simulated time between two frames
+    static constexpr float TIME_STEP = 1.0f / 60.0f;
+
+    // GPU frame and pass times are taken from the given timer
+    Benchmark(unsigned int framesCount, const GpuTimer& gpuTimer);
+
+    // replaces the built-in camera path with keyframes read from a file, one "x y z targetX targetY targetZ" per line
+    bool LoadCameraPath(const std::string& path);
+
+    bool IsFinished() const;
+    unsigned int GetFrame() const { return frame; }
+    // simulated time of the current frame
+    float GetTime() const { return frame * TIME_STEP; }
+    BenchmarkStep GetStep() const { return GetStep(frame); }
+    // the script doesn't change while running, so any thread may read the steps
+    BenchmarkStep GetStep(unsigned int frame) const;
+
+    // call after RenderStats were reset and the GPU timer started the frame
+    void BeginFrame();
+    // call after swapping buffers, collects the frame's timings and RenderStats; the traffic's
+    // steps run on the simulation thread, which measures them itself
+    void EndFrame(double trafficMilliseconds);
+
+    // writes a JSON summary or, for a .csv path, one row per frame
+    bool WriteReport(const std::string& path);
+
+private:
+    struct FrameRecord
+    {
+        double cpuTime;
+        double gpuTime; // negative until the timer's results arrive
+        double trafficTime;
+        std::vector<GpuPassTime> gpuPasses;
+        unsigned int drawCalls;
+        unsigned long long triangles;
+        unsigned int stateChanges;
+        unsigned int textureBinds;
+        unsigned int uniformUpdates;
+        BenchmarkStep step;
+    };
+
+    unsigned int framesCount;
+    unsigned int frame;
+    std::vector<FrameRecord> records;
+    // closed splines through the keyframes; the target is taken at the position's parameter, so
+    // both reach a keyframe together
+    SplinePath positionPath;
+    SplinePath targetPath;
+
+    // GPU times arrive a few frames late, the timer's frame numbers are mapped to records by the offset
+    const GpuTimer& gpuTimer;
+    unsigned int gpuFrameOffset;
+    std::chrono::steady_clock::time_point frameStart;
+
+    void collectGpuTimes();
+    void writeJson(std::ostream& stream) const;
+    void writeCsv(std::ostream& stream) const;
+};
+
+#endif
\ No newline at end of file
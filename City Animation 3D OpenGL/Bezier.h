@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cmath>
 #include <vector>
-using namespace std;
 
-#define SIZE 3
+#include <glm/glm.hpp>
+
+#include "PatchSurface.h"
+using namespace std;
 
 struct Vector3
 {
@@ -23,188 +26,147 @@ struct Vector3
     }
 };
 
-class BezierSurface
+// Bezier patch of the given degree: a single span over (Degree + 1) * (Degree + 1) control heights
+template <int Degree = 3, typename Scalar = double>
+class BezierSurface : public PatchSurface<BernsteinBasis<Degree>, Scalar>
 {
 private:
-    int Binomials[SIZE + 1] = {};
-    double BaseZValues[SIZE + 1][SIZE + 1] = {};
+    typedef PatchSurface<BernsteinBasis<Degree>, Scalar> Base;
+    using Base::BaseZValues;
+    using Base::ORDER;
 
 public:
-    BezierSurface()
+    BezierSurface() : Base(BernsteinBasis<Degree>::ORDER)
     {
-        for (int i = 0; i <= SIZE; ++i)
-        {
-            Binomials[i] = ComputeBinomCoeff(SIZE, i);
-        }
     }
 
-    void SetBaseZValues(float* zValues)
+    // reference evaluation of a single point, kept to check the batch evaluator against
+    Scalar ComputeZValueInPoint(Scalar x, Scalar y) const
     {
-        int k = 0;
-        for (int i = 0; i <= SIZE; ++i)
-        {
-            for (int j = 0; j <= SIZE; ++j)
-            {
-                BaseZValues[i][j] = zValues[k++];
-            }
-        }
-    }
+        Scalar z = 0;
 
-    void FillArrayWithValues(float* vertices, int length, int accuracy)
-    {
-        int k = 0;
-        float diff = 1.0f / accuracy;
-        float empty = 1.0f;
-
-        for (int i = 0; i < accuracy; ++i)
+        for (int i = 0; i <= Degree; ++i)
         {
-            for (int j = 0; j < accuracy; ++j)
+            for (int j = 0; j <= Degree; ++j)
             {
-                float x1 = i * diff, y1 = j * diff;
-                float x2 = (i + 1) * diff, y2 = j * diff;
-                float x3 = i * diff, y3 = (j + 1) * diff;
-                float x4 = (i + 1) * diff, y4 = (j + 1) * diff;
-
-                float z1 = (float)ComputeZValueInPoint(x1, y1);
-                float z2 = (float)ComputeZValueInPoint(x2, y2);
-                float z3 = (float)ComputeZValueInPoint(x3, y3);
-                float z4 = (float)ComputeZValueInPoint(x4, y4);
-
-                Vector3 n1 = ComputeNormalVectorInPoint(x1, y1, z1);
-                Vector3 n2 = ComputeNormalVectorInPoint(x2, y2, z2);
-                Vector3 n3 = ComputeNormalVectorInPoint(x3, y3, z3);
-                Vector3 n4 = ComputeNormalVectorInPoint(x4, y4, z4);
-
-                FillRowWithValues(vertices, k, x1, y1, z1, n1, empty);
-                k += 8;
-
-                FillRowWithValues(vertices, k, x2, y2, z2, n2, empty);
-                k += 8;
-
-                FillRowWithValues(vertices, k, x3, y3, z3, n3, empty);
-                k += 8;
-
-                FillRowWithValues(vertices, k, x3, y3, z3, n3, empty);
-                k += 8;
-
-                FillRowWithValues(vertices, k, x2, y2, z2, n2, empty);
-                k += 8;
-
-                FillRowWithValues(vertices, k, x4, y4, z4, n4, empty);
-                k += 8;
-            }
-        }
-    }
-
-private:
-    void FillRowWithValues(float* vertices, int startIndex, float x, float y, float z, Vector3 n, float empty)
-    {
-        int k = startIndex;
-        vertices[k] = x; vertices[k + 1] = y; vertices[k + 2] = z;
-        vertices[k + 3] = (float)n.x; vertices[k + 4] = (float)n.y; vertices[k + 5] = (float)n.z;
-        vertices[k + 6] = empty; vertices[k + 7] = empty;
-    }
-
-    double ComputeZValueInPoint(double x, double y)
-    {
-        double z = 0;
-
-        for (int i = 0; i <= SIZE; ++i)
-        {
-            for (int j = 0; j <= SIZE; ++j)
-            {
-                z += BaseZValues[i][j] * ComputeBernstein(i, x) * ComputeBernstein(j, y);
+                z += BaseZValues[i * ORDER + j] * ComputeBernstein(i, x) * ComputeBernstein(j, y);
             }
         }
 
         return z;
     }
 
-    Vector3 ComputeNormalVectorInPoint(double x, double y, double z)
+    Vector3 ComputeNormalVectorInPoint(Scalar x, Scalar y, Scalar z) const
     {
         Vector3 U = ComputePartialDerivativeX(x, y);
         Vector3 V = ComputePartialDerivativeY(x, y);
         return U.ComputeCrossProduct(V);
     }
 
-	int ComputeBinomCoeff(int n, int k)
-	{
-        if (k > n)
-        {
-            return 0;
-        }
-        if (k == n)
+    // Tessellates the patch as the tile at (tileX, tileZ) of a ground of tileSize squares from origin,
+    // heights along y: (cells + 1) * (cells + 1) vertices of VERTEX_SIZE floats, row after row, with
+    // texture coordinates in tiles. The edges come from their own ORDER control heights alone, which
+    // the neighbour has too, not from the grid evaluation whose rounding depends on the whole net, so
+    // tiles sharing an edge get bitwise equal vertices along it. vertices is only written, it may be
+    // a mapped buffer.
+    void FillTile(float* vertices, int cells, const glm::vec3& origin, int tileX, int tileZ, float tileSize) const
+    {
+        int side = cells + 1;
+
+        // parameters as quotients, so the vertices a coarser neighbour shares get the very same values
+        std::vector<float> coordinates(side);
+        for (int i = 0; i < side; i++)
+            coordinates[i] = (float)i / cells;
+
+        int count = side * side;
+        std::vector<float> z(count), dzdx(count), dzdy(count);
+        this->EvaluateGrid(coordinates.data(), side, coordinates.data(), side, z.data(), dzdx.data(), dzdy.data());
+
+        float edges[4][ORDER];
+        for (int k = 0; k < ORDER; k++)
         {
-            return 1;
+            float x, y;
+            this->GetControlPoint(0, k, x, y, edges[0][k]);
+            this->GetControlPoint(Degree, k, x, y, edges[1][k]);
+            this->GetControlPoint(k, 0, x, y, edges[2][k]);
+            this->GetControlPoint(k, Degree, x, y, edges[3][k]);
         }
-        if (k > n - k)
+        for (int i = 0; i < side; i++)
         {
-            k = n - k;
+            z[i] = BernsteinBasis<Degree>::EvaluateCurve(edges[0], coordinates[i]);
+            z[cells * side + i] = BernsteinBasis<Degree>::EvaluateCurve(edges[1], coordinates[i]);
+            z[i * side] = BernsteinBasis<Degree>::EvaluateCurve(edges[2], coordinates[i]);
+            z[i * side + cells] = BernsteinBasis<Degree>::EvaluateCurve(edges[3], coordinates[i]);
         }
 
-        int c = 1;
-        for (int i = 1; i <= k; ++i)
+        int k = 0;
+        for (int v = 0; v < count; v++)
         {
-            c *= n--;
-            c /= i;
+            float u = coordinates[v / side];
+            float w = coordinates[v % side];
+
+            // slopes by the patch parameters turned into slopes along x and z
+            vertices[k] = origin.x + (tileX + u) * tileSize; vertices[k + 1] = origin.y + z[v]; vertices[k + 2] = origin.z + (tileZ + w) * tileSize;
+            vertices[k + 3] = -dzdx[v] / tileSize; vertices[k + 4] = 1.0f; vertices[k + 5] = -dzdy[v] / tileSize;
+            vertices[k + 6] = tileX + u; vertices[k + 7] = tileZ + w;
+            k += Base::VERTEX_SIZE;
         }
+    }
 
-        return c;
-	}
-
-    double ComputeBernstein(int i, double t) const
+private:
+    static Scalar ComputeBernstein(int i, Scalar t)
     {
-        return Binomials[i] * pow(t, i) * pow(1 - t, SIZE - i);
+        return BernsteinBasis<Degree>::BINOMIALS[i] * pow(t, i) * pow(1 - t, Degree - i);
     }
 
-    double ComputeBernsteinDerivative(int i, double t)
+    static Scalar ComputeBernsteinDerivative(int i, Scalar t)
     {
         if (i == 0)
         {
-            return Binomials[0] * pow(1 - t, SIZE - 1) * SIZE * (-1);
+            return BernsteinBasis<Degree>::BINOMIALS[0] * pow(1 - t, Degree - 1) * Degree * (-1);
         }
 
-        if (i == SIZE)
+        if (i == Degree)
         {
-            return Binomials[SIZE] * pow(t, SIZE - 1) * SIZE;
+            return BernsteinBasis<Degree>::BINOMIALS[Degree] * pow(t, Degree - 1) * Degree;
         }
 
-        return Binomials[i] * pow(t, i - 1) * pow(1 - t, SIZE - i - 1) * (SIZE * t - i) * (-1);
+        return BernsteinBasis<Degree>::BINOMIALS[i] * pow(t, i - 1) * pow(1 - t, Degree - i - 1) * (Degree * t - i) * (-1);
     }
 
-    Vector3 ComputePartialDerivativeX(double x, double y)
+    Vector3 ComputePartialDerivativeX(Scalar x, Scalar y) const
     {
-        double dx, dy, dz;
+        Scalar dx, dy, dz;
 
         dx = 1;
         dy = 0;
         dz = 0;
-        for (int i = 0; i <= SIZE; ++i)
+        for (int i = 0; i <= Degree; ++i)
         {
-            for (int j = 0; j <= SIZE; ++j)
+            for (int j = 0; j <= Degree; ++j)
             {
-                dz += BaseZValues[i][j] * ComputeBernsteinDerivative(i, x) * ComputeBernstein(j, y);
+                dz += BaseZValues[i * ORDER + j] * ComputeBernsteinDerivative(i, x) * ComputeBernstein(j, y);
             }
         }
 
         return Vector3(dx, dy, dz);
     }
 
-    Vector3 ComputePartialDerivativeY(double x, double y)
+    Vector3 ComputePartialDerivativeY(Scalar x, Scalar y) const
     {
-        double dx, dy, dz;
+        Scalar dx, dy, dz;
 
         dx = 0;
         dy = 1;
         dz = 0;
-        for (int i = 0; i <= SIZE; ++i)
+        for (int i = 0; i <= Degree; ++i)
         {
-            for (int j = 0; j <= SIZE; ++j)
+            for (int j = 0; j <= Degree; ++j)
             {
-                dz += BaseZValues[i][j] * ComputeBernstein(i, x) * ComputeBernsteinDerivative(j, y);
+                dz += BaseZValues[i * ORDER + j] * ComputeBernstein(i, x) * ComputeBernsteinDerivative(j, y);
             }
         }
 
         return Vector3(dx, dy, dz);
     }
-};
\ No newline at end of file
+};
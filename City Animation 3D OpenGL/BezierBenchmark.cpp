@@ -0,0 +1,305 @@
+#include "BezierBenchmark.h"
+#include "Bezier.h"
+#include "BSplineSurface.h"
+#include "SplinePath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+// largest accepted deviation from the reference, heights and slopes of the test patch stay below 4
+const double FLOAT_TOLERANCE = 1.0e-5;
+const double DOUBLE_TOLERANCE = 1.0e-12;
+const unsigned int REPEATS = 5;
+// path followers sampled at once, and the largest accepted deviation of the distance between two
+// neighbouring samples from the distance asked for, relative to it
+const size_t PATH_FOLLOWERS = 10000;
+const double PATH_SPACING_TOLERANCE = 0.01;
+// side of the net of the B-spline check, four cubic spans along each side, and the parameters per side
+// its slopes are sampled at; the slopes are checked against central differences over the steps, with
+// tolerances that allow for the truncation error of the differences
+const int BSPLINE_CONTROL_COUNT = 7;
+const int BSPLINE_SAMPLES = 101;
+const float BSPLINE_FLOAT_STEP = 1.0f / 256;
+const double BSPLINE_DOUBLE_STEP = 1.0 / 65536;
+const double BSPLINE_FLOAT_DERIVATIVE_TOLERANCE = 1.0e-3;
+const double BSPLINE_DOUBLE_DERIVATIVE_TOLERANCE = 1.0e-7;
+
+typedef UniformBSplineBasis<3> BSplineBasis;
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Function>
+static double bestTime(Function function)
+{
+    double best = 1.0e30;
+    for (unsigned int i = 0; i < REPEATS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+// reference values of one evaluation, z and the first two normal components
+struct SurfaceSamples
+{
+    std::vector<double> z;
+    std::vector<double> normalX;
+    std::vector<double> normalY;
+
+    SurfaceSamples(size_t count) : z(count), normalX(count), normalY(count) {}
+};
+
+template <typename Scalar>
+static double measureBatch(BezierSurface<>& surface, int side, const SurfaceSamples& reference, double& maxError)
+{
+    std::vector<Scalar> coordinates(side);
+    for (int i = 0; i < side; i++)
+        coordinates[i] = (Scalar)i / (side - 1);
+
+    size_t count = (size_t)side * side;
+    std::vector<Scalar> z(count), dzdx(count), dzdy(count);
+    double time = bestTime([&] {
+        surface.EvaluateGrid(coordinates.data(), side, coordinates.data(), side, z.data(), dzdx.data(), dzdy.data());
+    });
+
+    maxError = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        maxError = std::max(maxError, std::abs((double)z[i] - reference.z[i]));
+        maxError = std::max(maxError, std::abs(-(double)dzdx[i] - reference.normalX[i]));
+        maxError = std::max(maxError, std::abs(-(double)dzdy[i] - reference.normalY[i]));
+    }
+    return time;
+}
+
+// times the lookups of followers spread evenly along an uneven loop, the spacing error is the
+// largest deviation of the distance between neighbouring samples from their spacing along the path
+static double measurePath(double& spacingError)
+{
+    std::vector<glm::vec3> points;
+    for (int i = 0; i < 64; i++)
+    {
+        float angle = glm::radians(360.0f * (i + 0.4f * sin(i * 1.7f)) / 64.0f);
+        float radius = 20.0f + 6.0f * sin(i * 0.9f);
+        points.push_back(glm::vec3(cos(angle) * radius, 2.0f * sin(i * 0.5f), sin(angle) * radius));
+    }
+    SplinePath path = SplinePath::FromCatmullRom(points, true);
+
+    float spacing = path.GetLength() / PATH_FOLLOWERS;
+    std::vector<float> distances(PATH_FOLLOWERS);
+    for (size_t i = 0; i < PATH_FOLLOWERS; i++)
+        distances[i] = i * spacing;
+    std::vector<PathSample> samples(PATH_FOLLOWERS);
+    double time = bestTime([&] {
+        path.Sample(distances.data(), PATH_FOLLOWERS, samples.data());
+    });
+
+    spacingError = 0.0;
+    for (size_t i = 0; i < PATH_FOLLOWERS; i++)
+    {
+        double chord = glm::length(samples[(i + 1) % PATH_FOLLOWERS].position - samples[i].position);
+        spacingError = std::max(spacingError, std::abs(chord - spacing) / spacing);
+    }
+    return time;
+}
+
+// largest deviations of the B-spline patch from what it must satisfy: weights that sum to one with
+// derivatives that sum to zero, slopes that match central differences of the heights, and values and
+// slopes at the knots, the borders included, equal to those of the spans on either side
+struct BSplineErrors
+{
+    double unity = 0.0;
+    double derivative = 0.0;
+    double knot = 0.0;
+};
+
+// z and the slopes of the span (spanX, spanY) at the local parameters (u, v), in double whatever the
+// precision checked
+static void evaluateBSplineSpan(const std::vector<float>& heights, int spanX, double u, int spanY, double v, double& z, double& dzdx, double& dzdy)
+{
+    const int spans = BSPLINE_CONTROL_COUNT - 3;
+    double valuesX[BSplineBasis::ORDER], derivativesX[BSplineBasis::ORDER];
+    double valuesY[BSplineBasis::ORDER], derivativesY[BSplineBasis::ORDER];
+    BSplineBasis::Evaluate(u, valuesX, derivativesX);
+    BSplineBasis::Evaluate(v, valuesY, derivativesY);
+
+    z = dzdx = dzdy = 0.0;
+    for (int k = 0; k < BSplineBasis::ORDER; k++)
+    {
+        for (int l = 0; l < BSplineBasis::ORDER; l++)
+        {
+            double height = heights[(spanX + k) * BSPLINE_CONTROL_COUNT + spanY + l];
+            z += height * valuesX[k] * valuesY[l];
+            dzdx += height * derivativesX[k] * valuesY[l] * spans;
+            dzdy += height * valuesX[k] * derivativesY[l] * spans;
+        }
+    }
+}
+
+template <typename Scalar>
+static BSplineErrors checkBSpline(Scalar step)
+{
+    BSplineErrors errors;
+    for (int i = 0; i < BSPLINE_SAMPLES; i++)
+    {
+        Scalar values[BSplineBasis::ORDER], derivatives[BSplineBasis::ORDER];
+        BSplineBasis::Evaluate((Scalar)i / (BSPLINE_SAMPLES - 1), values, derivatives);
+        Scalar sum = Scalar(0), derivativeSum = Scalar(0);
+        for (int k = 0; k < BSplineBasis::ORDER; k++)
+        {
+            sum += values[k];
+            derivativeSum += derivatives[k];
+        }
+        errors.unity = std::max(errors.unity, std::max(std::abs((double)sum - 1.0), std::abs((double)derivativeSum)));
+    }
+
+    // smooth heights that differ in every span
+    std::vector<float> heights(BSPLINE_CONTROL_COUNT * BSPLINE_CONTROL_COUNT);
+    for (int i = 0; i < BSPLINE_CONTROL_COUNT; i++)
+    {
+        for (int j = 0; j < BSPLINE_CONTROL_COUNT; j++)
+            heights[i * BSPLINE_CONTROL_COUNT + j] = sin(0.9f * i) * cos(0.7f * j) + 0.05f * i * j;
+    }
+    BSplineSurface<3, Scalar> surface(BSPLINE_CONTROL_COUNT);
+    surface.SetBaseZValues(heights.data());
+
+    auto evaluate = [&surface](const std::vector<Scalar>& xs, const std::vector<Scalar>& ys, std::vector<Scalar>& z, std::vector<Scalar>& dzdx, std::vector<Scalar>& dzdy) {
+        size_t count = xs.size() * ys.size();
+        z.resize(count);
+        dzdx.resize(count);
+        dzdy.resize(count);
+        surface.EvaluateGrid(xs.data(), xs.size(), ys.data(), ys.size(), z.data(), dzdx.data(), dzdy.data());
+    };
+
+    // the points are kept a step away from the borders, the differences cross the knots between them
+    std::vector<Scalar> points(BSPLINE_SAMPLES), below(BSPLINE_SAMPLES), above(BSPLINE_SAMPLES);
+    for (int i = 0; i < BSPLINE_SAMPLES; i++)
+    {
+        points[i] = step + (Scalar(1) - 2 * step) * i / (BSPLINE_SAMPLES - 1);
+        below[i] = points[i] - step;
+        above[i] = points[i] + step;
+    }
+    std::vector<Scalar> z, dzdx, dzdy, zBelow, zAbove, unusedX, unusedY;
+    evaluate(points, points, z, dzdx, dzdy);
+    evaluate(below, points, zBelow, unusedX, unusedY);
+    evaluate(above, points, zAbove, unusedX, unusedY);
+    for (size_t i = 0; i < z.size(); i++)
+        errors.derivative = std::max(errors.derivative, std::abs(((double)zAbove[i] - zBelow[i]) / (2 * (double)step) - dzdx[i]));
+    evaluate(points, below, zBelow, unusedX, unusedY);
+    evaluate(points, above, zAbove, unusedX, unusedY);
+    for (size_t i = 0; i < z.size(); i++)
+        errors.derivative = std::max(errors.derivative, std::abs(((double)zAbove[i] - zBelow[i]) / (2 * (double)step) - dzdy[i]));
+
+    const int spans = BSPLINE_CONTROL_COUNT - 3;
+    std::vector<Scalar> knots(spans + 1);
+    for (int k = 0; k <= spans; k++)
+        knots[k] = (Scalar)k / spans;
+    evaluate(knots, knots, z, dzdx, dzdy);
+    for (int kx = 0; kx <= spans; kx++)
+    {
+        for (int ky = 0; ky <= spans; ky++)
+        {
+            size_t index = (size_t)kx * (spans + 1) + ky;
+            // the span ending at the knot and the one starting there, where they exist
+            for (int spanX = std::max(kx - 1, 0); spanX <= std::min(kx, spans - 1); spanX++)
+            {
+                for (int spanY = std::max(ky - 1, 0); spanY <= std::min(ky, spans - 1); spanY++)
+                {
+                    double referenceZ, referenceDzdx, referenceDzdy;
+                    evaluateBSplineSpan(heights, spanX, kx - spanX, spanY, ky - spanY, referenceZ, referenceDzdx, referenceDzdy);
+                    errors.knot = std::max(errors.knot, std::abs(z[index] - referenceZ));
+                    errors.knot = std::max(errors.knot, std::abs(dzdx[index] - referenceDzdx));
+                    errors.knot = std::max(errors.knot, std::abs(dzdy[index] - referenceDzdy));
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+static void printBSplineErrors(std::ostream& stream, const char* precision, const BSplineErrors& errors)
+{
+    stream << "b-spline " << precision << ": unity error " << std::scientific << std::setprecision(1) << errors.unity
+        << ", derivative error " << errors.derivative << ", knot error " << errors.knot << std::fixed << "\n";
+}
+
+bool BezierBenchmark::Run(std::ostream& stream)
+{
+    // the surface program.cpp renders
+    float controlPoints[] = {
+        0.0f, 0.5f, 1.0f, 0.5f,
+        0.5f, 1.0f, 1.0f, 0.5f,
+        0.0f, 0.5f, 1.0f, 0.0f,
+        0.0f, 0.5f, 0.0f, 0.0f
+    };
+    BezierSurface<> surface;
+    surface.SetBaseZValues(controlPoints);
+
+    stream << std::setw(8) << "grid" << std::setw(14) << "scalar ns/pt" << std::setw(14) << "float ns/pt" << std::setw(10) << "speedup"
+        << std::setw(14) << "float error" << std::setw(14) << "double ns/pt" << std::setw(10) << "speedup" << std::setw(14) << "double error" << "\n";
+
+    bool isAccurate = true;
+    const int sides[] = { 11, 17, 64, 257, 1024 };
+    for (int side : sides)
+    {
+        size_t count = (size_t)side * side;
+
+        // scalar reference, a point at a time
+        SurfaceSamples reference(count);
+        double scalarTime = bestTime([&] {
+            for (int i = 0; i < side; i++)
+            {
+                for (int j = 0; j < side; j++)
+                {
+                    double x = (double)i / (side - 1), y = (double)j / (side - 1);
+                    size_t index = (size_t)i * side + j;
+                    reference.z[index] = surface.ComputeZValueInPoint(x, y);
+                    Vector3 normal = surface.ComputeNormalVectorInPoint(x, y, reference.z[index]);
+                    reference.normalX[index] = normal.x;
+                    reference.normalY[index] = normal.y;
+                }
+            }
+        });
+
+        double floatError, doubleError;
+        double floatTime = measureBatch<float>(surface, side, reference, floatError);
+        double doubleTime = measureBatch<double>(surface, side, reference, doubleError);
+        isAccurate = isAccurate && floatError <= FLOAT_TOLERANCE && doubleError <= DOUBLE_TOLERANCE;
+
+        stream << std::setw(8) << side << std::fixed << std::setprecision(2)
+            << std::setw(14) << scalarTime * 1.0e9 / count
+            << std::setw(14) << floatTime * 1.0e9 / count
+            << std::setw(10) << scalarTime / floatTime
+            << std::setw(14) << std::scientific << std::setprecision(1) << floatError << std::fixed << std::setprecision(2)
+            << std::setw(14) << doubleTime * 1.0e9 / count
+            << std::setw(10) << scalarTime / doubleTime
+            << std::setw(14) << std::scientific << std::setprecision(1) << doubleError << std::fixed << "\n";
+    }
+
+    BSplineErrors floatBSplineErrors = checkBSpline<float>(BSPLINE_FLOAT_STEP);
+    BSplineErrors doubleBSplineErrors = checkBSpline<double>(BSPLINE_DOUBLE_STEP);
+    isAccurate = isAccurate && floatBSplineErrors.unity <= FLOAT_TOLERANCE && floatBSplineErrors.knot <= FLOAT_TOLERANCE
+        && floatBSplineErrors.derivative <= BSPLINE_FLOAT_DERIVATIVE_TOLERANCE;
+    isAccurate = isAccurate && doubleBSplineErrors.unity <= DOUBLE_TOLERANCE && doubleBSplineErrors.knot <= DOUBLE_TOLERANCE
+        && doubleBSplineErrors.derivative <= BSPLINE_DOUBLE_DERIVATIVE_TOLERANCE;
+    printBSplineErrors(stream, "float", floatBSplineErrors);
+    printBSplineErrors(stream, "double", doubleBSplineErrors);
+
+    double spacingError;
+    double pathTime = measurePath(spacingError);
+    isAccurate = isAccurate && spacingError <= PATH_SPACING_TOLERANCE;
+    stream << "path: " << PATH_FOLLOWERS << " followers " << std::setprecision(2) << pathTime * 1.0e9 / PATH_FOLLOWERS << " ns each, spacing error "
+        << std::scientific << std::setprecision(1) << spacingError << " (tolerance " << PATH_SPACING_TOLERANCE << ")" << std::fixed << "\n";
+
+    stream << (isAccurate ? "accuracy: PASS" : "accuracy: FAIL") << " (float tolerance " << std::scientific << FLOAT_TOLERANCE
+        << ", double tolerance " << DOUBLE_TOLERANCE << ")" << std::fixed << "\n";
+    return isAccurate;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#ifndef BEZIER_BENCHMARK_H
+#define BEZIER_BENCHMARK_H
+
+#include <ostream>
+
+// Micro-benchmark of the Bezier surface evaluation: the scalar reference with pow in double against
+// the batch evaluator in float and double, with the largest deviation of each from the reference.
+// Checks the uniform B-spline patch in both precisions: its weights sum to one, its slopes match
+// central differences and its spans agree at the knots.
+// Also times the arc-length lookups of many followers of a spline path and checks they're spaced
+// evenly along it.
+class BezierBenchmark
+{
+public:
+    // prints a table for a few grid sizes and the path lookups, returns false if a batch result or
+    // the spacing of the path samples is outside its tolerance
+    static bool Run(std::ostream& stream);
+};
+
+#endif
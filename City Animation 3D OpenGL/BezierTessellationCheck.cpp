@@ -0,0 +1,178 @@
+#include "BezierTessellationCheck.h"
+#include "Bezier.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+// largest accepted deviation of a GPU vertex from the CPU one; tessellators may place the vertices in
+// fixed point (llvmpipe uses 16 fractional bits), so the parameters alone can be off by 1.5e-5
+const double POSITION_TOLERANCE = 2.5e-4;
+const double NORMAL_TOLERANCE = 2.5e-4;
+
+// floats transform feedback records per vertex: FragPos and Normal
+const int CAPTURED_SIZE = 6;
+
+static glm::vec3 normalized(float x, float y, float z)
+{
+    return glm::normalize(glm::vec3(x, y, z));
+}
+
+// primitives the tessellator emits for one patch with the current uniforms, their vertices in captured
+static unsigned int capturePatch(unsigned int feedbackBuffer, size_t maxTriangles, std::vector<float>& captured)
+{
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedbackBuffer);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, maxTriangles * 3 * CAPTURED_SIZE * sizeof(float), NULL, GL_STREAM_READ);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+
+    unsigned int query;
+    glGenQueries(1, &query);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+    glBeginTransformFeedback(GL_TRIANGLES);
+    glDrawArrays(GL_PATCHES, 0, 16);
+    glEndTransformFeedback();
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    unsigned int triangles = 0;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &triangles);
+    glDeleteQueries(1, &query);
+
+    captured.resize((size_t)std::min((size_t)triangles, maxTriangles) * 3 * CAPTURED_SIZE);
+    glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, captured.size() * sizeof(float), captured.data());
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    return triangles;
+}
+
+bool BezierTessellationCheck::Run(std::ostream& stream)
+{
+    if (!GLAD_GL_VERSION_4_0)
+    {
+        stream << "ERROR::TESSELLATION::NOT_SUPPORTED: tessellation shaders need OpenGL 4.0" << std::endl;
+        return false;
+    }
+
+    // the surface program.cpp renders
+    float controlPoints[] = {
+        0.0f, 0.5f, 1.0f, 0.5f,
+        0.5f, 1.0f, 1.0f, 0.5f,
+        0.0f, 0.5f, 1.0f, 0.0f,
+        0.0f, 0.5f, 0.0f, 0.0f
+    };
+    BezierSurface<> surface;
+    surface.SetBaseZValues(controlPoints);
+
+    std::vector<float> patch;
+    for (int i = 0; i < surface.GetControlCount(); i++)
+    {
+        for (int j = 0; j < surface.GetControlCount(); j++)
+        {
+            float x, y, z;
+            surface.GetControlPoint(i, j, x, y, z);
+            patch.insert(patch.end(), { x, y, z });
+        }
+    }
+
+    unsigned int VAO, VBO, feedbackBuffer;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &feedbackBuffer);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, patch.size() * sizeof(float), patch.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glPatchParameteri(GL_PATCH_VERTICES, 16);
+
+    Shader shader("Shaders/BezierPatch.vs.glsl", "Shaders/PhongShader.fs.glsl", "Shaders/BezierPatch.tcs.glsl", "Shaders/BezierPatch.tes.glsl");
+    shader.captureVaryings({ "FragPos", "Normal" });
+    ShaderVariant variant;
+    variant.isTextured = false;
+    shader.setVariant(variant);
+    shader.use();
+    shader.setMat4("model", glm::mat4(1.0f));
+    shader.setMat4("view", glm::mat4(1.0f));
+    shader.setMat4("projection", glm::mat4(1.0f));
+    shader.setVec2("viewportSize", 1.0f, 1.0f);
+    shader.setFloat("pixelsPerSegment", 1.0f);
+
+    stream << std::setw(8) << "level" << std::setw(12) << "triangles" << std::setw(12) << "expected"
+        << std::setw(16) << "position error" << std::setw(16) << "normal error" << "\n";
+
+    // at a fixed level the tessellator samples the same grid FillGrid does
+    bool isPassed = true;
+    std::vector<float> captured;
+    const int levels[] = { 1, 4, 10, 33, 64 };
+    for (int level : levels)
+    {
+        shader.setFloat("fixedTessLevel", (float)level);
+        size_t expectedTriangles = (size_t)BezierSurface<>::GetGridIndexCount(level) / 3;
+        unsigned int triangles = capturePatch(feedbackBuffer, expectedTriangles, captured);
+
+        std::vector<float> vertices(BezierSurface<>::GetGridVertexCount(level) * BezierSurface<>::VERTEX_SIZE);
+        std::vector<unsigned int> indices(BezierSurface<>::GetGridIndexCount(level));
+        surface.FillGrid(vertices.data(), indices.data(), level);
+
+        // every captured vertex has to sit on a grid vertex and match it, every grid vertex has to be used
+        double positionError = 0.0, normalError = 0.0;
+        std::vector<bool> isUsed(BezierSurface<>::GetGridVertexCount(level), false);
+        for (size_t k = 0; k < captured.size(); k += CAPTURED_SIZE)
+        {
+            int i = (int)std::lround(captured[k] * level);
+            int j = (int)std::lround(captured[k + 1] * level);
+            if (i < 0 || i > level || j < 0 || j > level)
+            {
+                positionError = 1.0e30;
+                continue;
+            }
+
+            int v = i * (level + 1) + j;
+            const float* expected = &vertices[v * BezierSurface<>::VERTEX_SIZE];
+            isUsed[v] = true;
+            for (int c = 0; c < 3; c++)
+                positionError = std::max(positionError, (double)std::abs(captured[k + c] - expected[c]));
+
+            glm::vec3 normal = normalized(captured[k + 3], captured[k + 4], captured[k + 5]);
+            glm::vec3 expectedNormal = normalized(expected[3], expected[4], expected[5]);
+            normalError = std::max(normalError, (double)glm::length(normal - expectedNormal));
+        }
+        bool isCovered = std::find(isUsed.begin(), isUsed.end(), false) == isUsed.end();
+
+        isPassed = isPassed && triangles == expectedTriangles && isCovered
+            && positionError <= POSITION_TOLERANCE && normalError <= NORMAL_TOLERANCE;
+        stream << std::setw(8) << level << std::setw(12) << triangles << std::setw(12) << expectedTriangles
+            << std::scientific << std::setprecision(1) << std::setw(16) << positionError << std::setw(16) << normalError
+            << std::fixed << (isCovered ? "" : "  grid not covered") << "\n";
+    }
+
+    // screen space levels: the same patch seen from farther away gets fewer triangles
+    shader.setFloat("fixedTessLevel", 0.0f);
+    shader.setVec2("viewportSize", 1920.0f, 1080.0f);
+    shader.setFloat("pixelsPerSegment", 8.0f);
+    shader.setMat4("projection", glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100.0f));
+
+    unsigned int previousTriangles = 0;
+    const float distances[] = { 1.5f, 4.0f, 16.0f, 64.0f };
+    for (float distance : distances)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, -0.5f, -distance));
+        shader.setMat4("model", model);
+        unsigned int triangles = capturePatch(feedbackBuffer, 2 * 64 * 64, captured);
+
+        bool isDecreasing = previousTriangles == 0 || triangles < previousTriangles;
+        isPassed = isPassed && isDecreasing;
+        stream << "distance " << std::setprecision(1) << distance << ": " << triangles << " triangles" << (isDecreasing ? "" : "  not fewer than closer") << "\n";
+        previousTriangles = triangles;
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &feedbackBuffer);
+
+    stream << (isPassed ? "tessellation: PASS" : "tessellation: FAIL") << " (position tolerance " << std::scientific << POSITION_TOLERANCE
+        << ", normal tolerance " << NORMAL_TOLERANCE << ")" << std::fixed << "\n";
+    return isPassed;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#ifndef BEZIER_TESSELLATION_CHECK_H
+#define BEZIER_TESSELLATION_CHECK_H
+
+#include <ostream>
+
+// Checks the hardware tessellation of the Bezier patch against the CPU tessellator: the vertices
+// the evaluation shader emits at fixed levels are captured with transform feedback and compared
+// with BezierSurface::FillGrid, then the screen space levels are checked to drop with distance.
+class BezierTessellationCheck
+{
+public:
+    // needs a current OpenGL 4.0 context; prints a table of the deviations, returns false on a mismatch
+    static bool Run(std::ostream& stream);
+};
+
+#endif
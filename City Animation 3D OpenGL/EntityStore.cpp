@@ -0,0 +1,83 @@
+#include "EntityStore.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+unsigned int nextComponentTypeId()
+{
+    static std::atomic<unsigned int> nextId(0);
+    unsigned int id = nextId++;
+    // the id indexes the column table and a bit of the 32 bit masks, past the limit it fits neither
+    if (id >= MAX_COMPONENT_TYPES)
+    {
+        std::cout << "ERROR::ENTITY_STORE::TOO_MANY_COMPONENT_TYPES: raise MAX_COMPONENT_TYPES" << std::endl;
+        std::abort();
+    }
+    return id;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+        return;
+
+    Record& record = records[entity.index];
+    Archetype& archetype = archetypes[record.archetype];
+    unsigned int last = (unsigned int)archetype.entities.size() - 1;
+
+    // the last row moves into the hole, then every column drops its last element
+    for (Column& column : archetype.columns)
+    {
+        if (column.elementSize == 0)
+            continue;
+        if (record.row != last)
+            std::memcpy(column.data.data() + record.row * column.elementSize, column.data.data() + last * column.elementSize, column.elementSize);
+        column.data.resize(last * column.elementSize);
+    }
+    if (record.row != last)
+    {
+        Entity moved = archetype.entities[last];
+        archetype.entities[record.row] = moved;
+        records[moved.index].row = record.row;
+    }
+    archetype.entities.pop_back();
+
+    record.archetype = NO_ARCHETYPE;
+    record.generation++;
+    freeIndices.push_back(entity.index);
+}
+
+unsigned int EntityStore::findArchetype(ComponentMask mask)
+{
+    for (unsigned int i = 0; i < archetypes.size(); i++)
+    {
+        if (archetypes[i].mask == mask)
+            return i;
+    }
+
+    archetypes.emplace_back();
+    archetypes.back().mask = mask;
+    return (unsigned int)archetypes.size() - 1;
+}
+
+Entity EntityStore::allocateEntity(unsigned int archetype, unsigned int row)
+{
+    Entity entity;
+    if (!freeIndices.empty())
+    {
+        entity.index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = (unsigned int)records.size();
+        records.emplace_back();
+    }
+
+    Record& record = records[entity.index];
+    record.archetype = archetype;
+    record.row = row;
+    entity.generation = record.generation;
+    return entity;
+}
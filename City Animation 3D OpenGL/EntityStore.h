@@ -0,0 +1,184 @@
+#pragma once
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "JobSystem.h"
+
+// handle of an entity, the generation tells a destroyed entity from the one reusing its index
+struct Entity
+{
+    unsigned int index = ~0u;
+    unsigned int generation = 0;
+};
+
+// set of component types, a bit per type id
+typedef unsigned int ComponentMask;
+
+const unsigned int MAX_COMPONENT_TYPES = 32;
+
+// next free component type id, ids are handed out the first time a type is used
+unsigned int nextComponentTypeId();
+
+template <typename Component>
+unsigned int componentTypeId()
+{
+    static const unsigned int id = nextComponentTypeId();
+    return id;
+}
+
+// Archetype-based entity component store. All entities with the same set of component types share
+// an archetype, which keeps each component type in its own contiguous array, so a sweep over some
+// components reads them one after another without touching the others. Components are plain data
+// without destructors, moved bytewise when an entity takes another's row.
+class EntityStore
+{
+public:
+    template <typename... Components>
+    Entity Create(const Components&... components)
+    {
+        static_assert(sizeof...(Components) > 0, "an entity needs at least one component");
+        // the archetype columns move components with memcpy and never run their destructors
+        static_assert((std::is_trivially_copyable<Components>::value && ...), "components must be plain data");
+        static_assert((std::is_trivially_destructible<Components>::value && ...), "components must be plain data");
+
+        ComponentMask mask = (componentBit<Components>() | ...);
+        unsigned int archetypeIndex = findArchetype(mask);
+        Archetype& archetype = archetypes[archetypeIndex];
+        ((archetype.columns[componentTypeId<Components>()].elementSize = sizeof(Components)), ...);
+
+        Entity entity = allocateEntity(archetypeIndex, (unsigned int)archetype.entities.size());
+        archetype.entities.push_back(entity);
+        (appendComponent(archetype, components), ...);
+        return entity;
+    }
+
+    // the last entity of the archetype takes the destroyed one's place
+    void Destroy(Entity entity);
+
+    bool IsAlive(Entity entity) const
+    {
+        return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype != NO_ARCHETYPE;
+    }
+
+    // NULL if the entity has no such component; valid until an entity is created or destroyed
+    template <typename Component>
+    Component* Get(Entity entity)
+    {
+        if (!IsAlive(entity))
+            return NULL;
+        const Record& record = records[entity.index];
+        Column& column = archetypes[record.archetype].columns[componentTypeId<Component>()];
+        if (column.elementSize == 0)
+            return NULL;
+        return reinterpret_cast<Component*>(column.data.data()) + record.row;
+    }
+
+    // calls function(Components&...) for every entity having all of them, archetype after archetype
+    template <typename... Components, typename Function>
+    void Each(Function function)
+    {
+        ComponentMask mask = (componentBit<Components>() | ...);
+        for (Archetype& archetype : archetypes)
+        {
+            if ((archetype.mask & mask) != mask)
+                continue;
+            size_t count = archetype.entities.size();
+            sweep<Components...>(archetype, 0, count, function);
+        }
+    }
+
+    // Each spread over the job system, chunks of at most grainSize entities run in parallel; the
+    // function must only touch the components it's given
+    template <typename... Components, typename Function>
+    void ParallelEach(JobSystem& jobs, size_t grainSize, Function function)
+    {
+        ComponentMask mask = (componentBit<Components>() | ...);
+        for (Archetype& archetype : archetypes)
+        {
+            if ((archetype.mask & mask) != mask)
+                continue;
+            jobs.ParallelFor(0, archetype.entities.size(), grainSize, [&archetype, &function](size_t begin, size_t end) {
+                sweep<Components...>(archetype, begin, end, function);
+            });
+        }
+    }
+
+    // entities having all of the components
+    template <typename... Components>
+    size_t Count() const
+    {
+        ComponentMask mask = (componentBit<Components>() | ...);
+        size_t count = 0;
+        for (const Archetype& archetype : archetypes)
+        {
+            if ((archetype.mask & mask) == mask)
+                count += archetype.entities.size();
+        }
+        return count;
+    }
+
+private:
+    static const unsigned int NO_ARCHETYPE = ~0u;
+
+    // the bytes of one component type of an archetype, elementSize is 0 for types it doesn't have
+    struct Column
+    {
+        size_t elementSize = 0;
+        std::vector<unsigned char> data;
+    };
+
+    struct Archetype
+    {
+        ComponentMask mask = 0;
+        std::vector<Entity> entities;
+        Column columns[MAX_COMPONENT_TYPES];
+    };
+
+    // where an entity index lives, NO_ARCHETYPE while the index is free
+    struct Record
+    {
+        unsigned int archetype = NO_ARCHETYPE;
+        unsigned int row = 0;
+        unsigned int generation = 0;
+    };
+
+    std::vector<Archetype> archetypes;
+    std::vector<Record> records;
+    std::vector<unsigned int> freeIndices;
+
+    template <typename Component>
+    static ComponentMask componentBit()
+    {
+        return 1u << componentTypeId<Component>();
+    }
+
+    template <typename Component>
+    static void appendComponent(Archetype& archetype, const Component& component)
+    {
+        std::vector<unsigned char>& data = archetype.columns[componentTypeId<Component>()].data;
+        size_t offset = data.size();
+        data.resize(offset + sizeof(Component));
+        new (data.data() + offset) Component(component);
+    }
+
+    template <typename... Components, typename Function>
+    static void sweep(Archetype& archetype, size_t begin, size_t end, Function& function)
+    {
+        // the column pointers are looked up once per chunk, the loop only advances them
+        std::tuple<Components*...> columns(reinterpret_cast<Components*>(archetype.columns[componentTypeId<Components>()].data.data())...);
+        for (size_t row = begin; row < end; row++)
+            function(std::get<Components*>(columns)[row]...);
+    }
+
+    unsigned int findArchetype(ComponentMask mask);
+    Entity allocateEntity(unsigned int archetype, unsigned int row);
+};
+
+#endif
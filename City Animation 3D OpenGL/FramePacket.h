@@ -0,0 +1,111 @@
+#pragma once
+#ifndef FRAME_PACKET_H
+#define FRAME_PACKET_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// camera modes in the order of their keys (h, j, k, l)
+enum CameraMode {
+    STATIONARY_CAMERA,
+    FOLLOWING_CAMERA,
+    FPP_CAMERA,
+    FREE_CAMERA
+};
+
+// shading modes in the order of their keys (i, o, p)
+enum ShadingMode {
+    FLAT_SHADING,
+    GOURAUD_SHADING,
+    PHONG_SHADING
+};
+
+// lights as the lighting shaders see them (see Shaders/Include/Lighting.glsl)
+struct PointLight
+{
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct SpotLight
+{
+    glm::vec3 position;
+    glm::vec3 direction;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+    // cosines of the angles where the light starts fading and where it's gone
+    float cutOff;
+    float outerCutOff;
+};
+
+enum SceneObject {
+    CITY_OBJECT,
+    CAR_OBJECT,
+    LANTERN_OBJECT,
+    SPOTLIGHT_OBJECT,
+    BEZIER_SURFACE_OBJECT,
+    TERRAIN_OBJECT,
+    WATER_OBJECT,
+    TRAFFIC_OBJECT,
+    LIGHT_TAGS_OBJECT
+};
+
+// a car of the traffic as the instanced shaders see it: its model matrix and how bright its
+// headlights (x) and brake lights (y) glow
+struct CarInstance
+{
+    glm::mat4 model;
+    glm::vec4 lamps;
+};
+
+struct DrawItem
+{
+    SceneObject object;
+    glm::mat4 model;
+    // distance from the camera along the view direction
+    float depth;
+};
+
+// Everything the render thread needs to draw one frame, built by the simulation thread and not
+// modified after it was published.
+struct FramePacket
+{
+    unsigned long long index = 0;
+    // simulated seconds the frame shows
+    double time = 0.0;
+
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    // the shader variant is picked for these counts
+    std::vector<PointLight> pointLights;
+    std::vector<SpotLight> spotLights;
+
+    ShadingMode shading = PHONG_SHADING;
+    bool isDay = true;
+    bool isFogEnabled = false;
+
+    // visible objects, textured ones front to back, then the untextured surfaces and the light tags
+    std::vector<DrawItem> drawItems;
+    // model matrices of the visible light tag cubes, drawn by the LIGHT_TAGS_OBJECT item
+    std::vector<glm::mat4> lightTagModels;
+    // visible cars of the traffic, drawn by the TRAFFIC_OBJECT item
+    std::vector<CarInstance> carInstances;
+    unsigned int culledObjects = 0;
+
+    // cars simulated and the CPU time their steps for this frame took
+    unsigned int carsCount = 0;
+    double trafficMilliseconds = 0.0;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // sphere enclosing the points
+    static BoundingSphere FromPoints(const std::vector<glm::vec3>& points)
+    {
+        BoundingSphere sphere;
+        if (points.empty())
+            return sphere;
+
+        // center of the bounding box, not the tightest sphere but good enough for culling
+        glm::vec3 minimum = points[0];
+        glm::vec3 maximum = points[0];
+        for (const glm::vec3& point : points)
+        {
+            minimum = glm::min(minimum, point);
+            maximum = glm::max(maximum, point);
+        }
+        sphere.center = (minimum + maximum) * 0.5f;
+        for (const glm::vec3& point : points)
+            sphere.radius = std::max(sphere.radius, glm::length(point - sphere.center));
+        return sphere;
+    }
+
+    // sphere enclosing this one after the transformation, scaled by the longest axis
+    BoundingSphere Transformed(const glm::mat4& model) const
+    {
+        BoundingSphere sphere;
+        sphere.center = glm::vec3(model * glm::vec4(center, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        sphere.radius = radius * scale;
+        return sphere;
+    }
+};
+
+// view frustum planes extracted from a view-projection matrix (Gribb & Hartmann)
+class Frustum
+{
+public:
+    Frustum(const glm::mat4& viewProjection)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            glm::vec4 row = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+            glm::vec4 lastRow = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+            planes[i * 2] = lastRow + row;
+            planes[i * 2 + 1] = lastRow - row;
+        }
+
+        // normalized so the plane equation gives distances
+        for (glm::vec4& plane : planes)
+            plane = plane / glm::length(glm::vec3(plane));
+    }
+
+    // false only if the sphere is entirely outside of one of the planes
+    bool Intersects(const BoundingSphere& sphere) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    glm::vec4 planes[6];
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "GpuTimer.h"
+
+#include <iostream>
+
+GpuTimer::GpuTimer() : frame(0), isFrameStarted(false), isPassActive(false), hasResults(false), droppedFrames(0)
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+    for (FrameQueries& frameQueries : frames)
+    {
+        if (!frameQueries.queries.empty())
+            glDeleteQueries((GLsizei)frameQueries.queries.size(), frameQueries.queries.data());
+    }
+}
+
+void GpuTimer::BeginFrame()
+{
+    if (isPassActive)
+        EndPass();
+
+    if (isFrameStarted)
+        frame++;
+    isFrameStarted = true;
+
+    // the queries of this slot were issued FRAMES_IN_FLIGHT frames ago
+    FrameQueries& frameQueries = frames[frame % FRAMES_IN_FLIGHT];
+    if (frameQueries.passesCount > 0)
+        collectResults(frameQueries);
+
+    frameQueries.passesCount = 0;
+    frameQueries.frame = frame;
+}
+
+void GpuTimer::BeginPass(const char* name)
+{
+    if (isPassActive)
+    {
+        std::cout << "ERROR::GPU_TIMER::NESTED_PASS: " << name << std::endl;
+        return;
+    }
+
+    FrameQueries& frameQueries = frames[frame % FRAMES_IN_FLIGHT];
+    if (frameQueries.passesCount == frameQueries.queries.size())
+    {
+        unsigned int query;
+        glGenQueries(1, &query);
+        frameQueries.queries.push_back(query);
+        frameQueries.names.push_back(name);
+    }
+
+    frameQueries.names[frameQueries.passesCount] = name;
+    glBeginQuery(GL_TIME_ELAPSED, frameQueries.queries[frameQueries.passesCount]);
+    isPassActive = true;
+}
+
+void GpuTimer::EndPass()
+{
+    if (!isPassActive)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    frames[frame % FRAMES_IN_FLIGHT].passesCount++;
+    isPassActive = false;
+}
+
+void GpuTimer::collectResults(FrameQueries& frameQueries)
+{
+    // queries complete in order, so the last one being available means all of them are
+    int isAvailable = 0;
+    glGetQueryObjectiv(frameQueries.queries[frameQueries.passesCount - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable)
+    {
+        droppedFrames++;
+        return;
+    }
+
+    results.frame = frameQueries.frame;
+    results.totalMilliseconds = 0.0;
+    results.passes.clear();
+    for (unsigned int i = 0; i < frameQueries.passesCount; i++)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frameQueries.queries[i], GL_QUERY_RESULT, &elapsed);
+
+        GpuPassTime pass;
+        pass.name = frameQueries.names[i];
+        pass.milliseconds = elapsed / 1.0e6;
+        results.passes.push_back(pass);
+        results.totalMilliseconds += pass.milliseconds;
+    }
+    hasResults = true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct GpuPassTime
+{
+    const char* name;
+    double milliseconds;
+};
+
+// GPU time of every pass of one frame
+struct GpuFrameTimes
+{
+    unsigned int frame = 0;
+    double totalMilliseconds = 0.0;
+    std::vector<GpuPassTime> passes;
+};
+
+// Measures render passes with GL_TIME_ELAPSED queries. Every frame in flight has its own set of
+// query objects and a frame's results are only read when its queries are about to be reused,
+// so reading them never waits for the GPU. Passes can't be nested.
+class GpuTimer
+{
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // call at the start of every frame, picks up the results of the frame FRAMES_IN_FLIGHT ago
+    void BeginFrame();
+    // name must be a string literal, only the pointer is stored
+    void BeginPass(const char* name);
+    void EndPass();
+
+    // number of the frame being recorded, counted from 0
+    unsigned int GetFrame() const { return frame; }
+    bool HasResults() const { return hasResults; }
+    // timings of the latest frame whose results arrived
+    const GpuFrameTimes& GetResults() const { return results; }
+    // frames whose results weren't ready in time and were discarded
+    unsigned int GetDroppedFrames() const { return droppedFrames; }
+
+private:
+    struct FrameQueries
+    {
+        std::vector<unsigned int> queries;
+        std::vector<const char*> names;
+        unsigned int passesCount = 0;
+        unsigned int frame = 0;
+    };
+
+    FrameQueries frames[FRAMES_IN_FLIGHT];
+    unsigned int frame;
+    bool isFrameStarted;
+    bool isPassActive;
+    bool hasResults;
+    unsigned int droppedFrames;
+    GpuFrameTimes results;
+
+    void collectResults(FrameQueries& frameQueries);
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "InternedString.h"
+
+#include <mutex>
+#include <unordered_set>
+
+InternedString::InternedString() : text(intern(std::string()))
+{
+}
+
+InternedString::InternedString(const char* text) : text(intern(text))
+{
+}
+
+InternedString::InternedString(const std::string& text) : text(intern(text))
+{
+}
+
+const std::string* InternedString::intern(const std::string& text)
+{
+    // the set's nodes stay where they are when it grows, so the pointers handed out stay valid
+    static std::mutex mutex;
+    static std::unordered_set<std::string> strings;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return &*strings.insert(text).first;
+}
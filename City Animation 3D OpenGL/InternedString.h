@@ -0,0 +1,31 @@
+#pragma once
+#ifndef INTERNED_STRING_H
+#define INTERNED_STRING_H
+
+#include <string>
+
+// String stored once for the whole program: a copy is a pointer and equal strings compare by
+// address. Interning takes a lock, reading doesn't; the strings are never freed, so it suits the
+// few names used over and over, like texture types and paths.
+class InternedString
+{
+public:
+    // the empty string
+    InternedString();
+    InternedString(const char* text);
+    InternedString(const std::string& text);
+
+    const std::string& str() const { return *text; }
+    const char* c_str() const { return text->c_str(); }
+    bool empty() const { return text->empty(); }
+
+    bool operator==(InternedString other) const { return text == other.text; }
+    bool operator!=(InternedString other) const { return text != other.text; }
+
+private:
+    const std::string* text;
+
+    static const std::string* intern(const std::string& text);
+};
+
+#endif
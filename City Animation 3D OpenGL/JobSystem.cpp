@@ -0,0 +1,296 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <string>
+
+// the job system the calling thread works for and the index of its queue there
+static thread_local const JobSystem* currentJobSystem = NULL;
+static thread_local unsigned int currentQueueIndex = 0;
+
+JobSystem::JobSystem(unsigned int workersCount)
+    : mainThreadId(std::this_thread::get_id()), queuedJobs(0), queuedMainThreadJobs(0), queuedWorkerJobs(0), sleepingThreads(0), isStopping(false)
+{
+    if (workersCount == 0)
+        workersCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (unsigned int i = 0; i <= workersCount; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+    for (unsigned int i = 0; i < workersCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        isStopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter)
+{
+    if (counter != NULL)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    push({ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+{
+    if (counter != NULL)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+
+    // the count is read under the lock the finishing job takes before collecting the continuations,
+    // so the job is either stored before they are collected or queued here
+    {
+        std::lock_guard<std::mutex> lock(dependency.continuationsMutex);
+        if (!dependency.IsDone())
+        {
+            dependency.continuations.push_back({ std::move(job), counter });
+            return;
+        }
+    }
+    push({ std::move(job), counter });
+}
+
+void JobSystem::RunOnWorker(std::function<void()> job, JobCounter* counter)
+{
+    if (counter != NULL)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(workerQueue.mutex);
+        workerQueue.jobs.push_back({ std::move(job), counter });
+    }
+    queuedWorkerJobs.fetch_add(1);
+    // waking a single thread could wake one that isn't a worker
+    wakeSleepingThreads(true);
+}
+
+void JobSystem::RunOnMainThread(std::function<void()> job, JobCounter* counter)
+{
+    if (counter != NULL)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(mainThreadQueue.mutex);
+        mainThreadQueue.jobs.push_back({ std::move(job), counter });
+    }
+    queuedMainThreadJobs.fetch_add(1);
+    // the main thread may be asleep among the workers
+    wakeSleepingThreads(true);
+}
+
+void JobSystem::ExecuteMainThreadJobs()
+{
+    PROFILE_SCOPE("ExecuteMainThreadJobs");
+
+    while (tryRunMainThreadJob())
+    {
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    unsigned int queueIndex = getQueueIndex();
+    bool isMainThread = IsMainThread();
+    bool isWorker = queueIndex != 0;
+
+    while (!counter.IsDone())
+    {
+        if (isMainThread && tryRunMainThreadJob())
+            continue;
+        if (tryRunJob(queueIndex))
+            continue;
+
+        // nothing to help with, sleep until a job is queued or the counter drops to zero
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingThreads.fetch_add(1);
+        wake.wait(lock, [&] {
+            return counter.IsDone() || queuedJobs.load() > 0 || (isMainThread && queuedMainThreadJobs.load() > 0)
+                || (isWorker && queuedWorkerJobs.load() > 0);
+        });
+        sleepingThreads.fetch_sub(1);
+    }
+}
+
+void JobSystem::ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& function)
+{
+    grainSize = std::max(grainSize, (size_t)1);
+    if (end <= begin)
+        return;
+    if (end - begin <= grainSize || workers.empty())
+    {
+        function(begin, end);
+        return;
+    }
+
+    // the calling thread takes the first chunk itself, the rest is free to be stolen
+    JobCounter counter;
+    for (size_t chunkBegin = begin + grainSize; chunkBegin < end; chunkBegin += grainSize)
+    {
+        size_t chunkEnd = std::min(chunkBegin + grainSize, end);
+        Run([&function, chunkBegin, chunkEnd] { function(chunkBegin, chunkEnd); }, &counter);
+    }
+    function(begin, begin + grainSize);
+    Wait(counter);
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentJobSystem = this;
+    currentQueueIndex = index;
+    std::string name = "Job worker " + std::to_string(index);
+    PROFILE_THREAD(name.c_str());
+
+    while (true)
+    {
+        if (tryRunJob(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (isStopping && queuedJobs.load() == 0 && queuedWorkerJobs.load() == 0)
+            break;
+        sleepingThreads.fetch_add(1);
+        wake.wait(lock, [this] { return isStopping || queuedJobs.load() > 0 || queuedWorkerJobs.load() > 0; });
+        sleepingThreads.fetch_sub(1);
+    }
+}
+
+unsigned int JobSystem::getQueueIndex() const
+{
+    return currentJobSystem == this ? currentQueueIndex : 0;
+}
+
+void JobSystem::push(Job job)
+{
+    WorkQueue& queue = *queues[getQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    queuedJobs.fetch_add(1);
+    wakeSleepingThreads(false);
+}
+
+bool JobSystem::tryRunJob(unsigned int queueIndex)
+{
+    Job job;
+    bool isFound = false;
+
+    // own queue newest first, the jobs just queued are the likeliest to have their data in the cache
+    {
+        WorkQueue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            isFound = true;
+        }
+    }
+
+    // otherwise steal the oldest job of the next queue that has one
+    for (size_t i = 1; i < queues.size() && !isFound; i++)
+    {
+        WorkQueue& queue = *queues[(queueIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            isFound = true;
+        }
+    }
+
+    // the jobs only workers may run come last, the short ones queued by others shouldn't wait for them
+    bool isWorkerJob = false;
+    if (!isFound && queueIndex != 0)
+    {
+        std::lock_guard<std::mutex> lock(workerQueue.mutex);
+        if (!workerQueue.jobs.empty())
+        {
+            job = std::move(workerQueue.jobs.front());
+            workerQueue.jobs.pop_front();
+            isFound = isWorkerJob = true;
+        }
+    }
+
+    if (!isFound)
+        return false;
+
+    (isWorkerJob ? queuedWorkerJobs : queuedJobs).fetch_sub(1);
+    execute(job);
+    return true;
+}
+
+bool JobSystem::tryRunMainThreadJob()
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mainThreadQueue.mutex);
+        if (mainThreadQueue.jobs.empty())
+            return false;
+        job = std::move(mainThreadQueue.jobs.front());
+        mainThreadQueue.jobs.pop_front();
+    }
+
+    queuedMainThreadJobs.fetch_sub(1);
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(Job& job)
+{
+    job.function();
+    // free what the job captured before its counter says it finished
+    job.function = nullptr;
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+    if (counter == NULL)
+        return;
+
+    // only the decrement to zero takes the lock, the counter may be destroyed as soon as it's released
+    int count = counter->count.load();
+    while (count > 1)
+    {
+        if (counter->count.compare_exchange_weak(count, count - 1))
+            return;
+    }
+
+    std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationsMutex);
+        if (counter->count.fetch_sub(1) != 1)
+            return;
+        continuations.swap(counter->continuations);
+    }
+    for (auto& continuation : continuations)
+        push({ std::move(continuation.first), continuation.second });
+
+    // threads waiting for the counter may be asleep
+    wakeSleepingThreads(true);
+}
+
+void JobSystem::wakeSleepingThreads(bool isAll)
+{
+    // the sleeper counts itself before checking for work and the pusher counts the work before
+    // checking for sleepers, so one of them always sees the other
+    if (sleepingThreads.load() == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    if (isAll)
+        wake.notify_all();
+    else
+        wake.notify_one();
+}
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counts the unfinished jobs of a group. Waiting for it and continuations scheduled after it are
+// handled by the JobSystem; a counter must outlive the jobs it counts.
+class JobCounter
+{
+public:
+    JobCounter() : count(0) {}
+    // the last job may still be collecting the continuations after the count dropped to zero
+    ~JobCounter() { std::lock_guard<std::mutex> lock(continuationsMutex); }
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return count.load() == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> count;
+    // jobs queued once the count drops to zero, with the counters they are counted by
+    std::mutex continuationsMutex;
+    std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+};
+
+// Work-stealing job scheduler. Every worker runs the jobs it queued itself newest first and steals
+// the oldest ones from the others when it runs out; threads that aren't workers share one more queue.
+// Jobs that need the OpenGL context go to a separate queue only the main thread runs, long jobs that
+// wait for the main thread to another one only the workers run. A thread waiting for a counter keeps
+// running jobs instead of blocking, so jobs may wait for other jobs.
+class JobSystem
+{
+public:
+    // 0 uses one worker less than there are hardware threads, the main thread is the last one;
+    // must be created on the main thread
+    JobSystem(unsigned int workersCount = 0);
+    // finishes the queued jobs, except the main thread ones, and stops the workers
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int GetWorkersCount() const { return (unsigned int)workers.size(); }
+    bool IsMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+
+    // counter, if given, is increased now and decreased when the job finished
+    void Run(std::function<void()> job, JobCounter* counter = NULL);
+    // queues the job once dependency drops to zero, right away if it already is
+    void RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = NULL);
+    // queues the job for the workers alone, so it never runs inside another thread's Wait; for jobs
+    // queued by the render or simulation thread that wait for main thread jobs or take long, like loads
+    void RunOnWorker(std::function<void()> job, JobCounter* counter = NULL);
+    // queues the job for the main thread, it runs in ExecuteMainThreadJobs or while the main thread waits
+    void RunOnMainThread(std::function<void()> job, JobCounter* counter = NULL);
+    // main thread: runs every main thread job queued so far
+    void ExecuteMainThreadJobs();
+
+    // runs other jobs until the counter drops to zero
+    void Wait(JobCounter& counter);
+    // calls function(chunkBegin, chunkEnd) for chunks of at most grainSize indices spread over the
+    // workers and the calling thread, returns once all of them finished
+    void ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& function);
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    // owner takes from the back, thieves from the front
+    struct alignas(64) WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // [0] is shared by the threads that aren't workers, [i + 1] belongs to worker i
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    WorkQueue mainThreadQueue;
+    WorkQueue workerQueue;
+    std::vector<std::thread> workers;
+    std::thread::id mainThreadId;
+
+    // jobs waiting in the work queues, in the main thread queue and in the worker queue
+    std::atomic<int> queuedJobs;
+    std::atomic<int> queuedMainThreadJobs;
+    std::atomic<int> queuedWorkerJobs;
+    // threads sleep only when there is nothing to run, pushing threads wake them
+    std::atomic<int> sleepingThreads;
+    std::atomic<bool> isStopping;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    void workerLoop(unsigned int index);
+    unsigned int getQueueIndex() const;
+    void push(Job job);
+    bool tryRunJob(unsigned int queueIndex);
+    bool tryRunMainThreadJob();
+    void execute(Job& job);
+    void finish(JobCounter* counter);
+    void wakeSleepingThreads(bool isAll);
+};
+
+#endif
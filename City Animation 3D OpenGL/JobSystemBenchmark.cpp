@@ -0,0 +1,108 @@
+#include "JobSystemBenchmark.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+const unsigned int EMPTY_JOBS_COUNT = 200000;
+const unsigned int CHAIN_LENGTH = 20000;
+const size_t LOOP_SIZE = 1 << 22;
+const unsigned int REPEATS = 5;
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// best of a few runs, the first ones also pay for waking the workers and warming the caches
+template <typename Function>
+static double bestTime(Function function)
+{
+    double best = 1.0e30;
+    for (unsigned int i = 0; i < REPEATS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+// enough arithmetic per element to make the loop compute bound
+static float kernel(size_t i)
+{
+    float x = (float)(i & 1023) / 1024.0f;
+    float value = 0.0f;
+    for (int j = 0; j < 16; j++)
+        value += std::sqrt(x * j + 1.0f) * std::sin(x + j);
+    return value;
+}
+
+void JobSystemBenchmark::Run(std::ostream& stream)
+{
+    std::vector<float> output(LOOP_SIZE);
+
+    // single threaded reference for the speedup
+    double serialTime = bestTime([&output] {
+        for (size_t i = 0; i < LOOP_SIZE; i++)
+            output[i] = kernel(i);
+    });
+
+    stream << std::fixed << std::setprecision(1);
+    stream << "serial loop: " << serialTime * 1000.0 << " ms for " << LOOP_SIZE << " elements\n\n";
+    stream << std::setw(8) << "workers" << std::setw(16) << "ns/empty job" << std::setw(16) << "ns/chain link"
+        << std::setw(16) << "ns/for chunk" << std::setw(14) << "loop ms" << std::setw(10) << "speedup" << "\n";
+
+    unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    for (unsigned int workersCount = 1; workersCount < hardwareThreads * 2; workersCount *= 2)
+    {
+        unsigned int workers = std::min(workersCount, hardwareThreads - 1);
+        JobSystem jobs(workers);
+
+        // queuing and running jobs that do nothing, from the main thread
+        double emptyTime = bestTime([&jobs] {
+            JobCounter counter;
+            for (unsigned int i = 0; i < EMPTY_JOBS_COUNT; i++)
+                jobs.Run([] {}, &counter);
+            jobs.Wait(counter);
+        });
+
+        // every link is a continuation of the previous one, so they can't overlap
+        double chainTime = bestTime([&jobs] {
+            std::vector<JobCounter> links(CHAIN_LENGTH);
+            jobs.Run([] {}, &links[0]);
+            for (unsigned int i = 1; i < CHAIN_LENGTH; i++)
+                jobs.RunAfter(links[i - 1], [] {}, &links[i]);
+            jobs.Wait(links[CHAIN_LENGTH - 1]);
+        });
+
+        // one index per chunk measures the overhead of splitting a loop
+        double chunkTime = bestTime([&jobs] {
+            std::vector<unsigned int> counts(EMPTY_JOBS_COUNT);
+            jobs.ParallelFor(0, EMPTY_JOBS_COUNT, 1, [&counts](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    counts[i]++;
+            });
+        });
+
+        double loopTime = bestTime([&jobs, &output] {
+            jobs.ParallelFor(0, LOOP_SIZE, 4096, [&output](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    output[i] = kernel(i);
+            });
+        });
+
+        stream << std::setw(8) << workers
+            << std::setw(16) << emptyTime * 1.0e9 / EMPTY_JOBS_COUNT
+            << std::setw(16) << chainTime * 1.0e9 / CHAIN_LENGTH
+            << std::setw(16) << chunkTime * 1.0e9 / EMPTY_JOBS_COUNT
+            << std::setw(14) << loopTime * 1000.0
+            << std::setw(10) << std::setprecision(2) << serialTime / loopTime << std::setprecision(1) << "\n";
+
+        if (workers == hardwareThreads - 1)
+            break;
+    }
+}
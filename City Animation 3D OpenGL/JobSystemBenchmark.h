@@ -0,0 +1,16 @@
+#pragma once
+#ifndef JOB_SYSTEM_BENCHMARK_H
+#define JOB_SYSTEM_BENCHMARK_H
+
+#include <ostream>
+
+// Micro-benchmarks of the job system: the cost of queuing and running a job, of a chain of
+// continuations and of a parallel loop, and how a compute-bound loop scales with the workers.
+class JobSystemBenchmark
+{
+public:
+    // runs every benchmark for 1, 2, 4, ... workers up to the hardware threads and prints a table
+    static void Run(std::ostream& stream);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "Lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+// the format ends a block with literals: a match ends at least LAST_LITERALS bytes before the end
+// and starts at least MATCH_FIND_LIMIT bytes before it
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_FIND_LIMIT = 12;
+const unsigned int HASH_BITS = 16;
+// every 2^SKIP_STRENGTH bytes without a match the search takes longer steps, so data that doesn't
+// compress is passed over quickly
+const unsigned int SKIP_STRENGTH = 6;
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// a length of 15 or more in a token continues in bytes of 255 and a last one below it
+static bool writeLength(unsigned char*& out, const unsigned char* outEnd, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (out >= outEnd)
+            return false;
+        *out++ = 255;
+    }
+    if (out >= outEnd)
+        return false;
+    *out++ = (unsigned char)length;
+    return true;
+}
+
+// a sequence without a match is the last one of a block
+static bool writeSequence(unsigned char*& out, const unsigned char* outEnd, const unsigned char* literals, size_t literalsLength,
+    size_t offset, size_t matchLength)
+{
+    if (out >= outEnd)
+        return false;
+    unsigned char* token = out++;
+    *token = (unsigned char)((literalsLength < 15 ? literalsLength : 15) << 4);
+    if (literalsLength >= 15 && !writeLength(out, outEnd, literalsLength - 15))
+        return false;
+    if ((size_t)(outEnd - out) < literalsLength)
+        return false;
+    memcpy(out, literals, literalsLength);
+    out += literalsLength;
+    if (matchLength == 0)
+        return true;
+
+    if (outEnd - out < 2)
+        return false;
+    *out++ = (unsigned char)(offset & 0xFF);
+    *out++ = (unsigned char)(offset >> 8);
+    size_t length = matchLength - MIN_MATCH;
+    *token |= (unsigned char)(length < 15 ? length : 15);
+    return length < 15 || writeLength(out, outEnd, length - 15);
+}
+
+size_t Lz4::CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t Lz4::Compress(const char* source, size_t size, char* destination, size_t capacity)
+{
+    const unsigned char* in = (const unsigned char*)source;
+    unsigned char* out = (unsigned char*)destination;
+    const unsigned char* outEnd = out + capacity;
+
+    size_t anchor = 0;
+    if (size >= MATCH_FIND_LIMIT)
+    {
+        // positions of the last sequences seen with each hash, a stale or colliding one fails the comparison
+        std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+        size_t matchLimit = size - LAST_LITERALS;
+        size_t position = 0;
+        while (position + MATCH_FIND_LIMIT <= size)
+        {
+            uint32_t sequence = read32(in + position);
+            uint32_t& entry = table[hash(sequence)];
+            size_t candidate = entry;
+            entry = (uint32_t)position;
+            if (candidate >= position || position - candidate > MAX_OFFSET || read32(in + candidate) != sequence)
+            {
+                position += 1 + ((position - anchor) >> SKIP_STRENGTH);
+                continue;
+            }
+
+            // the match may start before the sequence that found it
+            while (position > anchor && candidate > 0 && in[position - 1] == in[candidate - 1])
+            {
+                position--;
+                candidate--;
+            }
+            size_t matchLength = MIN_MATCH;
+            while (position + matchLength < matchLimit && in[position + matchLength] == in[candidate + matchLength])
+                matchLength++;
+
+            if (!writeSequence(out, outEnd, in + anchor, position - anchor, position - candidate, matchLength))
+                return 0;
+            position += matchLength;
+            anchor = position;
+        }
+    }
+
+    if (!writeSequence(out, outEnd, in + anchor, size - anchor, 0, 0))
+        return 0;
+    return out - (unsigned char*)destination;
+}
+
+bool Lz4::Decompress(const char* source, size_t sourceSize, char* destination, size_t size)
+{
+    const unsigned char* in = (const unsigned char*)source;
+    const unsigned char* inEnd = in + sourceSize;
+    unsigned char* out = (unsigned char*)destination;
+    unsigned char* outEnd = out + size;
+
+    auto readLength = [&in, inEnd](size_t& length) {
+        unsigned char byte;
+        do
+        {
+            if (in >= inEnd)
+                return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < inEnd)
+    {
+        unsigned char token = *in++;
+        size_t literalsLength = token >> 4;
+        if (literalsLength == 15 && !readLength(literalsLength))
+            return false;
+        if (literalsLength > (size_t)(inEnd - in) || literalsLength > (size_t)(outEnd - out))
+            return false;
+        memcpy(out, in, literalsLength);
+        in += literalsLength;
+        out += literalsLength;
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - (unsigned char*)destination))
+            return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > (size_t)(outEnd - out))
+            return false;
+
+        // an offset shorter than the match repeats the bytes it has just written
+        const unsigned char* match = out - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(out, match, matchLength);
+            out += matchLength;
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; i++)
+                *out++ = match[i];
+        }
+    }
+    return out == outEnd;
+}
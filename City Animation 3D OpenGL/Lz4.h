@@ -0,0 +1,26 @@
+#pragma once
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+
+// Compressor and decompressor of the LZ4 block format: sequences of literals copied as they are and
+// matches copied from at most 64 KB back. The compressor takes the first match its hash table finds,
+// so it's fast rather than tight; the decompressor checks every length and offset against both
+// buffers, a damaged block fails instead of reading or writing out of bounds.
+class Lz4
+{
+public:
+    // no block decompresses to more than MAX_RATIO times its compressed size: a match of any length
+    // takes at least a byte per 255 of it
+    static const size_t MAX_RATIO = 255;
+
+    // room the compressed block of size bytes takes in the worst case
+    static size_t CompressBound(size_t size);
+    // size of the compressed block, 0 if it doesn't fit into capacity
+    static size_t Compress(const char* source, size_t size, char* destination, size_t capacity);
+    // false unless the block decompresses to exactly size bytes
+    static bool Decompress(const char* source, size_t sourceSize, char* destination, size_t size);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data(NULL), size(0), isOpen(false), file(INVALID_HANDLE_VALUE), mapping(NULL)
+{
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        Close();
+        return false;
+    }
+    size = (size_t)fileSize.QuadPart;
+    isOpen = true;
+    if (size == 0)
+        return true;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+        data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != NULL)
+        UnmapViewOfFile(data);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    data = NULL;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+    size = 0;
+    isOpen = false;
+}
+
+#else
+
+MappedFile::MappedFile() : data(NULL), size(0), isOpen(false)
+{
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(file);
+        return false;
+    }
+    size = (size_t)status.st_size;
+    isOpen = true;
+
+    // the mapping keeps the file open by itself
+    if (size > 0)
+    {
+        void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view == MAP_FAILED)
+        {
+            close(file);
+            size = 0;
+            isOpen = false;
+            return false;
+        }
+        madvise(view, size, MADV_SEQUENTIAL);
+        data = (const char*)view;
+    }
+    close(file);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != NULL)
+        munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+    isOpen = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped into memory, the pages are read by the system as they're
+// touched; any thread may read the view while it's open.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps the file, false if it can't be opened; an empty file opens with no data
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return isOpen; }
+    const char* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+    const char* data;
+    size_t size;
+    bool isOpen;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#endif
+};
+
+#endif
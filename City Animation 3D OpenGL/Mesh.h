@@ -10,6 +10,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.h"
+#include "RenderStats.h"
+#include "InternedString.h"
 
 #include <string>
 #include <vector>
@@ -38,31 +40,157 @@ struct Vertex {
 
 struct Texture {
     unsigned int id;
-    string type;
-    string path;
+    InternedString type;
+    InternedString path;
 };
 
+// Mesh owning its OpenGL objects, so it can be moved but not copied. The vertices and indices are
+// dropped once they're in the buffers, unless the mesh is asked to retain them for reading them on
+// the CPU (collision, picking).
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, empty after the upload unless retained
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    unsigned int VAO = 0;
+    // the same vertices with per-instance attributes, created by the first instanced draw
+    unsigned int instancedVAO = 0;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes over the vertices and indices
+    Mesh(vector<Vertex>&& vertices, vector<unsigned int>&& indices, vector<Texture> textures, bool retainData = false)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        vertexCount = this->vertices.size();
+        indexCount = this->indices.size();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->indices.data());
+
+        if (!retainData)
+        {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
+    }
+
+    // constructor, uploads vertices and indices owned by someone else and copies them only if retained
+    Mesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, vector<Texture> textures, bool retainData = false)
+        : textures(std::move(textures))
+    {
+        this->vertexCount = vertexCount;
+        this->indexCount = indexCount;
+        setupMesh(vertices, indices);
+
+        if (retainData)
+        {
+            this->vertices.assign(vertices, vertices + vertexCount);
+            this->indices.assign(indices, indices + indexCount);
+        }
+    }
+
+    // deletes the OpenGL objects, needs the context
+    ~Mesh()
+    {
+        DeleteBuffers();
+    }
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept
+    {
+        if (this != &other)
+        {
+            DeleteBuffers();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            VAO = other.VAO;
+            instancedVAO = other.instancedVAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            vertexCount = other.vertexCount;
+            indexCount = other.indexCount;
+            other.VAO = other.instancedVAO = other.VBO = other.EBO = 0;
+        }
+        return *this;
     }
 
+    bool HasData() const { return !vertices.empty(); }
+    // bytes of the retained vertices and indices
+    size_t GetCpuBytes() const { return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int); }
+    // bytes of the vertex and element buffers
+    size_t GetGpuBytes() const { return vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int); }
+
     // render the mesh
     void Draw(Shader& shader)
+    {
+        bindTextures(shader);
+
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+        renderStats.vertexArrayBinds++;
+        renderStats.AddDraw(indexCount / 3);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // render count instances of the mesh with one draw; every instance has a model matrix
+    // (locations 7 to 10) followed by a vec4 (location 11), read from buffer starting at offset,
+    // stride bytes apart
+    void DrawInstanced(Shader& shader, unsigned int count, unsigned int buffer, size_t offset, size_t stride)
+    {
+        bindTextures(shader);
+
+        if (instancedVAO == 0)
+            setupInstancedVAO();
+
+        // the instances move through a ring of regions, so their attributes are pointed at the current one
+        glBindVertexArray(instancedVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (int column = 0; column < 4; column++)
+            glVertexAttribPointer(7 + column, 4, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribPointer(11, 4, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(offset + sizeof(glm::mat4)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0, count);
+        glBindVertexArray(0);
+        renderStats.vertexArrayBinds++;
+        renderStats.AddDraw(indexCount / 3 * count);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // deletes the OpenGL objects, the mesh can't be drawn afterwards
+    void DeleteBuffers()
+    {
+        if (VAO == 0)
+            return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        if (instancedVAO != 0)
+            glDeleteVertexArrays(1, &instancedVAO);
+        VAO = VBO = EBO = instancedVAO = 0;
+    }
+
+private:
+    // render data 
+    unsigned int VBO = 0, EBO = 0;
+    // counts of the uploaded data, which the vectors no longer hold
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    void bindTextures(Shader& shader)
     {
         // bind appropriate textures
         unsigned int diffuseNr = 1;
@@ -74,7 +202,7 @@ public:
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            const string& name = textures[i].type.str();
             if (name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if (name == "texture_specular")
@@ -88,23 +216,12 @@ public:
             glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            renderStats.textureBinds++;
         }
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertices, const unsigned int* indices)
     {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
@@ -117,11 +234,35 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
+        setupVertexAttributes();
+        glBindVertexArray(0);
+    }
+
+    // the second vertex array, the instance attributes advance once per instance
+    void setupInstancedVAO()
+    {
+        glGenVertexArrays(1, &instancedVAO);
+        glBindVertexArray(instancedVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        setupVertexAttributes();
+
+        for (int location = 7; location <= 11; location++)
+        {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    // the attributes of the vertex buffer bound to GL_ARRAY_BUFFER, for the bound vertex array
+    void setupVertexAttributes()
+    {
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
@@ -145,7 +286,6 @@ private:
         // weights
         glEnableVertexAttribArray(6);
         glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
     }
 };
 
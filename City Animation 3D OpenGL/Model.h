@@ -15,7 +15,16 @@
 #include "stb_image.h"
 #include "Mesh.h"
 #include "Shader.h"
+#include "Profiler.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "Arena.h"
+#include "InternedString.h"
+#include "ObjLoader.h"
+#include "ResourcePack.h"
 
+#include <algorithm>
+#include <cctype>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -24,7 +33,21 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+// image decoded by stb_image, data is NULL if the file failed to load
+struct TextureImage
+{
+    unsigned char* data = NULL;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+};
+
+// inline, every translation unit loading models includes the header
+inline unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+// only reads the file, from the mounted ResourcePack if it has it; may be called from any thread
+inline TextureImage DecodeTexture(const char* path, const string& directory);
+// creates the OpenGL texture and frees the image's data
+inline unsigned int UploadTexture(TextureImage& image, const char* path);
 
 class Model
 {
@@ -32,15 +55,35 @@ public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    // whether the meshes keep their vertices and indices for the CPU after the upload
+    bool retainMeshData;
+    // model space sphere around every vertex, for culling
+    BoundingSphere Bounds;
+    // bytes of the vertices and indices the meshes keep, and of their buffers and the textures on the GPU
+    size_t CpuBytes = 0;
+    size_t GpuBytes = 0;
+
+    // constructor, expects a filepath to a 3D model. With a job system the meshes are converted and the
+    // textures decoded on its workers, the OpenGL objects are created on the main thread in any case.
+    Model(string const& path, JobSystem* jobs = NULL, bool gamma = false, bool retainMeshData = false)
+        : path(path), gammaCorrection(gamma), retainMeshData(retainMeshData)
+    {
+        loadModel(path, jobs);
+    }
 
-    // constructor, expects a filepath to a 3D model.
-    Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
+    // deletes the OpenGL objects of the textures, the meshes delete their own; on the main thread
+    ~Model()
     {
-        loadModel(path);
+        for (const Texture& texture : textures_loaded)
+            glDeleteTextures(1, &texture.id);
     }
 
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
     // draws the model, and thus all its meshes
     void Draw(Shader& shader)
     {
@@ -48,9 +91,155 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // draws count instances of the model with one draw per mesh, see Mesh::DrawInstanced
+    void DrawInstanced(Shader& shader, unsigned int count, unsigned int buffer, size_t offset, size_t stride)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, count, buffer, offset, stride);
+    }
+
+    // one line with the memory the model takes on the CPU and on the GPU
+    void PrintMemoryReport(ostream& out) const
+    {
+        out << "MODEL::MEMORY: " << path << ": " << meshes.size() << " meshes, " << textures_loaded.size() << " textures, "
+            << CpuBytes / 1024 << " KB CPU, " << GpuBytes / 1024 << " KB GPU" << endl;
+    }
+
+    // converts the meshes of a model file into the arena without touching OpenGL, with the textures
+    // of every material they use; Wavefront OBJ files are read by ObjLoader unless useAssimp is set,
+    // any other format by ASSIMP
+    static bool ImportMeshes(string const& path, JobSystem* jobs, Arena& arena, vector<ImportedMesh>& meshes,
+        vector<vector<MaterialTexture>>& materialTextures, bool useAssimp = false)
+    {
+        size_t dot = path.find_last_of('.');
+        string extension = dot == string::npos ? "" : path.substr(dot);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+        if (extension == ".obj" && !useAssimp)
+            return ObjLoader::Load(path, jobs, arena, meshes, materialTextures);
+        return importWithAssimp(path, jobs, arena, meshes, materialTextures);
+    }
+
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const& path)
+    void loadModel(string const& path, JobSystem* jobs)
+    {
+        PROFILE_SCOPE("Model::loadModel");
+
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // the converted vertices and indices only live until they're uploaded, so they're all put in
+        // one arena and freed at once when the import is done
+        Arena arena;
+        vector<ImportedMesh> meshData;
+        vector<vector<MaterialTexture>> materialTextures;
+        if (!ImportMeshes(path, jobs, arena, meshData, materialTextures))
+            return;
+        size_t totalVertices = 0;
+        for (const ImportedMesh& mesh : meshData)
+            totalVertices += mesh.verticesCount;
+
+        // every texture is decoded once, the type it's first used as is the one stored in textures_loaded
+        vector<MaterialTexture> uniqueTextures;
+        for (const ImportedMesh& mesh : meshData)
+        {
+            for (const MaterialTexture& texture : materialTextures[mesh.material])
+            {
+                auto isSamePath = [&texture](const MaterialTexture& loaded) { return loaded.path == texture.path; };
+                if (std::find_if(uniqueTextures.begin(), uniqueTextures.end(), isSamePath) == uniqueTextures.end())
+                    uniqueTextures.push_back(texture);
+            }
+        }
+
+        vector<TextureImage> images(uniqueTextures.size());
+        parallelFor(jobs, uniqueTextures.size(), [&](size_t i) { images[i] = DecodeTexture(uniqueTextures[i].path.c_str(), directory); });
+
+        // the mipmaps add a third to every texture
+        for (const TextureImage& image : images)
+            GpuBytes += (size_t)image.width * image.height * image.components * 4 / 3;
+
+        // the bounds are taken before the meshes take over the vertices
+        vector<glm::vec3> positions;
+        positions.reserve(totalVertices);
+        for (const ImportedMesh& mesh : meshData)
+        {
+            for (size_t i = 0; i < mesh.verticesCount; i++)
+                positions.push_back(mesh.vertices[i].Position);
+        }
+        Bounds = BoundingSphere::FromPoints(positions);
+
+        // OpenGL objects can only be created on the main thread
+        runOnMainThread(jobs, [&]() {
+            for (size_t i = 0; i < uniqueTextures.size(); i++)
+            {
+                Texture texture;
+                texture.id = UploadTexture(images[i], uniqueTextures[i].path.c_str());
+                texture.type = uniqueTextures[i].type;
+                texture.path = uniqueTextures[i].path;
+                textures_loaded.push_back(texture);
+            }
+
+            // the loaded textures of every material, copied into each of its meshes
+            vector<vector<Texture>> loadedMaterialTextures(materialTextures.size());
+            for (size_t i = 0; i < materialTextures.size(); i++)
+            {
+                for (const MaterialTexture& materialTexture : materialTextures[i])
+                {
+                    for (const Texture& texture : textures_loaded)
+                    {
+                        if (texture.path == materialTexture.path)
+                        {
+                            loadedMaterialTextures[i].push_back(texture);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            meshes.reserve(meshData.size());
+            for (const ImportedMesh& mesh : meshData)
+                meshes.emplace_back(mesh.vertices, mesh.verticesCount, mesh.indices, mesh.indicesCount, loadedMaterialTextures[mesh.material], retainMeshData);
+        });
+
+        for (const Mesh& mesh : meshes)
+        {
+            CpuBytes += mesh.GetCpuBytes();
+            GpuBytes += mesh.GetGpuBytes();
+        }
+    }
+
+    // calls function(i) for every i below count, spread over the workers if there are any
+    static void parallelFor(JobSystem* jobs, size_t count, const std::function<void(size_t)>& function)
+    {
+        if (jobs == NULL)
+        {
+            for (size_t i = 0; i < count; i++)
+                function(i);
+            return;
+        }
+
+        jobs->ParallelFor(0, count, 1, [&function](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                function(i);
+        });
+    }
+
+    static void runOnMainThread(JobSystem* jobs, const std::function<void()>& function)
+    {
+        if (jobs == NULL || jobs->IsMainThread())
+        {
+            function();
+            return;
+        }
+
+        JobCounter counter;
+        jobs->RunOnMainThread(function, &counter);
+        jobs->Wait(counter);
+    }
+
+    // reads the file via ASSIMP and converts its meshes into storage sized from ASSIMP's counts
+    static bool importWithAssimp(string const& path, JobSystem* jobs, Arena& arena, vector<ImportedMesh>& meshes,
+        vector<vector<MaterialTexture>>& materialTextures)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -59,40 +248,57 @@ private:
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<aiMesh*> sceneMeshes;
+        processNode(scene->mRootNode, scene, sceneMeshes);
+
+        // the workers only fill the storage allocated here
+        size_t firstMesh = meshes.size();
+        meshes.resize(firstMesh + sceneMeshes.size());
+        for (size_t i = 0; i < sceneMeshes.size(); i++)
+        {
+            // triangulated faces have at most three indices, points and lines fewer
+            ImportedMesh& mesh = meshes[firstMesh + i];
+            mesh.vertices = arena.AllocateArray<Vertex>(sceneMeshes[i]->mNumVertices);
+            mesh.indices = arena.AllocateArray<unsigned int>((size_t)sceneMeshes[i]->mNumFaces * 3);
+            mesh.material = sceneMeshes[i]->mMaterialIndex;
+        }
+        parallelFor(jobs, sceneMeshes.size(), [&](size_t i) { processMesh(sceneMeshes[i], meshes[firstMesh + i]); });
+
+        // the textures of every material are collected once, not per mesh using it
+        materialTextures.assign(scene->mNumMaterials, vector<MaterialTexture>());
+        for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+            processMaterial(scene->mMaterials[i], materialTextures[i]);
+        return true;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene)
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    static void processNode(aiNode* node, const aiScene* scene, vector<aiMesh*>& sceneMeshes)
     {
-        // process each mesh located at the current node
+        // collect each mesh located at the current node
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, sceneMeshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    // converts the mesh into its preallocated storage without touching OpenGL, so meshes can be processed in parallel
+    static void processMesh(aiMesh* mesh, ImportedMesh& data)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        Vertex* vertices = data.vertices;
+        unsigned int* indices = data.indices;
 
         // walk through each of the mesh's vertices
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -135,18 +341,22 @@ private:
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
-            vertices.push_back(vertex);
+            vertices[i] = vertex;
         }
+        data.verticesCount = mesh->mNumVertices;
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
             aiFace face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+                indices[data.indicesCount++] = face.mIndices[j];
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    }
+
+    // collects the textures of a material
+    static void processMaterial(aiMaterial* material, vector<MaterialTexture>& textures)
+    {
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
         // Same applies to other texture as the following list summarizes:
@@ -155,79 +365,68 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+    // adds the type and path of all material textures of a given type, they're loaded once all meshes are processed.
+    static void collectMaterialTextures(aiMaterial* mat, aiTextureType type, InternedString typeName, vector<MaterialTexture>& textures)
     {
-        vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            textures.push_back({ typeName, InternedString(str.C_Str()) });
         }
-        return textures;
     }
 };
 
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+inline unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+{
+    TextureImage image = DecodeTexture(path, directory);
+    return UploadTexture(image, path);
+}
+
+inline TextureImage DecodeTexture(const char* path, const string& directory)
 {
+    PROFILE_SCOPE("DecodeTexture");
+
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    TextureImage image;
+    ResourceFile file;
+    if (file.Open(filename))
+        image.data = stbi_load_from_memory((const stbi_uc*)file.GetData(), (int)file.GetSize(), &image.width, &image.height, &image.components, 0);
+    return image;
+}
+
+inline unsigned int UploadTexture(TextureImage& image, const char* path)
+{
+    PROFILE_SCOPE("UploadTexture");
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char* data = image.data;
     if (data)
     {
         GLenum format;
-        if (nrComponents == 1)
+        if (image.components == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (image.components == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (image.components == 4)
             format = GL_RGBA;
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -242,6 +441,7 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
         std::cout << "Texture failed to load at path: " << path << std::endl;
         stbi_image_free(data);
     }
+    image.data = NULL;
 
     return textureID;
 }
@@ -0,0 +1,92 @@
+#include "ObjBenchmark.h"
+#include "Model.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+const char* const MODEL_PATHS[] = {
+    "Resources/Car/car.obj",
+    "Resources/City/city.obj",
+    "Resources/Lantern/Lantern.obj",
+    "Resources/Spotlight/spotlight.obj"
+};
+const unsigned int REPEATS = 3;
+// largest accepted distance between the bounds of the two imports, relative to their radius
+const float BOUNDS_TOLERANCE = 1.0e-4f;
+
+// what a comparison of two imports looks at
+struct ImportSummary
+{
+    double seconds = 1.0e30;
+    size_t meshesCount = 0;
+    size_t verticesCount = 0;
+    size_t indicesCount = 0;
+    BoundingSphere bounds;
+};
+
+static bool import(const char* path, JobSystem& jobs, bool useAssimp, ImportSummary& summary)
+{
+    for (unsigned int i = 0; i < REPEATS; i++)
+    {
+        Arena arena;
+        vector<ImportedMesh> meshes;
+        vector<vector<MaterialTexture>> materialTextures;
+        auto start = std::chrono::steady_clock::now();
+        if (!Model::ImportMeshes(path, &jobs, arena, meshes, materialTextures, useAssimp))
+            return false;
+        summary.seconds = std::min(summary.seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        if (i + 1 < REPEATS)
+            continue;
+        vector<glm::vec3> positions;
+        summary.meshesCount = meshes.size();
+        for (const ImportedMesh& mesh : meshes)
+        {
+            summary.verticesCount += mesh.verticesCount;
+            summary.indicesCount += mesh.indicesCount;
+            for (size_t j = 0; j < mesh.verticesCount; j++)
+                positions.push_back(mesh.vertices[j].Position);
+        }
+        summary.bounds = BoundingSphere::FromPoints(positions);
+    }
+    return true;
+}
+
+bool ObjBenchmark::Run(std::ostream& stream)
+{
+    JobSystem jobs;
+    stream << std::setw(36) << std::left << "model" << std::right << std::setw(10) << "vertices" << std::setw(8) << "meshes"
+        << std::setw(12) << "assimp ms" << std::setw(8) << "meshes" << std::setw(12) << "obj ms" << std::setw(10) << "speedup" << "\n";
+
+    bool isMatching = true;
+    for (const char* path : MODEL_PATHS)
+    {
+        if (!std::ifstream(path))
+        {
+            stream << std::setw(36) << std::left << path << std::right << "  not found\n";
+            continue;
+        }
+
+        ImportSummary assimp, obj;
+        if (!import(path, jobs, true, assimp) || !import(path, jobs, false, obj))
+        {
+            stream << std::setw(36) << std::left << path << std::right << "  import failed\n";
+            isMatching = false;
+            continue;
+        }
+
+        // the importers may split the faces into meshes differently, the geometry must be the same
+        float boundsError = glm::length(assimp.bounds.center - obj.bounds.center) + std::abs(assimp.bounds.radius - obj.bounds.radius);
+        bool isSame = assimp.verticesCount == obj.verticesCount && assimp.indicesCount == obj.indicesCount
+            && boundsError <= BOUNDS_TOLERANCE * std::max(assimp.bounds.radius, 1.0f);
+        isMatching &= isSame;
+
+        stream << std::setw(36) << std::left << path << std::right << std::setw(10) << obj.verticesCount << std::setw(8) << assimp.meshesCount
+            << std::fixed << std::setprecision(2) << std::setw(12) << assimp.seconds * 1000.0 << std::setw(8) << obj.meshesCount
+            << std::setw(12) << obj.seconds * 1000.0 << std::setw(10) << assimp.seconds / obj.seconds << (isSame ? "" : "  MISMATCH") << "\n";
+    }
+
+    stream << (isMatching ? "geometry: PASS" : "geometry: FAIL") << " (" << jobs.GetWorkersCount() + 1 << " threads, best of " << REPEATS << ")" << std::endl;
+    return isMatching;
+}
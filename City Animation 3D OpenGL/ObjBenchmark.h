@@ -0,0 +1,16 @@
+#pragma once
+#ifndef OBJ_BENCHMARK_H
+#define OBJ_BENCHMARK_H
+
+#include <ostream>
+
+// Import time of the models with ObjLoader against ASSIMP, both converting into an arena without
+// creating OpenGL objects; also checks that both give the same vertices and indices.
+class ObjBenchmark
+{
+public:
+    // prints a line per model found, returns false if the two importers disagree on one of them
+    static bool Run(std::ostream& stream);
+};
+
+#endif
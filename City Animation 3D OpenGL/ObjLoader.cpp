@@ -0,0 +1,691 @@
+#include "ObjLoader.h"
+#include "ResourcePack.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+// a chunk is at least this large, so small files are parsed by a single job
+const size_t MIN_CHUNK_SIZE = 256 * 1024;
+// chunks per thread, so threads finishing early steal the rest
+const size_t CHUNKS_PER_THREAD = 4;
+
+// the texture types of a material in the order Model collects them from ASSIMP's materials
+const int MATERIAL_SLOTS = 4;
+const char* const SLOT_TYPES[MATERIAL_SLOTS] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+// powers of ten a double holds exactly, a float with a short mantissa is then one multiplication or
+// division away from the correctly rounded result
+const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// references of a face corner to the vertex arrays, 0-based over the whole file; -1 if it has none
+struct ObjCorner
+{
+    int position;
+    int texCoord;
+    int normal;
+};
+
+// polygons of a chunk from firstPolygon on use the group and material the run names, -1 keeps
+// the previous run's; the first run of a chunk continues where the chunk before ended
+struct ObjRun
+{
+    int group;
+    int material;
+    size_t firstPolygon;
+    size_t firstCorner;
+};
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    // vertex lines in the chunk and in all the chunks before it
+    size_t positionsCount = 0;
+    size_t texCoordsCount = 0;
+    size_t normalsCount = 0;
+    size_t facesCount = 0;
+    size_t positionsOffset = 0;
+    size_t texCoordsOffset = 0;
+    size_t normalsOffset = 0;
+
+    // the corners of every polygon one after another, and how many each polygon has
+    std::vector<ObjCorner> corners;
+    std::vector<unsigned int> polygonSizes;
+    std::vector<ObjRun> runs;
+    // names of the groups and materials the runs refer to
+    std::vector<std::string> names;
+    std::vector<std::string> libraries;
+    bool hasInvalidIndex = false;
+};
+
+// the vertex arrays of the whole file, filled by the chunks in parallel
+struct ObjVertices
+{
+    glm::vec3* positions;
+    glm::vec2* texCoords;
+    glm::vec3* normals;
+    size_t positionsCount;
+    size_t texCoordsCount;
+    size_t normalsCount;
+};
+
+// the polygons of one group and material, gathered from runs of any chunk
+struct ObjBucket
+{
+    struct Range
+    {
+        size_t chunk;
+        size_t firstPolygon;
+        size_t endPolygon;
+        size_t firstCorner;
+    };
+
+    std::vector<Range> ranges;
+    size_t cornersCount = 0;
+    size_t trianglesCount = 0;
+};
+
+static void forEach(JobSystem* jobs, size_t count, const std::function<void(size_t)>& function)
+{
+    if (jobs == NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+            function(i);
+        return;
+    }
+
+    jobs->ParallelFor(0, count, 1, [&function](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            function(i);
+    });
+}
+
+static bool isSpace(char character)
+{
+    return character == ' ' || character == '\t' || character == '\r';
+}
+
+static bool isDigit(char character)
+{
+    return character >= '0' && character <= '9';
+}
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    return p;
+}
+
+static const char* findLineEnd(const char* p, const char* end)
+{
+    // memchr scans a vector register of bytes at a time
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline != NULL ? newline : end;
+}
+
+// whether the line at p starts with the keyword followed by a space or the end of the line
+static bool isKeyword(const char* p, const char* end, const char* keyword, size_t length)
+{
+    return (size_t)(end - p) >= length && memcmp(p, keyword, length) == 0 && (p + length == end || isSpace(p[length]));
+}
+
+// the rest of the line without the spaces around it
+static std::string restOfLine(const char* p, const char* end)
+{
+    p = skipSpaces(p, end);
+    while (end > p && isSpace(end[-1]))
+        end--;
+    return std::string(p, end);
+}
+
+// decimal number with an optional fraction and exponent, 0 if there is none
+static float parseFloat(const char*& p, const char* end)
+{
+    p = skipSpaces(p, end);
+    bool isNegative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        p++;
+
+    // the first 19 significant digits fit a 64-bit integer, the ones after only scale it
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for (; p < end && isDigit(*p); p++)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && isDigit(*p); p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool isExponentNegative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        int value = 0;
+        for (; p < end && isDigit(*p); p++)
+            value = std::min(value * 10 + (*p - '0'), 1000);
+        exponent += isExponentNegative ? -value : value;
+    }
+
+    double result = (double)mantissa;
+    if (exponent >= 0 && exponent <= 22)
+        result *= POWERS_OF_TEN[exponent];
+    else if (exponent < 0 && exponent >= -22)
+        result /= POWERS_OF_TEN[-exponent];
+    else
+        result *= std::pow(10.0, exponent);
+    return (float)(isNegative ? -result : result);
+}
+
+// a 1-based or, if negative, relative vertex reference; false if there is none
+static bool parseIndex(const char*& p, const char* end, long& index)
+{
+    bool isNegative = p < end && *p == '-';
+    if (isNegative)
+        p++;
+    if (p >= end || !isDigit(*p))
+        return false;
+    long value = 0;
+    for (; p < end && isDigit(*p); p++)
+        value = std::min(value * 10 + (*p - '0'), 1L << 40);
+    index = isNegative ? -value : value;
+    return true;
+}
+
+// 0-based index into an array of count elements, of which the ones before seen are known; -1 if
+// it's outside of the array
+static int resolveIndex(long index, size_t seen, size_t count)
+{
+    long resolved = index > 0 ? index - 1 : (long)seen + index;
+    return resolved >= 0 && resolved < (long)count ? (int)resolved : -1;
+}
+
+// must agree with parseChunk on every vertex line, the arrays are sized from the counts
+static void countLines(ObjChunk& chunk)
+{
+    for (const char* line = chunk.begin; line < chunk.end;)
+    {
+        const char* lineEnd = findLineEnd(line, chunk.end);
+        const char* p = skipSpaces(line, lineEnd);
+        line = lineEnd + 1;
+        if (p == lineEnd)
+            continue;
+
+        if (*p == 'v')
+        {
+            if (isKeyword(p, lineEnd, "v", 1))
+                chunk.positionsCount++;
+            else if (isKeyword(p, lineEnd, "vt", 2))
+                chunk.texCoordsCount++;
+            else if (isKeyword(p, lineEnd, "vn", 2))
+                chunk.normalsCount++;
+        }
+        else if (isKeyword(p, lineEnd, "f", 1))
+            chunk.facesCount++;
+    }
+}
+
+// starts a new run for a group or material change, or changes the current run if it has no polygons yet
+static void changeRun(ObjChunk& chunk, int group, int material)
+{
+    if (chunk.runs.back().firstPolygon != chunk.polygonSizes.size())
+        chunk.runs.push_back({ -1, -1, chunk.polygonSizes.size(), chunk.corners.size() });
+    if (group >= 0)
+        chunk.runs.back().group = group;
+    if (material >= 0)
+        chunk.runs.back().material = material;
+}
+
+static void parseChunk(ObjChunk& chunk, const ObjVertices& vertices)
+{
+    PROFILE_SCOPE("ObjLoader::parseChunk");
+
+    chunk.corners.reserve(chunk.facesCount * 3);
+    chunk.polygonSizes.reserve(chunk.facesCount);
+    chunk.runs.push_back({ -1, -1, 0, 0 });
+    size_t positionsSeen = chunk.positionsOffset;
+    size_t texCoordsSeen = chunk.texCoordsOffset;
+    size_t normalsSeen = chunk.normalsOffset;
+    std::vector<ObjCorner> polygon;
+
+    for (const char* line = chunk.begin; line < chunk.end;)
+    {
+        const char* lineEnd = findLineEnd(line, chunk.end);
+        const char* p = skipSpaces(line, lineEnd);
+        line = lineEnd + 1;
+        if (p == lineEnd || *p == '#')
+            continue;
+
+        if (isKeyword(p, lineEnd, "v", 1))
+        {
+            p++;
+            glm::vec3& position = vertices.positions[positionsSeen++];
+            position.x = parseFloat(p, lineEnd);
+            position.y = parseFloat(p, lineEnd);
+            position.z = parseFloat(p, lineEnd);
+        }
+        else if (isKeyword(p, lineEnd, "vt", 2))
+        {
+            p += 2;
+            glm::vec2& texCoord = vertices.texCoords[texCoordsSeen++];
+            texCoord.x = parseFloat(p, lineEnd);
+            texCoord.y = parseFloat(p, lineEnd);
+        }
+        else if (isKeyword(p, lineEnd, "vn", 2))
+        {
+            p += 2;
+            glm::vec3& normal = vertices.normals[normalsSeen++];
+            normal.x = parseFloat(p, lineEnd);
+            normal.y = parseFloat(p, lineEnd);
+            normal.z = parseFloat(p, lineEnd);
+        }
+        else if (isKeyword(p, lineEnd, "f", 1))
+        {
+            // corners are position/texture coordinate/normal, the last two optional
+            polygon.clear();
+            bool isValid = true;
+            for (p = skipSpaces(p + 1, lineEnd); p < lineEnd; p = skipSpaces(p, lineEnd))
+            {
+                ObjCorner corner = { -1, -1, -1 };
+                long index;
+                if (!parseIndex(p, lineEnd, index))
+                    break;
+                corner.position = resolveIndex(index, positionsSeen, vertices.positionsCount);
+                isValid &= corner.position >= 0;
+                if (p < lineEnd && *p == '/')
+                {
+                    p++;
+                    if (parseIndex(p, lineEnd, index))
+                    {
+                        corner.texCoord = resolveIndex(index, texCoordsSeen, vertices.texCoordsCount);
+                        isValid &= corner.texCoord >= 0;
+                    }
+                    if (p < lineEnd && *p == '/')
+                    {
+                        p++;
+                        if (parseIndex(p, lineEnd, index))
+                        {
+                            corner.normal = resolveIndex(index, normalsSeen, vertices.normalsCount);
+                            isValid &= corner.normal >= 0;
+                        }
+                    }
+                }
+                polygon.push_back(corner);
+            }
+
+            if (!isValid)
+            {
+                chunk.hasInvalidIndex = true;
+                continue;
+            }
+            // points and lines aren't drawn
+            if (polygon.size() >= 3)
+            {
+                chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.end());
+                chunk.polygonSizes.push_back((unsigned int)polygon.size());
+            }
+        }
+        else if (isKeyword(p, lineEnd, "usemtl", 6))
+        {
+            chunk.names.push_back(restOfLine(p + 6, lineEnd));
+            changeRun(chunk, -1, (int)chunk.names.size() - 1);
+        }
+        else if (isKeyword(p, lineEnd, "g", 1) || isKeyword(p, lineEnd, "o", 1))
+        {
+            std::string name = restOfLine(p + 1, lineEnd);
+            chunk.names.push_back(name.empty() ? "default" : name);
+            changeRun(chunk, (int)chunk.names.size() - 1, -1);
+        }
+        else if (isKeyword(p, lineEnd, "mtllib", 6))
+        {
+            chunk.libraries.push_back(restOfLine(p + 6, lineEnd));
+        }
+    }
+}
+
+// the file name of a texture map after its options
+static std::string mapFileName(const char* p, const char* end)
+{
+    // options and how many values they take at most, numbers are optional after the first
+    static const struct { const char* name; int values; bool isNumeric; } OPTIONS[] = {
+        { "-blendu", 1, false }, { "-blendv", 1, false }, { "-boost", 1, true }, { "-mm", 2, true },
+        { "-o", 3, true }, { "-s", 3, true }, { "-t", 3, true }, { "-texres", 1, true },
+        { "-clamp", 1, false }, { "-bm", 1, true }, { "-imfchan", 1, false }, { "-type", 1, false }
+    };
+
+    for (p = skipSpaces(p, end); p < end && *p == '-'; p = skipSpaces(p, end))
+    {
+        const char* optionEnd = p;
+        while (optionEnd < end && !isSpace(*optionEnd))
+            optionEnd++;
+        int values = 0;
+        bool isNumeric = false;
+        for (const auto& option : OPTIONS)
+        {
+            if ((size_t)(optionEnd - p) == strlen(option.name) && memcmp(p, option.name, optionEnd - p) == 0)
+            {
+                values = option.values;
+                isNumeric = option.isNumeric;
+            }
+        }
+
+        p = optionEnd;
+        for (int i = 0; i < values; i++)
+        {
+            const char* value = skipSpaces(p, end);
+            if (value >= end || (isNumeric && i > 0 && !isDigit(*value) && *value != '-' && *value != '.'))
+                break;
+            p = value;
+            while (p < end && !isSpace(*p))
+                p++;
+        }
+    }
+    return restOfLine(p, end);
+}
+
+// reads the materials of a library, appending their names and textures; false if it can't be read
+static bool parseMaterials(const std::string& path, std::vector<std::string>& names, std::vector<std::vector<MaterialTexture>>& textures)
+{
+    ResourceFile file;
+    if (!file.Open(path))
+        return false;
+
+    std::vector<std::string> slots[MATERIAL_SLOTS];
+    auto finishMaterial = [&]() {
+        if (names.size() == textures.size())
+            return;
+        textures.emplace_back();
+        for (int slot = 0; slot < MATERIAL_SLOTS; slot++)
+        {
+            for (const std::string& texture : slots[slot])
+                textures.back().push_back({ SLOT_TYPES[slot], texture });
+            slots[slot].clear();
+        }
+    };
+
+    const char* end = file.GetData() + file.GetSize();
+    for (const char* line = file.GetData(); line < end;)
+    {
+        const char* lineEnd = findLineEnd(line, end);
+        const char* p = skipSpaces(line, lineEnd);
+        line = lineEnd + 1;
+
+        int slot = -1;
+        size_t length = 0;
+        if (isKeyword(p, lineEnd, "newmtl", 6))
+        {
+            finishMaterial();
+            names.push_back(restOfLine(p + 6, lineEnd));
+        }
+        else if (isKeyword(p, lineEnd, "map_Kd", 6))
+            slot = 0, length = 6;
+        else if (isKeyword(p, lineEnd, "map_Ks", 6))
+            slot = 1, length = 6;
+        else if (isKeyword(p, lineEnd, "map_bump", 8) || isKeyword(p, lineEnd, "map_Bump", 8))
+            slot = 2, length = 8;
+        else if (isKeyword(p, lineEnd, "bump", 4))
+            slot = 2, length = 4;
+        else if (isKeyword(p, lineEnd, "map_Ka", 6))
+            slot = 3, length = 6;
+
+        // a map before the first material has nothing to belong to
+        if (slot >= 0 && names.size() > textures.size())
+        {
+            std::string fileName = mapFileName(p + length, lineEnd);
+            if (!fileName.empty())
+                slots[slot].push_back(fileName);
+        }
+    }
+    finishMaterial();
+    return true;
+}
+
+// fills the vertices and indices of a mesh from the polygons of a bucket: a vertex per polygon
+// corner and a fan of triangles around the polygon's first one
+static void buildMesh(const ObjBucket& bucket, const std::vector<ObjChunk>& chunks, const ObjVertices& vertices, ImportedMesh& mesh)
+{
+    // the polygons without normals get the average of the normals of the polygons around their positions
+    std::unordered_map<int, glm::vec3> smoothNormals;
+    bool hasTexCoords = false;
+    for (const ObjBucket::Range& range : bucket.ranges)
+    {
+        const ObjChunk& chunk = chunks[range.chunk];
+        const ObjCorner* corners = &chunk.corners[range.firstCorner];
+        for (size_t polygon = range.firstPolygon; polygon < range.endPolygon; polygon++)
+        {
+            unsigned int size = chunk.polygonSizes[polygon];
+            bool hasNormals = true;
+            for (unsigned int k = 0; k < size; k++)
+            {
+                hasTexCoords |= corners[k].texCoord >= 0;
+                hasNormals &= corners[k].normal >= 0;
+            }
+            if (!hasNormals)
+            {
+                glm::vec3 p0 = vertices.positions[corners[0].position];
+                glm::vec3 faceNormal = glm::cross(vertices.positions[corners[1].position] - p0, vertices.positions[corners[2].position] - p0);
+                float length = glm::length(faceNormal);
+                if (length > 0.0f)
+                    faceNormal = faceNormal / length;
+                for (unsigned int k = 0; k < size; k++)
+                    smoothNormals.emplace(corners[k].position, glm::vec3(0.0f)).first->second += faceNormal;
+            }
+            corners += size;
+        }
+    }
+
+    size_t vertexIndex = 0;
+    size_t indexIndex = 0;
+    for (const ObjBucket::Range& range : bucket.ranges)
+    {
+        const ObjChunk& chunk = chunks[range.chunk];
+        const ObjCorner* corners = &chunk.corners[range.firstCorner];
+        for (size_t polygon = range.firstPolygon; polygon < range.endPolygon; polygon++)
+        {
+            unsigned int size = chunk.polygonSizes[polygon];
+            Vertex* polygonVertices = &mesh.vertices[vertexIndex];
+            for (unsigned int k = 0; k < size; k++)
+            {
+                const ObjCorner& corner = corners[k];
+                Vertex& vertex = polygonVertices[k];
+                vertex = Vertex();
+                vertex.Position = vertices.positions[corner.position];
+                if (corner.normal >= 0)
+                {
+                    vertex.Normal = vertices.normals[corner.normal];
+                }
+                else
+                {
+                    glm::vec3 normal = smoothNormals[corner.position];
+                    float length = glm::length(normal);
+                    vertex.Normal = length > 0.0f ? normal / length : normal;
+                }
+                // the images are stored top row first, OpenGL expects the bottom one first
+                if (corner.texCoord >= 0)
+                    vertex.TexCoords = glm::vec2(vertices.texCoords[corner.texCoord].x, 1.0f - vertices.texCoords[corner.texCoord].y);
+            }
+
+            for (unsigned int k = 2; k < size; k++)
+            {
+                Vertex* triangle[3] = { &polygonVertices[0], &polygonVertices[k - 1], &polygonVertices[k] };
+                mesh.indices[indexIndex++] = (unsigned int)vertexIndex;
+                mesh.indices[indexIndex++] = (unsigned int)(vertexIndex + k - 1);
+                mesh.indices[indexIndex++] = (unsigned int)(vertexIndex + k);
+                if (!hasTexCoords)
+                    continue;
+
+                // tangent and bitangent along the texture axes, made orthogonal to each vertex's normal;
+                // like ASSIMP, a corner shared by triangles keeps the last one's
+                glm::vec3 edge1 = triangle[1]->Position - triangle[0]->Position;
+                glm::vec3 edge2 = triangle[2]->Position - triangle[0]->Position;
+                glm::vec2 delta1 = triangle[1]->TexCoords - triangle[0]->TexCoords;
+                glm::vec2 delta2 = triangle[2]->TexCoords - triangle[0]->TexCoords;
+                float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+                float scale = determinant != 0.0f ? 1.0f / determinant : 1.0f;
+                glm::vec3 tangent = (edge1 * delta2.y - edge2 * delta1.y) * scale;
+                glm::vec3 bitangent = (edge2 * delta1.x - edge1 * delta2.x) * scale;
+                for (Vertex* vertex : triangle)
+                {
+                    glm::vec3 normal = vertex->Normal;
+                    glm::vec3 localTangent = tangent - normal * glm::dot(tangent, normal);
+                    glm::vec3 localBitangent = bitangent - normal * glm::dot(bitangent, normal);
+                    float tangentLength = glm::length(localTangent);
+                    float bitangentLength = glm::length(localBitangent);
+                    vertex->Tangent = tangentLength > 0.0f ? localTangent / tangentLength : localTangent;
+                    vertex->Bitangent = bitangentLength > 0.0f ? localBitangent / bitangentLength : localBitangent;
+                }
+            }
+            vertexIndex += size;
+            corners += size;
+        }
+    }
+}
+
+bool ObjLoader::Load(const std::string& path, JobSystem* jobs, Arena& arena, std::vector<ImportedMesh>& meshes,
+    std::vector<std::vector<MaterialTexture>>& materialTextures)
+{
+    PROFILE_SCOPE("ObjLoader::Load");
+
+    ResourceFile file;
+    if (!file.Open(path))
+    {
+        std::cout << "ERROR::OBJ_LOADER::FILE_NOT_FOUND: " << path << std::endl;
+        return false;
+    }
+    const char* data = file.GetData();
+    const char* end = data + file.GetSize();
+
+    // chunks end after a line break, the last one at the end of the file
+    size_t threadsCount = jobs != NULL ? jobs->GetWorkersCount() + 1 : 1;
+    size_t chunksCount = std::max((size_t)1, std::min(file.GetSize() / MIN_CHUNK_SIZE, threadsCount * CHUNKS_PER_THREAD));
+    std::vector<ObjChunk> chunks(chunksCount);
+    const char* chunkBegin = data;
+    for (size_t i = 0; i < chunksCount; i++)
+    {
+        const char* chunkEnd = i + 1 == chunksCount ? end : data + file.GetSize() / chunksCount * (i + 1);
+        if (chunkEnd < chunkBegin)
+            chunkEnd = chunkBegin;
+        if (chunkEnd < end)
+            chunkEnd = std::min(findLineEnd(chunkEnd, end) + 1, end);
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // every chunk learns where its vertices go in the arrays of the whole file
+    forEach(jobs, chunks.size(), [&chunks](size_t i) { countLines(chunks[i]); });
+    ObjVertices vertices = {};
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.positionsOffset = vertices.positionsCount;
+        chunk.texCoordsOffset = vertices.texCoordsCount;
+        chunk.normalsOffset = vertices.normalsCount;
+        vertices.positionsCount += chunk.positionsCount;
+        vertices.texCoordsCount += chunk.texCoordsCount;
+        vertices.normalsCount += chunk.normalsCount;
+    }
+    vertices.positions = arena.AllocateArray<glm::vec3>(vertices.positionsCount);
+    vertices.texCoords = arena.AllocateArray<glm::vec2>(vertices.texCoordsCount);
+    vertices.normals = arena.AllocateArray<glm::vec3>(vertices.normalsCount);
+
+    forEach(jobs, chunks.size(), [&chunks, &vertices](size_t i) { parseChunk(chunks[i], vertices); });
+
+    // the libraries are looked for next to the model; like ASSIMP, one named like the model stands
+    // in for a missing one
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    std::vector<std::string> materialNames;
+    materialTextures.clear();
+    for (const ObjChunk& chunk : chunks)
+    {
+        if (chunk.hasInvalidIndex)
+            std::cout << "ERROR::OBJ_LOADER::INDEX_OUT_OF_RANGE: faces skipped in " << path << std::endl;
+        for (const std::string& library : chunk.libraries)
+        {
+            if (!parseMaterials(directory + library, materialNames, materialTextures))
+                parseMaterials(path.substr(0, path.find_last_of('.')) + ".mtl", materialNames, materialTextures);
+        }
+    }
+    std::map<std::string, unsigned int> materialIndices;
+    for (size_t i = 0; i < materialNames.size(); i++)
+        materialIndices.insert(std::make_pair(materialNames[i], (unsigned int)i));
+    // faces before any material or with an unknown one use a material without textures
+    unsigned int defaultMaterial = (unsigned int)materialTextures.size();
+    materialTextures.emplace_back();
+
+    // the runs of every chunk go to the mesh of their group and material, in the order the
+    // meshes first show up
+    std::map<std::pair<std::string, unsigned int>, size_t> bucketIndices;
+    std::vector<ObjBucket> buckets;
+    std::string group = "default";
+    unsigned int material = defaultMaterial;
+    for (size_t chunkIndex = 0; chunkIndex < chunks.size(); chunkIndex++)
+    {
+        const ObjChunk& chunk = chunks[chunkIndex];
+        for (size_t i = 0; i < chunk.runs.size(); i++)
+        {
+            const ObjRun& run = chunk.runs[i];
+            if (run.group >= 0)
+                group = chunk.names[run.group];
+            if (run.material >= 0)
+            {
+                auto found = materialIndices.find(chunk.names[run.material]);
+                material = found != materialIndices.end() ? found->second : defaultMaterial;
+            }
+
+            size_t endPolygon = i + 1 < chunk.runs.size() ? chunk.runs[i + 1].firstPolygon : chunk.polygonSizes.size();
+            size_t endCorner = i + 1 < chunk.runs.size() ? chunk.runs[i + 1].firstCorner : chunk.corners.size();
+            if (endPolygon == run.firstPolygon)
+                continue;
+            auto inserted = bucketIndices.insert(std::make_pair(std::make_pair(group, material), buckets.size()));
+            if (inserted.second)
+                buckets.emplace_back();
+            ObjBucket& bucket = buckets[inserted.first->second];
+            bucket.ranges.push_back({ chunkIndex, run.firstPolygon, endPolygon, run.firstCorner });
+            bucket.cornersCount += endCorner - run.firstCorner;
+            bucket.trianglesCount += endCorner - run.firstCorner - 2 * (endPolygon - run.firstPolygon);
+        }
+    }
+
+    size_t firstMesh = meshes.size();
+    meshes.resize(firstMesh + buckets.size());
+    for (const auto& entry : bucketIndices)
+    {
+        ImportedMesh& mesh = meshes[firstMesh + entry.second];
+        mesh.verticesCount = buckets[entry.second].cornersCount;
+        mesh.indicesCount = buckets[entry.second].trianglesCount * 3;
+        mesh.vertices = arena.AllocateArray<Vertex>(mesh.verticesCount);
+        mesh.indices = arena.AllocateArray<unsigned int>(mesh.indicesCount);
+        mesh.material = entry.first.second;
+    }
+    forEach(jobs, buckets.size(), [&](size_t i) { buildMesh(buckets[i], chunks, vertices, meshes[firstMesh + i]); });
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "Arena.h"
+#include "InternedString.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+
+// mesh converted from a model file, before its OpenGL objects exist
+struct ImportedMesh
+{
+    // in the import's arena, sized before the mesh is converted
+    Vertex* vertices = NULL;
+    size_t verticesCount = 0;
+    unsigned int* indices = NULL;
+    size_t indicesCount = 0;
+    unsigned int material = 0;
+};
+
+// type and path of a texture a material uses, the type named like the shaders' samplers
+struct MaterialTexture
+{
+    InternedString type;
+    InternedString path;
+};
+
+// Loader of Wavefront OBJ models and their MTL materials, producing the meshes ASSIMP's importer
+// gives Model with its post-processing: triangle fans, one mesh per group and material, a vertex
+// per face corner, flipped texture coordinates, smoothed normals where the file has none and
+// tangents from the texture coordinates. The file, or its entry of the mounted ResourcePack, is
+// mapped into memory and split at line ends into chunks parsed in parallel; a first pass counts
+// the vertex lines of every chunk, so each chunk knows where its vertices start and resolves
+// relative indices on its own.
+class ObjLoader
+{
+public:
+    // materialTextures gets the textures of every material the meshes refer to; false if the file
+    // can't be read
+    static bool Load(const std::string& path, JobSystem* jobs, Arena& arena, std::vector<ImportedMesh>& meshes,
+        std::vector<std::vector<MaterialTexture>>& materialTextures);
+};
+
+#endif
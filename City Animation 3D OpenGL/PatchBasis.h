@@ -0,0 +1,168 @@
+#pragma once
+#ifndef PATCH_BASIS_H
+#define PATCH_BASIS_H
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+// binomial coefficient, usable in constant expressions
+constexpr long long Binomial(int n, int k)
+{
+    if (k < 0 || k > n)
+        return 0;
+    long long c = 1;
+    for (int i = 1; i <= k; i++)
+        c = c * (n - k + i) / i;
+    return c;
+}
+
+// Basis policies of the patch surfaces: a span of the surface is weighted by ORDER consecutive
+// control points along each side, FindSpan maps a parameter in [0, 1] to the first of them and the
+// parameter local to the span, Evaluate gives the ORDER weights and their derivatives there.
+
+// Bernstein polynomials: a Bezier patch is a single span over exactly ORDER control points
+template <int Degree>
+struct BernsteinBasis
+{
+    static_assert(Degree >= 1, "a patch needs at least a linear basis");
+
+    static const int ORDER = Degree + 1;
+
+    static constexpr std::array<long long, ORDER> makeBinomials()
+    {
+        std::array<long long, ORDER> binomials = {};
+        for (int i = 0; i < ORDER; i++)
+            binomials[i] = Binomial(Degree, i);
+        return binomials;
+    }
+    static constexpr std::array<long long, ORDER> BINOMIALS = makeBinomials();
+
+    static int GetMinimumControlCount() { return ORDER; }
+
+    // derivativeScale converts derivatives by the local parameter into ones by t; the single span
+    // doesn't depend on the control count
+    template <typename Scalar>
+    static int FindSpan(Scalar t, int /*controlCount*/, Scalar& local, Scalar& derivativeScale)
+    {
+        local = t;
+        derivativeScale = Scalar(1);
+        return 0;
+    }
+
+    template <typename Scalar>
+    static void Evaluate(Scalar t, Scalar* values, Scalar* derivatives)
+    {
+        evaluate(t, values, derivatives, std::make_index_sequence<ORDER>());
+    }
+
+    // point of the curve over ORDER control values by de Casteljau's algorithm; exact at both ends,
+    // so patches sharing an edge's control values get bitwise equal points along it
+    template <typename Scalar>
+    static Scalar EvaluateCurve(const Scalar* control, Scalar t)
+    {
+        Scalar points[ORDER];
+        for (int k = 0; k < ORDER; k++)
+            points[k] = control[k];
+        for (int level = Degree; level > 0; level--)
+        {
+            for (int k = 0; k < level; k++)
+                points[k] = (Scalar(1) - t) * points[k] + t * points[k + 1];
+        }
+        return points[0];
+    }
+
+private:
+    // the terms are expanded for every index at compile time, no loop is left at run time
+    template <typename Scalar, size_t... I>
+    static void evaluate(Scalar t, Scalar* values, Scalar* derivatives, std::index_sequence<I...>)
+    {
+        Scalar tPowers[ORDER], sPowers[ORDER];
+        (power<I>(t, tPowers, sPowers), ...);
+        (term<I>(tPowers, sPowers, values, derivatives), ...);
+    }
+
+    // t^i and (1 - t)^i from the powers below
+    template <size_t I, typename Scalar>
+    static void power(Scalar t, Scalar* tPowers, Scalar* sPowers)
+    {
+        if constexpr (I == 0)
+        {
+            tPowers[0] = Scalar(1);
+            sPowers[0] = Scalar(1);
+        }
+        else
+        {
+            tPowers[I] = tPowers[I - 1] * t;
+            sPowers[I] = sPowers[I - 1] * (Scalar(1) - t);
+        }
+    }
+
+    // C(n, i) t^i (1 - t)^(n - i) and its derivative
+    template <size_t I, typename Scalar>
+    static void term(const Scalar* tPowers, const Scalar* sPowers, Scalar* values, Scalar* derivatives)
+    {
+        values[I] = Scalar(BINOMIALS[I]) * tPowers[I] * sPowers[Degree - I];
+
+        Scalar derivative = Scalar(0);
+        if constexpr (I > 0)
+            derivative += Scalar(I) * tPowers[I - 1] * sPowers[Degree - I];
+        if constexpr (I < (size_t)Degree)
+            derivative -= Scalar(Degree - I) * tPowers[I] * sPowers[Degree - I - 1];
+        derivatives[I] = Scalar(BINOMIALS[I]) * derivative;
+    }
+};
+
+// Uniform B-splines: controlCount - Degree spans of equal length, each weighted by ORDER control
+// points, with continuous derivatives up to Degree - 1 across the spans
+template <int Degree>
+struct UniformBSplineBasis
+{
+    static_assert(Degree >= 1, "a patch needs at least a linear basis");
+
+    static const int ORDER = Degree + 1;
+
+    static int GetMinimumControlCount() { return ORDER; }
+
+    template <typename Scalar>
+    static int FindSpan(Scalar t, int controlCount, Scalar& local, Scalar& derivativeScale)
+    {
+        int spans = controlCount - Degree;
+        Scalar position = t * spans;
+        int span = (int)std::floor(position);
+        span = span < 0 ? 0 : (span >= spans ? spans - 1 : span);
+
+        local = position - span;
+        derivativeScale = Scalar(spans);
+        return span;
+    }
+
+    template <typename Scalar>
+    static void Evaluate(Scalar u, Scalar* values, Scalar* derivatives)
+    {
+        // Cox-de Boor on unit knot spacing, raising the degree one step at a time:
+        // B(d, r) = ((u + d - r) B(d - 1, r - 1) + (r + 1 - u) B(d - 1, r)) / d
+        Scalar basis[ORDER] = { Scalar(1) };
+        for (int d = 1; d <= Degree; d++)
+        {
+            // the derivative of the final degree is the difference of neighbours of the one below
+            if (d == Degree)
+            {
+                for (int r = 0; r <= Degree; r++)
+                    derivatives[r] = (r > 0 ? basis[r - 1] : Scalar(0)) - (r < Degree ? basis[r] : Scalar(0));
+            }
+
+            for (int r = d; r >= 0; r--)
+            {
+                Scalar left = r > 0 ? (u + Scalar(d - r)) * basis[r - 1] : Scalar(0);
+                Scalar right = r < d ? (Scalar(r + 1) - u) * basis[r] : Scalar(0);
+                basis[r] = (left + right) / Scalar(d);
+            }
+        }
+
+        for (int r = 0; r <= Degree; r++)
+            values[r] = basis[r];
+    }
+};
+
+#endif
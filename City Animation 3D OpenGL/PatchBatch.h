@@ -0,0 +1,180 @@
+#pragma once
+#ifndef PATCH_BATCH_H
+#define PATCH_BATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX__)
+#define BEZIER_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIER_SSE2
+#endif
+
+#if defined(BEZIER_AVX) || defined(BEZIER_SSE2)
+#include <immintrin.h>
+#endif
+
+// out[j] = sum of coefficients[k] * rows[k][j] over the rows, for every j below count;
+// as many j at once as the widest enabled instruction set allows
+inline void CombineRows(float* out, const float* coefficients, const float* const* rows, int rowsCount, size_t count)
+{
+    size_t j = 0;
+#ifdef BEZIER_AVX
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < rowsCount; k++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(coefficients[k]), _mm256_loadu_ps(rows[k] + j)));
+        _mm256_storeu_ps(out + j, sum);
+    }
+#endif
+#ifdef BEZIER_SSE2
+    for (; j + 4 <= count; j += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < rowsCount; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(coefficients[k]), _mm_loadu_ps(rows[k] + j)));
+        _mm_storeu_ps(out + j, sum);
+    }
+#endif
+    for (; j < count; j++)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k < rowsCount; k++)
+            sum += coefficients[k] * rows[k][j];
+        out[j] = sum;
+    }
+}
+
+inline void CombineRows(double* out, const double* coefficients, const double* const* rows, int rowsCount, size_t count)
+{
+    size_t j = 0;
+#ifdef BEZIER_AVX
+    for (; j + 4 <= count; j += 4)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        for (int k = 0; k < rowsCount; k++)
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(coefficients[k]), _mm256_loadu_pd(rows[k] + j)));
+        _mm256_storeu_pd(out + j, sum);
+    }
+#endif
+#ifdef BEZIER_SSE2
+    for (; j + 2 <= count; j += 2)
+    {
+        __m128d sum = _mm_setzero_pd();
+        for (int k = 0; k < rowsCount; k++)
+            sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(coefficients[k]), _mm_loadu_pd(rows[k] + j)));
+        _mm_storeu_pd(out + j, sum);
+    }
+#endif
+    for (; j < count; j++)
+    {
+        double sum = 0.0;
+        for (int k = 0; k < rowsCount; k++)
+            sum += coefficients[k] * rows[k][j];
+        out[j] = sum;
+    }
+}
+
+// Evaluates a height patch z(x, y) = sum of control[k][l] * N_k(x) * N_l(y) and its partial derivatives
+// over a grid of parameters, for any basis policy of PatchBasis.h. Within a span the grid is
+// Nx * P * Ny^T: the control net is collapsed against the column weights once, after which every row
+// is a combination of ORDER contiguous rows, evaluated for many columns at once.
+template <typename Basis, typename Scalar>
+class PatchBatchEvaluator
+{
+public:
+    static const int ORDER = Basis::ORDER;
+
+    // controlCount * controlCount heights, control[i * controlCount + j] weighted along x by N_i and along y by N_j
+    PatchBatchEvaluator(const Scalar* control, int controlCount) : control(control, control + controlCount * controlCount), controlCount(controlCount)
+    {
+    }
+
+    // z, dz/dx and dz/dy at every (xs[row], ys[column]), written row after row; sorted parameters
+    // keep the columns of a span together, which is what the vectorized loops run over
+    void Evaluate(const Scalar* xs, size_t rowsCount, const Scalar* ys, size_t columnsCount, Scalar* z, Scalar* dzdx, Scalar* dzdy)
+    {
+        // weights of the columns, one contiguous row per basis function, and the span of every column
+        basis.resize(ORDER * columnsCount);
+        basisDerivatives.resize(ORDER * columnsCount);
+        spans.resize(columnsCount);
+        for (size_t j = 0; j < columnsCount; j++)
+        {
+            Scalar local, derivativeScale;
+            spans[j] = Basis::FindSpan(ys[j], controlCount, local, derivativeScale);
+
+            Scalar values[ORDER], derivatives[ORDER];
+            Basis::Evaluate(local, values, derivatives);
+            for (int m = 0; m < ORDER; m++)
+            {
+                basis[m * columnsCount + j] = values[m];
+                basisDerivatives[m * columnsCount + j] = derivatives[m] * derivativeScale;
+            }
+        }
+
+        // every control row collapsed along y: curves[k][j] = sum over m of control[k][span + m] * Ny[m][j]
+        curves.resize(controlCount * columnsCount);
+        curveDerivatives.resize(controlCount * columnsCount);
+        for (size_t begin = 0; begin < columnsCount; )
+        {
+            size_t end = begin + 1;
+            while (end < columnsCount && spans[end] == spans[begin])
+                end++;
+
+            const Scalar* basisRows[ORDER];
+            const Scalar* basisDerivativeRows[ORDER];
+            for (int m = 0; m < ORDER; m++)
+            {
+                basisRows[m] = &basis[m * columnsCount + begin];
+                basisDerivativeRows[m] = &basisDerivatives[m * columnsCount + begin];
+            }
+            for (int k = 0; k < controlCount; k++)
+            {
+                const Scalar* weights = &control[k * controlCount + spans[begin]];
+                CombineRows(&curves[k * columnsCount + begin], weights, basisRows, ORDER, end - begin);
+                CombineRows(&curveDerivatives[k * columnsCount + begin], weights, basisDerivativeRows, ORDER, end - begin);
+            }
+            begin = end;
+        }
+
+        for (size_t i = 0; i < rowsCount; i++)
+        {
+            Scalar local, derivativeScale;
+            int span = Basis::FindSpan(xs[i], controlCount, local, derivativeScale);
+
+            Scalar values[ORDER], derivatives[ORDER];
+            Basis::Evaluate(local, values, derivatives);
+            for (int k = 0; k < ORDER; k++)
+                derivatives[k] *= derivativeScale;
+
+            const Scalar* curveRows[ORDER];
+            const Scalar* curveDerivativeRows[ORDER];
+            for (int k = 0; k < ORDER; k++)
+            {
+                curveRows[k] = &curves[(span + k) * columnsCount];
+                curveDerivativeRows[k] = &curveDerivatives[(span + k) * columnsCount];
+            }
+
+            size_t row = i * columnsCount;
+            CombineRows(z + row, values, curveRows, ORDER, columnsCount);
+            CombineRows(dzdx + row, derivatives, curveRows, ORDER, columnsCount);
+            CombineRows(dzdy + row, values, curveDerivativeRows, ORDER, columnsCount);
+        }
+    }
+
+private:
+    std::vector<Scalar> control;
+    int controlCount;
+
+    // kept between calls to reuse the memory
+    std::vector<Scalar> basis;
+    std::vector<Scalar> basisDerivatives;
+    std::vector<int> spans;
+    std::vector<Scalar> curves;
+    std::vector<Scalar> curveDerivatives;
+};
+
+#endif
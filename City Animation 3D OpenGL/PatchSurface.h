@@ -0,0 +1,114 @@
+#pragma once
+#ifndef PATCH_SURFACE_H
+#define PATCH_SURFACE_H
+
+#include <vector>
+
+#include "PatchBasis.h"
+#include "PatchBatch.h"
+
+// Height patch z(x, y) over the unit square, weighted by a controlCount * controlCount net of
+// heights through the given basis policy. Holds the tessellation shared by every kind of patch;
+// Scalar is the precision the control heights are kept in.
+template <typename Basis, typename Scalar>
+class PatchSurface
+{
+public:
+    static const int ORDER = Basis::ORDER;
+
+    // floats per vertex: position, normal and texture coordinates
+    static const int VERTEX_SIZE = 8;
+
+    PatchSurface(int controlCount) : controlCount(controlCount < Basis::GetMinimumControlCount() ? Basis::GetMinimumControlCount() : controlCount),
+        BaseZValues(this->controlCount * this->controlCount, Scalar(0))
+    {
+    }
+
+    int GetControlCount() const { return controlCount; }
+
+    // controlCount * controlCount heights, row after row
+    void SetBaseZValues(const float* zValues)
+    {
+        for (size_t k = 0; k < BaseZValues.size(); ++k)
+            BaseZValues[k] = (Scalar)zValues[k];
+    }
+
+    // the grid has accuracy cells along each side and a vertex at every corner
+    static int GetGridVertexCount(int accuracy)
+    {
+        return (accuracy + 1) * (accuracy + 1);
+    }
+
+    // two triangles per cell
+    static int GetGridIndexCount(int accuracy)
+    {
+        return accuracy * accuracy * 6;
+    }
+
+    // Evaluates the surface once at every grid vertex, cells share their corners through the indices.
+    // vertices must have room for GetGridVertexCount * VERTEX_SIZE floats and indices for
+    // GetGridIndexCount values; both may point into mapped buffers, they are only written.
+    void FillGrid(float* vertices, unsigned int* indices, int accuracy) const
+    {
+        float diff = 1.0f / accuracy;
+        float empty = 1.0f;
+
+        // heights and slopes of the whole grid at once, the same parameters along both sides
+        std::vector<float> coordinates(accuracy + 1);
+        for (int i = 0; i <= accuracy; ++i)
+            coordinates[i] = i * diff;
+
+        int count = GetGridVertexCount(accuracy);
+        std::vector<float> z(count), dzdx(count), dzdy(count);
+        EvaluateGrid(coordinates.data(), accuracy + 1, coordinates.data(), accuracy + 1, z.data(), dzdx.data(), dzdy.data());
+
+        int k = 0;
+        for (int v = 0; v < count; ++v)
+        {
+            // cross product of the partial derivatives (1, 0, dzdx) and (0, 1, dzdy)
+            vertices[k] = coordinates[v / (accuracy + 1)]; vertices[k + 1] = coordinates[v % (accuracy + 1)]; vertices[k + 2] = z[v];
+            vertices[k + 3] = -dzdx[v]; vertices[k + 4] = -dzdy[v]; vertices[k + 5] = 1.0f;
+            vertices[k + 6] = empty; vertices[k + 7] = empty;
+            k += VERTEX_SIZE;
+        }
+
+        k = 0;
+        for (int i = 0; i < accuracy; ++i)
+        {
+            for (int j = 0; j < accuracy; ++j)
+            {
+                unsigned int v1 = i * (accuracy + 1) + j;
+                unsigned int v2 = v1 + accuracy + 1;
+                unsigned int v3 = v1 + 1;
+                unsigned int v4 = v2 + 1;
+
+                indices[k++] = v1; indices[k++] = v2; indices[k++] = v3;
+                indices[k++] = v3; indices[k++] = v2; indices[k++] = v4;
+            }
+        }
+    }
+
+    // control point at (i / (controlCount - 1), j / (controlCount - 1)), the surface lies within their convex hull
+    void GetControlPoint(int i, int j, float& x, float& y, float& z) const
+    {
+        x = (float)i / (controlCount - 1);
+        y = (float)j / (controlCount - 1);
+        z = (float)BaseZValues[i * controlCount + j];
+    }
+
+    // z and its partial derivatives at every (xs[row], ys[column]), written row after row; the batch
+    // evaluator runs on as many points at once as SSE / AVX allow
+    template <typename Precision>
+    void EvaluateGrid(const Precision* xs, size_t rowsCount, const Precision* ys, size_t columnsCount, Precision* z, Precision* dzdx, Precision* dzdy) const
+    {
+        std::vector<Precision> control(BaseZValues.begin(), BaseZValues.end());
+        PatchBatchEvaluator<Basis, Precision> evaluator(control.data(), controlCount);
+        evaluator.Evaluate(xs, rowsCount, ys, columnsCount, z, dzdx, dzdy);
+    }
+
+protected:
+    int controlCount;
+    std::vector<Scalar> BaseZValues;
+};
+
+#endif
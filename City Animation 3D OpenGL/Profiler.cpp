@@ -0,0 +1,258 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+long long Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+#ifdef PROFILER_ENABLED
+
+struct ProfileEvent
+{
+    const char* name;
+    long long start;
+    long long end;
+};
+
+// ring buffer written only by its own thread
+struct ThreadEvents
+{
+    unsigned int id;
+    std::string name;
+    std::vector<ProfileEvent> events;
+    // events written so far, published with release so a reader sees complete events
+    std::atomic<unsigned long long> count;
+
+    ThreadEvents(unsigned int id) : id(id), events(Profiler::EVENTS_PER_THREAD), count(0) {}
+
+    // the events still in the buffer, oldest first
+    std::vector<ProfileEvent> Snapshot() const
+    {
+        unsigned long long end = count.load(std::memory_order_acquire);
+        unsigned long long begin = end > events.size() ? end - events.size() : 0;
+
+        std::vector<ProfileEvent> snapshot;
+        snapshot.reserve((size_t)(end - begin));
+        for (unsigned long long i = begin; i < end; i++)
+            snapshot.push_back(events[(size_t)(i % events.size())]);
+        return snapshot;
+    }
+};
+
+// buffers outlive their threads so the events of finished workers can still be exported
+static std::mutex threadsMutex;
+static std::vector<std::unique_ptr<ThreadEvents>> threads;
+static thread_local ThreadEvents* currentThread = NULL;
+
+static ThreadEvents* getThreadEvents()
+{
+    // the lock is only taken the first time a thread records something
+    if (currentThread == NULL)
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threads.push_back(std::make_unique<ThreadEvents>((unsigned int)threads.size() + 1));
+        currentThread = threads.back().get();
+    }
+    return currentThread;
+}
+
+void Profiler::Record(const char* name, long long start, long long end)
+{
+    ThreadEvents* thread = getThreadEvents();
+    unsigned long long index = thread->count.load(std::memory_order_relaxed);
+    thread->events[(size_t)(index % thread->events.size())] = { name, start, end };
+    thread->count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadEvents* thread = getThreadEvents();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    thread->name = name;
+}
+
+static void writeJsonString(std::ostream& stream, const std::string& value)
+{
+    stream << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            stream << '\\';
+        stream << c;
+    }
+    stream << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(threadsMutex);
+
+    // complete ("X") events with microsecond timestamps, one track per thread
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool isFirst = true;
+    for (const auto& thread : threads)
+    {
+        file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+        writeJsonString(file, thread->name.empty() ? "Thread " + std::to_string(thread->id) : thread->name);
+        file << "}}";
+        isFirst = false;
+
+        for (const ProfileEvent& event : thread->Snapshot())
+        {
+            file << ",\n{\"name\":";
+            writeJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+                << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    std::cout << "Profiler trace written to " << path << std::endl;
+    return true;
+}
+
+bool Profiler::WriteFrameTable(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::TABLE_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<ProfileEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (const auto& thread : threads)
+        {
+            std::vector<ProfileEvent> threadEvents = thread->Snapshot();
+            events.insert(events.end(), threadEvents.begin(), threadEvents.end());
+        }
+    }
+
+    // frames are the intervals of the frame scopes, events belong to the frame they started in
+    std::vector<ProfileEvent> frames;
+    for (const ProfileEvent& event : events)
+    {
+        if (std::strcmp(event.name, PROFILER_FRAME_SCOPE) == 0)
+            frames.push_back(event);
+    }
+    std::sort(frames.begin(), frames.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return a.start < b.start; });
+    long long firstFrameStart = frames.empty() ? -1 : frames.front().start;
+
+    struct ScopeStats
+    {
+        std::vector<double> frameTimes;
+        unsigned long long calls = 0;
+        double startupTime = 0.0;
+        unsigned long long startupCalls = 0;
+    };
+    std::map<std::string, ScopeStats> scopes;
+
+    for (const ProfileEvent& event : events)
+    {
+        ScopeStats& stats = scopes[event.name];
+        double milliseconds = (event.end - event.start) / 1.0e6;
+
+        if (firstFrameStart < 0 || event.start < firstFrameStart)
+        {
+            stats.startupTime += milliseconds;
+            stats.startupCalls++;
+            continue;
+        }
+
+        auto next = std::upper_bound(frames.begin(), frames.end(), event.start,
+            [](long long start, const ProfileEvent& frame) { return start < frame.start; });
+        size_t frame = (size_t)(next - frames.begin()) - 1;
+        if (stats.frameTimes.empty())
+            stats.frameTimes.resize(frames.size(), 0.0);
+        stats.frameTimes[frame] += milliseconds;
+        stats.calls++;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "frames: " << frames.size() << "\n\n";
+    file << std::left << std::setw(40) << "scope" << std::right << std::setw(14) << "calls/frame"
+        << std::setw(12) << "mean ms" << std::setw(12) << "max ms" << "\n";
+
+    // most expensive scopes first
+    std::vector<std::pair<double, std::string>> order;
+    for (const auto& scope : scopes)
+    {
+        if (scope.second.calls == 0)
+            continue;
+        double total = 0.0;
+        for (double time : scope.second.frameTimes)
+            total += time;
+        order.push_back({ total / frames.size(), scope.first });
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    for (const auto& entry : order)
+    {
+        const ScopeStats& stats = scopes[entry.second];
+        file << std::left << std::setw(40) << entry.second << std::right
+            << std::setw(14) << (double)stats.calls / frames.size()
+            << std::setw(12) << entry.first
+            << std::setw(12) << *std::max_element(stats.frameTimes.begin(), stats.frameTimes.end()) << "\n";
+    }
+
+    file << "\nbefore the first frame\n\n";
+    file << std::left << std::setw(40) << "scope" << std::right << std::setw(14) << "calls" << std::setw(12) << "total ms" << "\n";
+    for (const auto& scope : scopes)
+    {
+        if (scope.second.startupCalls == 0)
+            continue;
+        file << std::left << std::setw(40) << scope.first << std::right
+            << std::setw(14) << scope.second.startupCalls << std::setw(12) << scope.second.startupTime << "\n";
+    }
+
+    std::cout << "Profiler frame table written to " << path << std::endl;
+    return true;
+}
+
+#else
+
+void Profiler::Record(const char* /*name*/, long long /*start*/, long long /*end*/)
+{
+}
+
+void Profiler::SetThreadName(const char* /*name*/)
+{
+}
+
+bool Profiler::WriteChromeTrace(const std::string& /*path*/)
+{
+    std::cout << "ERROR::PROFILER::DISABLED: build without NDEBUG or with FORCE_PROFILER" << std::endl;
+    return false;
+}
+
+bool Profiler::WriteFrameTable(const std::string& /*path*/)
+{
+    std::cout << "ERROR::PROFILER::DISABLED: build without NDEBUG or with FORCE_PROFILER" << std::endl;
+    return false;
+}
+
+#endif
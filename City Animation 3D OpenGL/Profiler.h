@@ -0,0 +1,64 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+// markers are compiled out of release builds unless FORCE_PROFILER is defined
+#if !defined(NDEBUG) || defined(FORCE_PROFILER)
+#define PROFILER_ENABLED
+#endif
+
+// name of the scope delimiting frames in the per-frame table
+#define PROFILER_FRAME_SCOPE "Frame"
+
+// Scoped CPU profiler: every thread records the begin and end timestamps of named scopes into its
+// own ring buffer without locking, the oldest events are overwritten once the buffer is full.
+class Profiler
+{
+public:
+    // events kept per thread
+    static const unsigned int EVENTS_PER_THREAD = 1 << 16;
+
+    // nanoseconds since the program started
+    static long long Now();
+    // name must be a string literal, only the pointer is stored
+    static void Record(const char* name, long long start, long long end);
+    // shown as the name of the calling thread in the trace
+    static void SetThreadName(const char* name);
+
+    // both exports read the buffers of every thread, call them while the other threads are idle
+    // Chrome / Perfetto trace event JSON of everything still in the buffers
+    static bool WriteChromeTrace(const std::string& path);
+    // per-scope time of an average and of the worst frame, plus the scopes that ran before the first frame
+    static bool WriteFrameTable(const std::string& path);
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name) : name(name), start(Profiler::Now()) {}
+    ~ProfileScope() { Profiler::Record(name, start, Profiler::Now()); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    long long start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILER_ENABLED
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FRAME() PROFILE_SCOPE(PROFILER_FRAME_SCOPE)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME()
+#define PROFILE_THREAD(name)
+#endif
+
+#endif
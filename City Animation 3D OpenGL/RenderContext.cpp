@@ -0,0 +1,239 @@
+#include "RenderContext.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#ifdef HEADLESS_RENDERING_SUPPORTED
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+WindowRenderContext::WindowRenderContext(unsigned int width, unsigned int height, const char* title) : window(NULL)
+{
+    Width = width;
+    Height = height;
+
+    // instantiate the GLFW window
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // create a window object
+    window = glfwCreateWindow(width, height, title, glfwGetPrimaryMonitor(), NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        return;
+    }
+    glfwMakeContextCurrent(window);
+}
+
+WindowRenderContext::~WindowRenderContext()
+{
+    for (GLFWwindow* sharedWindow : sharedWindows)
+        glfwDestroyWindow(sharedWindow);
+
+    // terminate GLFW's resources
+    glfwTerminate();
+}
+
+GLADloadproc WindowRenderContext::GetProcAddressLoader()
+{
+    return (GLADloadproc)glfwGetProcAddress;
+}
+
+bool WindowRenderContext::ShouldClose()
+{
+    return glfwWindowShouldClose(window);
+}
+
+void WindowRenderContext::SwapBuffers()
+{
+    glfwSwapBuffers(window);
+}
+
+void WindowRenderContext::PollEvents()
+{
+    glfwPollEvents();
+}
+
+double WindowRenderContext::GetTime()
+{
+    return glfwGetTime();
+}
+
+std::function<void(bool)> WindowRenderContext::CreateSharedContext()
+{
+    // a hidden window is the only way to get another context from GLFW
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* sharedWindow = glfwCreateWindow(1, 1, "", NULL, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (sharedWindow == NULL)
+        return std::function<void(bool)>();
+
+    sharedWindows.push_back(sharedWindow);
+    return [sharedWindow](bool isBound) { glfwMakeContextCurrent(isBound ? sharedWindow : NULL); };
+}
+
+#ifdef HEADLESS_RENDERING_SUPPORTED
+
+HeadlessRenderContext::HeadlessRenderContext(unsigned int width, unsigned int height, unsigned int framesCount)
+    : display(EGL_NO_DISPLAY), config(NULL), context(NULL), framebuffer(0), colorBuffer(0), depthBuffer(0),
+    framesCount(framesCount), renderedFrames(0), startTime(0.0)
+{
+    Width = width;
+    Height = height;
+    startTime = GetTime();
+
+    // Mesa's surfaceless platform needs neither a display server nor a GPU (llvmpipe)
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay eglDisplay = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, NULL, NULL))
+    {
+        std::cout << "Failed to initialize surfaceless EGL display" << std::endl;
+        return;
+    }
+    display = eglDisplay;
+
+    EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig eglConfig = NULL;
+    EGLint configsCount = 0;
+    eglChooseConfig(eglDisplay, configAttributes, &eglConfig, 1, &configsCount);
+    config = configsCount > 0 ? eglConfig : EGL_NO_CONFIG_KHR;
+
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, (EGLConfig)config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        std::cout << "Failed to create headless OpenGL context" << std::endl;
+        return;
+    }
+    context = eglContext;
+}
+
+HeadlessRenderContext::~HeadlessRenderContext()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+
+    if (display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    for (void* sharedContext : sharedContexts)
+        eglDestroyContext((EGLDisplay)display, (EGLContext)sharedContext);
+    if (context != NULL)
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    eglTerminate((EGLDisplay)display);
+}
+
+bool HeadlessRenderContext::CreateFramebuffer()
+{
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Failed to create headless framebuffer" << std::endl;
+        return false;
+    }
+
+    // the framebuffer stays bound for the whole render loop
+    glViewport(0, 0, Width, Height);
+    return true;
+}
+
+bool HeadlessRenderContext::SaveFrame(const std::string& path)
+{
+    std::vector<unsigned char> pixels(Width * Height * 3);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to write frame to: " << path << std::endl;
+        return false;
+    }
+
+    // OpenGL rows go bottom-up, PPM rows top-down
+    file << "P6\n" << Width << " " << Height << "\n255\n";
+    for (unsigned int row = Height; row-- > 0;)
+        file.write((const char*)&pixels[row * Width * 3], Width * 3);
+    return true;
+}
+
+GLADloadproc HeadlessRenderContext::GetProcAddressLoader()
+{
+    return (GLADloadproc)eglGetProcAddress;
+}
+
+bool HeadlessRenderContext::ShouldClose()
+{
+    return renderedFrames >= framesCount;
+}
+
+void HeadlessRenderContext::SwapBuffers()
+{
+    // there is nothing to present, just hand the frame over to the driver
+    glFlush();
+    renderedFrames++;
+}
+
+void HeadlessRenderContext::PollEvents()
+{
+}
+
+double HeadlessRenderContext::GetTime()
+{
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return now - startTime;
+}
+
+std::function<void(bool)> HeadlessRenderContext::CreateSharedContext()
+{
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext sharedContext = eglCreateContext((EGLDisplay)display, (EGLConfig)config, (EGLContext)context, contextAttributes);
+    if (sharedContext == EGL_NO_CONTEXT)
+        return std::function<void(bool)>();
+
+    sharedContexts.push_back(sharedContext);
+    EGLDisplay eglDisplay = (EGLDisplay)display;
+    return [eglDisplay, sharedContext](bool isBound) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, isBound ? sharedContext : EGL_NO_CONTEXT);
+    };
+}
+
+#endif
\ No newline at end of file
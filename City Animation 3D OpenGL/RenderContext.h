@@ -0,0 +1,100 @@
+#pragma once
+#ifndef RENDER_CONTEXT_H
+#define RENDER_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// surfaceless EGL contexts (e.g. Mesa llvmpipe) are only available on Linux
+#if defined(__linux__)
+#define HEADLESS_RENDERING_SUPPORTED
+#endif
+
+// Owns the OpenGL context the render loop draws with, either a GLFW window or an offscreen
+// framebuffer, so the same loop runs on desktops and on machines without a display or GPU.
+class RenderContext
+{
+public:
+    virtual ~RenderContext() {}
+
+    // window used for input, NULL when there is none
+    virtual GLFWwindow* GetWindow() = 0;
+    virtual GLADloadproc GetProcAddressLoader() = 0;
+    virtual bool ShouldClose() = 0;
+    virtual void SwapBuffers() = 0;
+    virtual void PollEvents() = 0;
+    // seconds since the context was created
+    virtual double GetTime() = 0;
+    // returns a callback binding (true) or releasing (false) a new context shared with the main one
+    // on the calling thread, or an empty function if it can't be created
+    virtual std::function<void(bool)> CreateSharedContext() = 0;
+
+    unsigned int GetWidth() const { return Width; }
+    unsigned int GetHeight() const { return Height; }
+
+protected:
+    unsigned int Width;
+    unsigned int Height;
+};
+
+// fullscreen window on the primary monitor
+class WindowRenderContext : public RenderContext
+{
+public:
+    WindowRenderContext(unsigned int width, unsigned int height, const char* title);
+    ~WindowRenderContext();
+
+    bool IsValid() const { return window != NULL; }
+
+    GLFWwindow* GetWindow() override { return window; }
+    GLADloadproc GetProcAddressLoader() override;
+    bool ShouldClose() override;
+    void SwapBuffers() override;
+    void PollEvents() override;
+    double GetTime() override;
+    std::function<void(bool)> CreateSharedContext() override;
+
+private:
+    GLFWwindow* window;
+    std::vector<GLFWwindow*> sharedWindows;
+};
+
+#ifdef HEADLESS_RENDERING_SUPPORTED
+// surfaceless EGL context rendering into a framebuffer object, stops after a given number of frames
+class HeadlessRenderContext : public RenderContext
+{
+public:
+    HeadlessRenderContext(unsigned int width, unsigned int height, unsigned int framesCount);
+    ~HeadlessRenderContext();
+
+    bool IsValid() const { return context != NULL; }
+    // makes the framebuffer object the render target, needs the GL functions to be loaded
+    bool CreateFramebuffer();
+    // writes the last rendered frame as a binary PPM image
+    bool SaveFrame(const std::string& path);
+
+    GLFWwindow* GetWindow() override { return NULL; }
+    GLADloadproc GetProcAddressLoader() override;
+    bool ShouldClose() override;
+    void SwapBuffers() override;
+    void PollEvents() override;
+    double GetTime() override;
+    std::function<void(bool)> CreateSharedContext() override;
+
+private:
+    void* display;
+    void* config;
+    void* context;
+    std::vector<void*> sharedContexts;
+    unsigned int framebuffer, colorBuffer, depthBuffer;
+    unsigned int framesCount;
+    unsigned int renderedFrames;
+    double startTime;
+};
+#endif
+
+#endif
\ No newline at end of file
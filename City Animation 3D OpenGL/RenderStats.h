@@ -0,0 +1,36 @@
+#pragma once
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Counters of the work submitted to OpenGL during the current frame.
+struct RenderStats
+{
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+    unsigned int programBinds = 0;
+    unsigned int vertexArrayBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int uniformUpdates = 0;
+
+    void AddDraw(unsigned long long trianglesCount)
+    {
+        drawCalls++;
+        triangles += trianglesCount;
+    }
+
+    // pipeline state changes issued by the renderer
+    unsigned int StateChanges() const
+    {
+        return programBinds + vertexArrayBinds + textureBinds;
+    }
+
+    void Reset()
+    {
+        *this = RenderStats();
+    }
+};
+
+// reset by the render loop at the start of every frame
+inline RenderStats renderStats;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include "ResourcePack.h"
+#include "Lz4.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+const char PACK_MAGIC[4] = { 'C', 'P', 'A', 'K' };
+
+// at the start of the archive, padded to ALIGNMENT; the archive is written in the byte order of the
+// machine packing it, little endian on every platform the application builds for
+struct PackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entriesCount;
+    uint32_t blockSize;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
+
+// an entry of the index, its name follows it; a compressed entry starts with the count of its blocks
+// and their compressed sizes as 32 bit numbers
+struct PackRecord
+{
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    uint32_t compression;
+    uint32_t nameLength;
+};
+
+ResourcePack* mountedPack = NULL;
+
+// names use forward slashes and no "." directories, so a texture path from a material finds its entry
+static std::string normalizeName(const std::string& path)
+{
+    std::string name;
+    name.reserve(path.size());
+    size_t begin = 0;
+    while (begin <= path.size())
+    {
+        size_t end = path.find_first_of("/\\", begin);
+        if (end == std::string::npos)
+            end = path.size();
+        std::string part = path.substr(begin, end - begin);
+        if (!part.empty() && part != ".")
+        {
+            if (!name.empty())
+                name += '/';
+            name += part;
+        }
+        begin = end + 1;
+    }
+    return name;
+}
+
+static size_t blockSize(uint64_t size, size_t block)
+{
+    return (size_t)std::min((uint64_t)ResourcePack::BLOCK_SIZE, size - (uint64_t)block * ResourcePack::BLOCK_SIZE);
+}
+
+static size_t blocksCount(uint64_t size)
+{
+    return (size_t)((size + ResourcePack::BLOCK_SIZE - 1) / ResourcePack::BLOCK_SIZE);
+}
+
+static void writePadding(std::ofstream& out)
+{
+    static const char ZEROS[ResourcePack::ALIGNMENT] = {};
+    size_t position = (size_t)out.tellp();
+    out.write(ZEROS, (ResourcePack::ALIGNMENT - position % ResourcePack::ALIGNMENT) % ResourcePack::ALIGNMENT);
+}
+
+// the block table and the blocks of a compressed entry, false if they end up larger than the file
+static bool compressBlocks(const char* data, size_t size, std::vector<char>& stored)
+{
+    uint32_t count = (uint32_t)blocksCount(size);
+    stored.assign(sizeof(uint32_t) * (count + 1), 0);
+    memcpy(stored.data(), &count, sizeof(count));
+    std::vector<char> block(Lz4::CompressBound(ResourcePack::BLOCK_SIZE));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t compressedSize = Lz4::Compress(data + (size_t)i * ResourcePack::BLOCK_SIZE, blockSize(size, i), block.data(), block.size());
+        if (compressedSize == 0 || stored.size() + compressedSize >= size)
+            return false;
+        uint32_t storedBlockSize = (uint32_t)compressedSize;
+        memcpy(stored.data() + sizeof(uint32_t) * (i + 1), &storedBlockSize, sizeof(storedBlockSize));
+        stored.insert(stored.end(), block.begin(), block.begin() + compressedSize);
+    }
+    return true;
+}
+
+bool ResourcePack::Open(const std::string& path)
+{
+    PROFILE_SCOPE("ResourcePack::Open");
+
+    Close();
+    if (!file.Open(path))
+    {
+        std::cout << "ERROR::RESOURCE_PACK::FILE_NOT_FOUND: " << path << std::endl;
+        return false;
+    }
+
+    const char* data = file.GetData();
+    uint64_t size = file.GetSize();
+    PackHeader header = {};
+    bool isValid = size >= sizeof(header);
+    if (isValid)
+    {
+        memcpy(&header, data, sizeof(header));
+        isValid = memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 && header.version == VERSION && header.blockSize == BLOCK_SIZE
+            && header.indexOffset <= size && header.indexSize <= size - header.indexOffset;
+    }
+
+    // every entry must lie within the file, so reads need no more checks than the block tables; a
+    // compressed entry can't be larger than its stored bytes decompress to, so a damaged size is
+    // rejected here instead of being allocated
+    const char* record = data + header.indexOffset;
+    const char* indexEnd = record + header.indexSize;
+    for (uint32_t i = 0; isValid && i < header.entriesCount; i++)
+    {
+        PackRecord packRecord;
+        isValid = (size_t)(indexEnd - record) >= sizeof(packRecord);
+        if (!isValid)
+            break;
+        memcpy(&packRecord, record, sizeof(packRecord));
+        record += sizeof(packRecord);
+        isValid = packRecord.nameLength <= (size_t)(indexEnd - record) && packRecord.offset <= size && packRecord.storedSize <= size - packRecord.offset
+            && ((packRecord.compression == COMPRESSION_LZ4 && packRecord.size / Lz4::MAX_RATIO <= packRecord.storedSize)
+                || (packRecord.compression == COMPRESSION_NONE && packRecord.storedSize == packRecord.size));
+        if (!isValid)
+            break;
+
+        entryIndices[std::string(record, packRecord.nameLength)] = entries.size();
+        entries.push_back({ packRecord.offset, packRecord.storedSize, packRecord.size, packRecord.compression });
+        record += packRecord.nameLength;
+    }
+    if (!isValid)
+    {
+        std::cout << "ERROR::RESOURCE_PACK::INVALID_ARCHIVE: " << path << std::endl;
+        Close();
+        return false;
+    }
+
+    decompressed.resize(entries.size());
+    isDecompressed.reset(new std::atomic<bool>[entries.size()]);
+    for (size_t i = 0; i < entries.size(); i++)
+        isDecompressed[i].store(entries[i].compression == COMPRESSION_NONE);
+    return true;
+}
+
+void ResourcePack::Close()
+{
+    file.Close();
+    entries.clear();
+    entryIndices.clear();
+    decompressed.clear();
+    isDecompressed.reset();
+}
+
+bool ResourcePack::Contains(const std::string& name) const
+{
+    size_t index;
+    return findEntry(name, index);
+}
+
+bool ResourcePack::Read(const std::string& name, ResourceSpan& span)
+{
+    size_t index;
+    if (!findEntry(name, index))
+        return false;
+
+    const Entry& entry = entries[index];
+    if (entry.compression == COMPRESSION_NONE)
+    {
+        span.data = file.GetData() + entry.offset;
+        span.size = (size_t)entry.size;
+        return true;
+    }
+
+    if (!isDecompressed[index].load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(decompressMutex);
+        if (!isDecompressed[index].load(std::memory_order_relaxed))
+        {
+            PROFILE_SCOPE("ResourcePack::Read");
+
+            std::vector<ResourceSpan> blocks;
+            std::unique_ptr<char[]> data;
+            bool isValid = readBlockTable(entry, blocks);
+            if (isValid)
+                data.reset(new char[(size_t)entry.size]);
+            for (size_t i = 0; isValid && i < blocks.size(); i++)
+                isValid = Lz4::Decompress(blocks[i].data, blocks[i].size, data.get() + i * BLOCK_SIZE, blockSize(entry.size, i));
+            if (!isValid)
+            {
+                std::cout << "ERROR::RESOURCE_PACK::CORRUPT_ENTRY: " << name << std::endl;
+                return false;
+            }
+            decompressed[index] = std::move(data);
+            isDecompressed[index].store(true, std::memory_order_release);
+        }
+    }
+
+    span.data = decompressed[index].get();
+    span.size = (size_t)entry.size;
+    return true;
+}
+
+void ResourcePack::Decompress(const std::string& prefix, JobSystem* jobs)
+{
+    PROFILE_SCOPE("ResourcePack::Decompress");
+
+    struct BlockJob
+    {
+        size_t entry;
+        ResourceSpan source;
+        char* destination;
+        size_t size;
+    };
+
+    // the blocks of every matching entry form one parallel loop, so a large entry doesn't run alone
+    std::lock_guard<std::mutex> lock(decompressMutex);
+    std::vector<BlockJob> blockJobs;
+    std::vector<std::pair<std::string, size_t>> entriesDecompressed;
+    for (const auto& pair : entryIndices)
+    {
+        size_t index = pair.second;
+        if (isDecompressed[index].load(std::memory_order_relaxed) || pair.first.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        std::vector<ResourceSpan> blocks;
+        if (!readBlockTable(entries[index], blocks))
+        {
+            std::cout << "ERROR::RESOURCE_PACK::CORRUPT_ENTRY: " << pair.first << std::endl;
+            continue;
+        }
+        decompressed[index].reset(new char[(size_t)entries[index].size]);
+        for (size_t i = 0; i < blocks.size(); i++)
+            blockJobs.push_back({ index, blocks[i], decompressed[index].get() + i * BLOCK_SIZE, blockSize(entries[index].size, i) });
+        entriesDecompressed.push_back(pair);
+    }
+
+    // every block reports into its own flag
+    std::vector<char> isBlockValid(blockJobs.size(), 0);
+    auto decompressBlocks = [&blockJobs, &isBlockValid](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            isBlockValid[i] = Lz4::Decompress(blockJobs[i].source.data, blockJobs[i].source.size, blockJobs[i].destination, blockJobs[i].size);
+    };
+    if (jobs != NULL)
+        jobs->ParallelFor(0, blockJobs.size(), 1, decompressBlocks);
+    else
+        decompressBlocks(0, blockJobs.size());
+
+    for (size_t i = 0; i < blockJobs.size(); i++)
+    {
+        if (!isBlockValid[i])
+            decompressed[blockJobs[i].entry].reset();
+    }
+    for (const auto& entry : entriesDecompressed)
+    {
+        if (decompressed[entry.second])
+            isDecompressed[entry.second].store(true, std::memory_order_release);
+        else
+            std::cout << "ERROR::RESOURCE_PACK::CORRUPT_ENTRY: " << entry.first << std::endl;
+    }
+}
+
+bool ResourcePack::Build(const std::string& directory, const std::string& path, bool compress, std::ostream& log)
+{
+    namespace fs = std::filesystem;
+
+    // entries are named from the directory's own name down, "/data/Resources" packs "Resources/...",
+    // the paths the loaders open; the files are read by the paths they were found at
+    fs::path root = fs::path(directory).lexically_normal();
+    if (!root.has_filename())
+        root = root.parent_path();
+
+    // sorted, so the same files always give the same archive; an archive written into the directory
+    // itself isn't packed
+    std::error_code error;
+    std::error_code outputError;
+    std::vector<std::pair<std::string, fs::path>> files;
+    for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error) && !fs::equivalent(it->path(), path, outputError))
+            files.push_back(std::make_pair(normalizeName((root.filename() / it->path().lexically_relative(directory)).generic_string()), it->path()));
+    }
+    if (error)
+    {
+        std::cout << "ERROR::RESOURCE_PACK::DIRECTORY_NOT_READ: " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cout << "ERROR::RESOURCE_PACK::FILE_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    // the header is written last, once the index's place is known
+    PackHeader header = {};
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = VERSION;
+    header.entriesCount = (uint32_t)files.size();
+    header.blockSize = BLOCK_SIZE;
+    out.write((const char*)&header, sizeof(header));
+    writePadding(out);
+
+    std::vector<char> index;
+    uint64_t totalSize = 0;
+    uint64_t totalStoredSize = 0;
+    for (const auto& file : files)
+    {
+        const std::string& name = file.first;
+        MappedFile input;
+        if (!input.Open(file.second.string()))
+        {
+            std::cout << "ERROR::RESOURCE_PACK::FILE_NOT_FOUND: " << file.second.string() << std::endl;
+            return false;
+        }
+
+        // the entry is kept compressed only if that saves at least an eighth of it
+        std::vector<char> stored;
+        PackRecord record = {};
+        record.offset = (uint64_t)out.tellp();
+        record.size = input.GetSize();
+        record.compression = COMPRESSION_NONE;
+        record.nameLength = (uint32_t)name.size();
+        if (compress && input.GetSize() > 0 && compressBlocks(input.GetData(), input.GetSize(), stored)
+            && stored.size() <= input.GetSize() - input.GetSize() / 8)
+        {
+            record.compression = COMPRESSION_LZ4;
+            out.write(stored.data(), stored.size());
+        }
+        else
+        {
+            out.write(input.GetData(), input.GetSize());
+        }
+        record.storedSize = (uint64_t)out.tellp() - record.offset;
+        writePadding(out);
+
+        const char* recordBytes = (const char*)&record;
+        index.insert(index.end(), recordBytes, recordBytes + sizeof(record));
+        index.insert(index.end(), name.begin(), name.end());
+        totalSize += record.size;
+        totalStoredSize += record.storedSize;
+        log << "RESOURCE_PACK: " << name << ": " << record.size / 1024 << " KB"
+            << (record.compression == COMPRESSION_LZ4 ? " -> " + std::to_string(record.storedSize / 1024) + " KB lz4" : std::string()) << "\n";
+    }
+
+    header.indexOffset = (uint64_t)out.tellp();
+    header.indexSize = index.size();
+    out.write(index.data(), index.size());
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.close();
+    if (!out)
+    {
+        std::cout << "ERROR::RESOURCE_PACK::FILE_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    log << "RESOURCE_PACK: " << files.size() << " files, " << totalSize / 1024 << " KB stored in " << totalStoredSize / 1024 << " KB" << std::endl;
+    return true;
+}
+
+void ResourcePack::Mount(ResourcePack* pack)
+{
+    mountedPack = pack;
+}
+
+ResourcePack* ResourcePack::GetMounted()
+{
+    return mountedPack;
+}
+
+bool ResourcePack::findEntry(const std::string& name, size_t& index) const
+{
+    auto found = entryIndices.find(normalizeName(name));
+    if (found == entryIndices.end())
+        return false;
+    index = found->second;
+    return true;
+}
+
+bool ResourcePack::readBlockTable(const Entry& entry, std::vector<ResourceSpan>& blocks) const
+{
+    const char* data = file.GetData() + entry.offset;
+    uint32_t count;
+    if (entry.storedSize < sizeof(count))
+        return false;
+    memcpy(&count, data, sizeof(count));
+    uint64_t position = sizeof(uint32_t) * ((uint64_t)count + 1);
+    if (count != blocksCount(entry.size) || position > entry.storedSize)
+        return false;
+
+    blocks.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t storedBlockSize;
+        memcpy(&storedBlockSize, data + sizeof(uint32_t) * (i + 1), sizeof(storedBlockSize));
+        if (storedBlockSize > entry.storedSize - position)
+            return false;
+        blocks[i].data = data + position;
+        blocks[i].size = storedBlockSize;
+        position += storedBlockSize;
+    }
+    return true;
+}
+
+bool ResourceFile::Open(const std::string& path)
+{
+    file.Close();
+    span = ResourceSpan();
+    ResourcePack* pack = ResourcePack::GetMounted();
+    if (pack != NULL && pack->Read(path, span))
+        return true;
+
+    if (!file.Open(path))
+        return false;
+    span.data = file.GetData();
+    span.size = file.GetSize();
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef RESOURCE_PACK_H
+#define RESOURCE_PACK_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+// bytes of a resource, valid while the pack or file they come from is open
+struct ResourceSpan
+{
+    const char* data = NULL;
+    size_t size = 0;
+};
+
+// Archive of the resource files, written by Build at build time and mapped into memory at run time,
+// so loading takes one open instead of one per model, material and texture. Entries start at page
+// boundaries and are named by the path they'd be opened with, like "Resources/Car/car.obj". An entry
+// that shrinks enough is stored as LZ4 blocks; the others are handed out as spans of the mapping
+// without copying, the compressed ones are decompressed once into memory the pack keeps.
+class ResourcePack
+{
+public:
+    static const uint32_t VERSION = 1;
+    // entries and the index start at multiples of ALIGNMENT bytes
+    static const size_t ALIGNMENT = 4096;
+    // compressed entries are split into blocks of BLOCK_SIZE bytes decompressed independently
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    ResourcePack() = default;
+
+    ResourcePack(const ResourcePack&) = delete;
+    ResourcePack& operator=(const ResourcePack&) = delete;
+
+    // maps the archive and reads its index, false if it can't be read or isn't a pack of this version
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return file.IsOpen(); }
+    size_t GetEntriesCount() const { return entries.size(); }
+    bool Contains(const std::string& name) const;
+    // false if the pack hasn't got the entry or it fails to decompress; any thread
+    bool Read(const std::string& name, ResourceSpan& span);
+    // decompresses the compressed entries whose names start with prefix, their blocks spread over the
+    // workers; call it before queueing jobs that read from the pack, they'd wait for it
+    void Decompress(const std::string& prefix, JobSystem* jobs);
+
+    // packs every file under directory into an archive at path, named from the directory's own name on;
+    // compresses the entries LZ4 shrinks by at least an eighth if compress is set and writes a line
+    // per entry to log
+    static bool Build(const std::string& directory, const std::string& path, bool compress, std::ostream& log);
+
+    // the pack ResourceFile looks into before the file system, NULL for none; on the main thread
+    // before anything is loaded
+    static void Mount(ResourcePack* pack);
+    static ResourcePack* GetMounted();
+
+private:
+    enum Compression
+    {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_LZ4 = 1
+    };
+
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t compression;
+    };
+
+    MappedFile file;
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, size_t> entryIndices;
+    // memory of the decompressed entries, written under the mutex and published by the ready flags
+    std::vector<std::unique_ptr<char[]>> decompressed;
+    std::unique_ptr<std::atomic<bool>[]> isDecompressed;
+    std::mutex decompressMutex;
+
+    bool findEntry(const std::string& name, size_t& index) const;
+    // locates the blocks of a compressed entry in the mapping, false if they don't fit into it
+    bool readBlockTable(const Entry& entry, std::vector<ResourceSpan>& blocks) const;
+};
+
+// Bytes of a resource file: the mounted pack's entry if it has one, otherwise the file mapped into memory.
+class ResourceFile
+{
+public:
+    // false if neither the pack nor the file system has it
+    bool Open(const std::string& path);
+
+    const char* GetData() const { return span.data; }
+    size_t GetSize() const { return span.size; }
+
+private:
+    MappedFile file;
+    ResourceSpan span;
+};
+
+#endif
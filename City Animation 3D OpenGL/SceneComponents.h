@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SCENE_COMPONENTS_H
+#define SCENE_COMPONENTS_H
+
+#include <glm/glm.hpp>
+
+#include "FramePacket.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+
+// Components of the scene's entities, stored in an EntityStore. PointLight and SpotLight, declared
+// with the frame packet, are components too; their position comes from the entity's Transform.
+
+// world matrix of an entity
+struct Transform
+{
+    glm::mat4 world;
+};
+
+// the entity follows a scene graph node, its Transform is refreshed from the node every frame
+struct NodeLink
+{
+    SceneNode node;
+};
+
+// drawn as the object, culled with its model space bounds
+struct Renderable
+{
+    SceneObject object;
+    BoundingSphere bounds;
+};
+
+// small cube of the given size marking a light
+struct LightTag
+{
+    float scale;
+};
+
+// spot light shining along the car, turned around the vertical axis by the driver
+struct CarReflector
+{
+};
+
+#endif
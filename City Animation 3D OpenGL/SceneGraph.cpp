@@ -0,0 +1,95 @@
+#include "SceneGraph.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+SceneNode SceneGraph::AddNode(SceneNode parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    unsigned int parentSlot = parent == NO_PARENT ? NO_PARENT : slots[parent];
+    unsigned int depth = parent == NO_PARENT ? 0 : depths[parentSlot] + 1;
+
+    // after every node of the same depth, the slots behind it move one place on
+    unsigned int slot = (unsigned int)(std::upper_bound(depths.begin(), depths.end(), depth) - depths.begin());
+    for (unsigned int& nodeSlot : slots)
+    {
+        if (nodeSlot >= slot)
+            nodeSlot++;
+    }
+    for (unsigned int& parentOfSlot : parents)
+    {
+        if (parentOfSlot != NO_PARENT && parentOfSlot >= slot)
+            parentOfSlot++;
+    }
+
+    SceneNode node = (SceneNode)slots.size();
+    slots.push_back(slot);
+    nodes.insert(nodes.begin() + slot, node);
+    parents.insert(parents.begin() + slot, parentSlot);
+    depths.insert(depths.begin() + slot, depth);
+    translations.insert(translations.begin() + slot, translation);
+    rotations.insert(rotations.begin() + slot, rotation);
+    scales.insert(scales.begin() + slot, scale);
+    worldMatrices.insert(worldMatrices.begin() + slot, glm::mat4(1.0f));
+    dirtyFlags.insert(dirtyFlags.begin() + slot, 0);
+
+    markDirty(slot);
+    return node;
+}
+
+void SceneGraph::SetTranslation(SceneNode node, const glm::vec3& translation)
+{
+    translations[slots[node]] = translation;
+    markDirty(slots[node]);
+}
+
+void SceneGraph::SetRotation(SceneNode node, const glm::quat& rotation)
+{
+    rotations[slots[node]] = rotation;
+    markDirty(slots[node]);
+}
+
+void SceneGraph::SetScale(SceneNode node, const glm::vec3& scale)
+{
+    scales[slots[node]] = scale;
+    markDirty(slots[node]);
+}
+
+void SceneGraph::markDirty(unsigned int slot)
+{
+    dirtyFlags[slot] = 1;
+    firstDirtySlot = std::min(firstDirtySlot, (size_t)slot);
+}
+
+void SceneGraph::Update()
+{
+    PROFILE_SCOPE("SceneGraph update");
+
+    updatedCount = 0;
+    size_t count = nodes.size();
+    if (firstDirtySlot >= count)
+        return;
+
+    // a node is recomputed when it or its parent changed; parents come first, so their flags are
+    // final by the time their children are reached
+    for (size_t slot = firstDirtySlot; slot < count; slot++)
+    {
+        unsigned int parent = parents[slot];
+        if (parent != NO_PARENT && dirtyFlags[parent])
+            dirtyFlags[slot] = 1;
+        if (!dirtyFlags[slot])
+            continue;
+
+        // translation * rotation * scale, built without the two matrix products
+        glm::mat4 local = glm::mat4_cast(rotations[slot]);
+        local[0] = local[0] * scales[slot].x;
+        local[1] = local[1] * scales[slot].y;
+        local[2] = local[2] * scales[slot].z;
+        local[3] = glm::vec4(translations[slot], 1.0f);
+
+        worldMatrices[slot] = parent == NO_PARENT ? local : worldMatrices[parent] * local;
+        updatedCount++;
+    }
+
+    std::fill(dirtyFlags.begin() + firstDirtySlot, dirtyFlags.end(), 0);
+    firstDirtySlot = count;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+// handle of a scene graph node, stays valid while nodes are added
+typedef unsigned int SceneNode;
+
+// Hierarchy of transforms: every node has a translation, rotation and scale relative to its parent
+// and caches its world matrix. The nodes are kept in flat arrays, one per field, sorted by their
+// depth in the hierarchy, so a parent always comes before its children and Update is a single pass
+// from the first changed node on. Nodes nobody changed since the last update aren't touched again.
+class SceneGraph
+{
+public:
+    static const SceneNode NO_PARENT = ~0u;
+
+    SceneNode AddNode(SceneNode parent = NO_PARENT, const glm::vec3& translation = glm::vec3(0.0f),
+        const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+
+    // the new transform reaches the world matrices of the node and its descendants on the next Update
+    void SetTranslation(SceneNode node, const glm::vec3& translation);
+    void SetRotation(SceneNode node, const glm::quat& rotation);
+    void SetScale(SceneNode node, const glm::vec3& scale);
+
+    // recomputes the world matrices of the changed nodes and their descendants
+    void Update();
+
+    // as of the last Update
+    const glm::mat4& GetWorldMatrix(SceneNode node) const { return worldMatrices[slots[node]]; }
+    glm::vec3 GetWorldPosition(SceneNode node) const { return glm::vec3(worldMatrices[slots[node]][3]); }
+
+    size_t GetNodeCount() const { return nodes.size(); }
+    // world matrices the last Update computed
+    size_t GetUpdatedCount() const { return updatedCount; }
+
+private:
+    // indexed by slot, the position in depth order
+    std::vector<SceneNode> nodes;
+    std::vector<unsigned int> parents;
+    std::vector<unsigned int> depths;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<unsigned char> dirtyFlags;
+
+    // slot of every node, by handle
+    std::vector<unsigned int> slots;
+
+    // every slot before it is up to date, so are their ancestors
+    size_t firstDirtySlot = 0;
+    size_t updatedCount = 0;
+
+    void markDirty(unsigned int slot);
+};
+
+#endif
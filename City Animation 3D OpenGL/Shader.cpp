@@ -1,136 +1,581 @@
 #include "Shader.h"
+#include "ShaderCompiler.h"
+#include "RenderStats.h"
+#include "Profiler.h"
 
+#include <cassert>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <filesystem>
+#include <cstring>
+#include <thread>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+// header written in front of every cached program binary
+struct ProgramBinaryHeader
 {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+
+const uint32_t PROGRAM_BINARY_MAGIC = 0x42504143; // "CAPB"
+
+std::string Shader::binaryCacheDirectory;
+bool Shader::isParallelCompileEnabled = false;
+ShaderCompiler* Shader::compiler = nullptr;
+
+// KHR_parallel_shader_compile isn't part of the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRY* MaxShaderCompilerThreadsProc)(GLuint count);
+
+// 64-bit FNV-1a, used to key cached binaries by their sources and the driver
+static uint64_t hashString(const std::string& value, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : value)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string glString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value ? (const char*)value : "";
+}
+
+// reads a shader file and recursively replaces its #include "file" directives (paths relative to the including file)
+static std::string readShaderSource(const std::string& path, std::set<std::string>& includedFiles)
+{
+    // every file is included only once, like with #pragma once
+    if (!includedFiles.insert(path).second)
+        return "";
+
+    std::string code;
+    std::ifstream shaderFile;
+
     // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try
     {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        shaderFile.open(path);
+        std::stringstream shaderStream;
+        shaderStream << shaderFile.rdbuf();
+        shaderFile.close();
+        code = shaderStream.str();
     }
     catch (std::ifstream::failure& e)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-    }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    
-    // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
-    
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-    
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << " " << e.what() << std::endl;
+        return "";
+    }
+
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::stringstream result;
+    std::istringstream lines(code);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t directive = line.find_first_not_of(" \t");
+        if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+        {
+            size_t first = line.find('"', directive);
+            size_t last = line.find('"', first + 1);
+            if (first == std::string::npos || last == std::string::npos)
+            {
+                std::cout << "ERROR::SHADER::INVALID_INCLUDE: " << path << ": " << line << std::endl;
+                continue;
+            }
+            result << readShaderSource(directory + line.substr(first + 1, last - first - 1), includedFiles) << "\n";
+        }
+        else
+        {
+            result << line << "\n";
+        }
+    }
+    return result.str();
+}
+
+// inserts the variant's #defines right after the #version directive, which has to stay the first line
+static std::string specializeSource(const std::string& code, const std::string& defines)
+{
+    size_t version = code.find("#version");
+    size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+    if (lineEnd == std::string::npos)
+        return defines + code;
+
+    return code.substr(0, lineEnd + 1) + defines + "#line 2\n" + code.substr(lineEnd + 1);
+}
+
+unsigned int ShaderVariant::key() const
+{
+    // 1 bit day, 1 bit textured, 2 bits fog equation, 4 bits per light count, 1 bit instanced
+    assert(pointLightsCount >= 0 && pointLightsCount <= MAX_VARIANT_LIGHTS);
+    assert(spotLightsCount >= 0 && spotLightsCount <= MAX_VARIANT_LIGHTS);
+    return (isDay ? 1u : 0u)
+        | (isTextured ? 1u : 0u) << 1
+        | (unsigned int)(fogEquation + 1) << 2
+        | (unsigned int)pointLightsCount << 4
+        | (unsigned int)spotLightsCount << 8
+        | (isInstanced ? 1u : 0u) << 12;
+}
+
+std::string ShaderVariant::defines() const
+{
+    std::stringstream result;
+    if (isDay)
+        result << "#define IS_DAY\n";
+    if (isTextured)
+        result << "#define IS_TEXTURED\n";
+    if (fogEquation != FOG_DISABLED)
+        result << "#define FOG_EQUATION " << fogEquation << "\n";
+    if (isInstanced)
+        result << "#define IS_INSTANCED\n";
+    result << "#define POINT_LIGHTS_COUNTER " << pointLightsCount << "\n";
+    result << "#define SPOT_LIGHTS_COUNTER " << spotLightsCount << "\n";
+    return result.str();
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* tessControlPath, const char* tessEvaluationPath) : ID(0)
+{
+    // retrieve the source code of the stages from filePath, programs are compiled on demand
+    std::set<std::string> vertexIncludes, fragmentIncludes;
+    code.vertex = readShaderSource(vertexPath, vertexIncludes);
+    code.fragment = readShaderSource(fragmentPath, fragmentIncludes);
+    if (tessControlPath != NULL && tessEvaluationPath != NULL)
+    {
+        std::set<std::string> tessControlIncludes, tessEvaluationIncludes;
+        code.tessControl = readShaderSource(tessControlPath, tessControlIncludes);
+        code.tessEvaluation = readShaderSource(tessEvaluationPath, tessEvaluationIncludes);
+    }
+}
+
+Shader::~Shader()
+{
+    for (auto& program : programs)
+        glDeleteProgram(program.second);
+
+    // queued jobs of the worker threads are dropped, the ones being compiled are waited for, so no
+    // program they link is left behind
+    for (auto& pending : pendingPrograms)
+    {
+        if (pending.second.job)
+        {
+            ShaderCompileJob& job = *pending.second.job;
+            if (compiler)
+                compiler->cancel(pending.second.job);
+            while (!job.isDone.load(std::memory_order_acquire) && !job.isCancelled.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            if (job.isDone.load(std::memory_order_acquire))
+                glDeleteProgram(job.program);
+            continue;
+        }
+        for (unsigned int shader : pending.second.shaders)
+            glDeleteShader(shader);
+        glDeleteProgram(pending.second.program);
+    }
+}
+
+bool Shader::setVariant(const ShaderVariant& variant)
+{
+    unsigned int key = variant.key();
+    if (programs.find(key) == programs.end())
+    {
+        if (pendingPrograms.find(key) == pendingPrograms.end())
+            submitProgram(variant);
+
+        // keep rendering with the last ready variant until this one is done; with none ready yet,
+        // use() waits for this one
+        if (!pollProgram(key, false))
+        {
+            if (ID == 0)
+                currentVariant = variant;
+            return false;
+        }
+    }
+
+    currentVariant = variant;
+    ID = programs[key];
+    return true;
+}
+
+void Shader::waitForPrograms()
+{
+    while (!pendingPrograms.empty())
+        pollProgram(pendingPrograms.begin()->first, true);
+}
+
+void Shader::precompile(const ShaderVariant& variant)
+{
+    unsigned int key = variant.key();
+    if (programs.find(key) == programs.end() && pendingPrograms.find(key) == pendingPrograms.end())
+        submitProgram(variant);
+}
+
+void Shader::captureVaryings(const std::vector<std::string>& varyings)
+{
+    code.feedbackVaryings = varyings;
+}
+
+void Shader::setBinaryCacheDirectory(const std::string& directory)
+{
+    binaryCacheDirectory.clear();
+    if (directory.empty() || !GLAD_GL_VERSION_4_1)
+        return;
+
+    // drivers are allowed to support no binary formats at all
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        std::cout << "ERROR::SHADER::BINARY_CACHE_UNAVAILABLE: " << directory << " " << error.message() << std::endl;
+        return;
+    }
+    binaryCacheDirectory = directory;
+}
+
+bool Shader::enableParallelCompile(GLADloadproc loadProc)
+{
+    int extensionsCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionsCount);
+
+    bool isSupported = false;
+    for (int i = 0; i < extensionsCount && !isSupported; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        isSupported = std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0
+            || std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0;
+    }
+    if (!isSupported)
+        return false;
+
+    // let the driver pick the number of compiler threads
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loadProc("glMaxShaderCompilerThreadsKHR");
+    if (!maxShaderCompilerThreads)
+        maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loadProc("glMaxShaderCompilerThreadsARB");
+    if (maxShaderCompilerThreads)
+        maxShaderCompilerThreads(0xFFFFFFFF);
+
+    isParallelCompileEnabled = true;
+    return true;
+}
+
+void Shader::setCompiler(ShaderCompiler* shaderCompiler)
+{
+    compiler = shaderCompiler;
+}
+
+void Shader::submitProgram(const ShaderVariant& variant)
+{
+    std::string defines = variant.defines();
+    ShaderSources sources = code;
+    sources.vertex = specializeSource(code.vertex, defines);
+    sources.fragment = specializeSource(code.fragment, defines);
+    if (!code.tessControl.empty())
+    {
+        sources.tessControl = specializeSource(code.tessControl, defines);
+        sources.tessEvaluation = specializeSource(code.tessEvaluation, defines);
+    }
+    unsigned int key = variant.key();
+
+    // try the binary cache first, falling back to compiling when it is missing or rejected by the driver
+    PendingProgram pending;
+    if (!binaryCacheDirectory.empty())
+    {
+        pending.cachePath = binaryCachePath(variant, sources);
+        unsigned int cached = loadProgramBinary(pending.cachePath);
+        if (cached != 0)
+        {
+            programs[key] = cached;
+            return;
+        }
+    }
+    bool isRetrievable = !pending.cachePath.empty();
+
+    if (compiler && !isParallelCompileEnabled)
+    {
+        pending.job = compiler->submit(sources, isRetrievable);
+    }
+    else
+    {
+        // without parallel compilation this blocks on the first status query in pollProgram
+        pending.program = startProgram(sources, isRetrievable, pending.shaders);
+    }
+    pendingPrograms[key] = pending;
+}
+
+bool Shader::pollProgram(unsigned int key, bool wait)
+{
+    auto found = pendingPrograms.find(key);
+    if (found == pendingPrograms.end())
+        return programs.find(key) != programs.end();
+
+    PendingProgram& pending = found->second;
+    unsigned int program;
+    if (pending.job)
+    {
+        while (!pending.job->isDone.load(std::memory_order_acquire))
+        {
+            if (!wait)
+                return false;
+            std::this_thread::yield();
+        }
+        program = pending.job->program;
+    }
+    else
+    {
+        if (isParallelCompileEnabled && !wait)
+        {
+            int isCompleted = 0;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &isCompleted);
+            if (!isCompleted)
+                return false;
+        }
+        program = pending.program;
+        finishProgram(program, pending.shaders);
+    }
+
+    if (!pending.cachePath.empty())
+        saveProgramBinary(program, pending.cachePath);
+
+    programs[key] = program;
+    pendingPrograms.erase(found);
+    return true;
+}
+
+// names of the shader types in the compilation error messages
+static std::string shaderTypeName(unsigned int shader)
+{
+    int type = 0;
+    glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+    switch (type)
+    {
+    case GL_VERTEX_SHADER:
+        return "VERTEX";
+    case GL_TESS_CONTROL_SHADER:
+        return "TESS_CONTROL";
+    case GL_TESS_EVALUATION_SHADER:
+        return "TESS_EVALUATION";
+    default:
+        return "FRAGMENT";
+    }
+}
+
+unsigned int Shader::startProgram(const ShaderSources& sources, bool isRetrievable, std::vector<unsigned int>& shaders)
+{
+    PROFILE_SCOPE("Shader::startProgram");
+
+    // shader Program, every stage is compiled and attached in pipeline order
+    unsigned int program = glCreateProgram();
+    auto addStage = [program, &shaders](GLenum type, const std::string& source) {
+        const char* shaderCode = source.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    };
+
+    shaders.clear();
+    addStage(GL_VERTEX_SHADER, sources.vertex);
+    if (!sources.tessControl.empty())
+    {
+        addStage(GL_TESS_CONTROL_SHADER, sources.tessControl);
+        addStage(GL_TESS_EVALUATION_SHADER, sources.tessEvaluation);
+    }
+    addStage(GL_FRAGMENT_SHADER, sources.fragment);
+
+    if (!sources.feedbackVaryings.empty())
+    {
+        std::vector<const char*> varyings;
+        for (const std::string& varying : sources.feedbackVaryings)
+            varyings.push_back(varying.c_str());
+        glTransformFeedbackVaryings(program, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+    if (isRetrievable)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+
+    return program;
+}
+
+void Shader::finishProgram(unsigned int program, const std::vector<unsigned int>& shaders)
+{
+    // querying the status waits for the driver to finish compiling and linking
+    PROFILE_SCOPE("Shader::finishProgram");
+
+    for (unsigned int shader : shaders)
+        checkCompileErrors(shader, shaderTypeName(shader));
+    checkCompileErrors(program, "PROGRAM");
+
     // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    for (unsigned int shader : shaders)
+        glDeleteShader(shader);
+}
+
+std::string Shader::binaryCachePath(const ShaderVariant& variant, const ShaderSources& sources) const
+{
+    // the sources already contain the variant's #defines, the key is hashed in as well to keep variants apart
+    uint64_t hash = hashString(sources.vertex);
+    hash = hashString(sources.tessControl, hash);
+    hash = hashString(sources.tessEvaluation, hash);
+    hash = hashString(sources.fragment, hash);
+    for (const std::string& varying : sources.feedbackVaryings)
+        hash = hashString(varying, hash);
+    hash = hashString(glString(GL_VENDOR), hash);
+    hash = hashString(glString(GL_RENDERER), hash);
+    hash = hashString(glString(GL_VERSION), hash);
+    hash = hashString(std::to_string(variant.key()), hash);
+
+    std::stringstream path;
+    path << binaryCacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+    return path.str();
+}
+
+unsigned int Shader::loadProgramBinary(const std::string& path)
+{
+    PROFILE_SCOPE("Shader::loadProgramBinary");
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 0;
+
+    ProgramBinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_BINARY_MAGIC || header.length == 0)
+        return 0;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length))
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+
+    // a driver update invalidates old binaries, the program then has to be rebuilt from source
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void Shader::saveProgramBinary(unsigned int program, const std::string& path)
+{
+    int success, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    ProgramBinaryHeader header;
+    header.magic = PROGRAM_BINARY_MAGIC;
+    glGetProgramBinary(program, length, NULL, (GLenum*)&header.format, binary.data());
+    header.length = (uint32_t)length;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), length);
 }
 
 void Shader::use()
 {
+    // nothing to fall back to yet, so the first variant has to be waited for
+    if (ID == 0 && !setVariant(currentVariant))
+    {
+        pollProgram(currentVariant.key(), true);
+        setVariant(currentVariant);
+    }
     glUseProgram(ID);
+    renderStats.programBinds++;
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
     glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
     glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
     glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
     glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
     glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
     glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
     glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
     glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
     glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    renderStats.uniformUpdates++;
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
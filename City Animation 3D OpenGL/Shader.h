@@ -4,19 +4,91 @@
 
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 #include <string>
+#include <map>
+#include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// fog equations understood by the lighting shaders (see Shaders/Include/Lighting.glsl)
+const int FOG_DISABLED = -1;
+const int FOG_LINEAR = 0;
+const int FOG_EXP = 1;
+const int FOG_EXP2 = 2;
+// the program cache's key has 4 bits per light count, a variant lights at most this many of each kind
+const int MAX_VARIANT_LIGHTS = 15;
+
+// Compile-time feature set of a shader program. Every distinct combination is built
+// as a separate program, so the shaders never branch on these values at runtime.
+struct ShaderVariant
+{
+    bool isDay = true;
+    bool isTextured = true;
+    int fogEquation = FOG_DISABLED;
+    int pointLightsCount = 1;
+    int spotLightsCount = 3;
+    // the model matrix and the lamps come from per-instance attributes (see Shaders/Include/Instancing.glsl)
+    bool isInstanced = false;
+
+    // packs the features into a key used to cache compiled programs; the light counts must not
+    // exceed MAX_VARIANT_LIGHTS, larger ones would share another variant's key
+    unsigned int key() const;
+    // #define lines injected right after the #version directive
+    std::string defines() const;
+};
+
+// sources of a program's stages, the tessellation stages are left empty when the program has none
+struct ShaderSources
+{
+    std::string vertex;
+    std::string tessControl;
+    std::string tessEvaluation;
+    std::string fragment;
+    // outputs of the last vertex processing stage recorded with transform feedback, set before linking
+    std::vector<std::string> feedbackVaryings;
+};
+
+struct ShaderCompileJob;
+class ShaderCompiler;
+
 // https://learnopengl.com/Getting-started/Shaders
 class Shader
 {
 public:
-    // the program ID
+    // the program ID of the currently selected variant
     unsigned int ID;
 
-    // constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // constructor reads the shader sources and resolves their #include directives;
+    // programs are compiled lazily, the first time a variant is selected. The tessellation
+    // stages are optional and need OpenGL 4.0, the program then draws GL_PATCHES.
+    Shader(const char* vertexPath, const char* fragmentPath, const char* tessControlPath = NULL, const char* tessEvaluationPath = NULL);
+    ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // selects the program specialized for the given features, starting its compilation on first use;
+    // returns false while it is still being compiled asynchronously, ID then keeps the last ready variant
+    bool setVariant(const ShaderVariant& variant);
+    // the variant of the selected program
+    const ShaderVariant& getVariant() const { return currentVariant; }
+    // starts compiling a variant in the background without selecting it
+    void precompile(const ShaderVariant& variant);
+    // records the given outputs with transform feedback, must be called before the first variant is compiled
+    void captureVaryings(const std::vector<std::string>& varyings);
+    // blocks until every variant started so far is compiled
+    void waitForPrograms();
+    // enables the on-disk cache of linked program binaries (needs OpenGL 4.1), an empty path disables it
+    static void setBinaryCacheDirectory(const std::string& directory);
+    // compiles asynchronously with KHR_parallel_shader_compile, returns false if the driver lacks it
+    static bool enableParallelCompile(GLADloadproc loadProc);
+    // compiles asynchronously on the worker threads of the given compiler (fallback for drivers without the extension)
+    static void setCompiler(ShaderCompiler* compiler);
+    // creates the program and starts compiling and linking it without waiting for the result,
+    // shaders receives the shader objects of its stages
+    static unsigned int startProgram(const ShaderSources& sources, bool isRetrievable, std::vector<unsigned int>& shaders);
+    // waits for the program, reports its compilation errors and releases the shader objects
+    static void finishProgram(unsigned int program, const std::vector<unsigned int>& shaders);
     // use/activate the shader
     void use();
     // utility uniform functions
@@ -34,7 +106,31 @@ public:
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
 private:
-    void checkCompileErrors(unsigned int shader, std::string type);
+    ShaderSources code;
+    // variant of the program ID, or the one use() waits for while no program is ready
+    ShaderVariant currentVariant;
+    std::map<unsigned int, unsigned int> programs; // variant key -> program ID
+
+    // a variant whose program is still being compiled
+    struct PendingProgram
+    {
+        unsigned int program = 0;
+        std::vector<unsigned int> shaders;
+        std::string cachePath;
+        std::shared_ptr<ShaderCompileJob> job; // set when compiled by the ShaderCompiler
+    };
+    std::map<unsigned int, PendingProgram> pendingPrograms;
+
+    static std::string binaryCacheDirectory;
+    static bool isParallelCompileEnabled;
+    static ShaderCompiler* compiler;
+
+    void submitProgram(const ShaderVariant& variant);
+    bool pollProgram(unsigned int key, bool wait);
+    std::string binaryCachePath(const ShaderVariant& variant, const ShaderSources& sources) const;
+    unsigned int loadProgramBinary(const std::string& path);
+    void saveProgramBinary(unsigned int program, const std::string& path);
+    static void checkCompileErrors(unsigned int shader, std::string type);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "ShaderCompiler.h"
+#include "Shader.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+ShaderCompiler::ShaderCompiler(const std::vector<std::function<void(bool)>>& workerContexts) : isStopping(false)
+{
+    for (const auto& bindContext : workerContexts)
+        workers.emplace_back(&ShaderCompiler::workerLoop, this, bindContext);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        isStopping = true;
+    }
+    jobsCondition.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+
+    // the jobs left in the queue will never be compiled
+    for (auto& job : jobs)
+        job->isCancelled.store(true, std::memory_order_release);
+}
+
+std::shared_ptr<ShaderCompileJob> ShaderCompiler::submit(const ShaderSources& sources, bool isRetrievable)
+{
+    auto job = std::make_shared<ShaderCompileJob>();
+    job->sources = sources;
+    job->isRetrievable = isRetrievable;
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push_back(job);
+    }
+    jobsCondition.notify_one();
+    return job;
+}
+
+void ShaderCompiler::cancel(const std::shared_ptr<ShaderCompileJob>& job)
+{
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto found = std::find(jobs.begin(), jobs.end(), job);
+    if (found == jobs.end())
+        return;
+    jobs.erase(found);
+    job->isCancelled.store(true, std::memory_order_release);
+}
+
+void ShaderCompiler::workerLoop(std::function<void(bool)> bindContext)
+{
+    bindContext(true);
+    PROFILE_THREAD("Shader compiler");
+
+    while (true)
+    {
+        std::shared_ptr<ShaderCompileJob> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsCondition.wait(lock, [this] { return isStopping || !jobs.empty(); });
+            if (isStopping)
+                break;
+
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        std::vector<unsigned int> shaders;
+        unsigned int program = Shader::startProgram(job->sources, job->isRetrievable, shaders);
+        Shader::finishProgram(program, shaders);
+
+        // the program must be complete before another context may use it
+        glFinish();
+
+        job->program = program;
+        job->isDone.store(true, std::memory_order_release);
+    }
+
+    bindContext(false);
+}
\ No newline at end of file
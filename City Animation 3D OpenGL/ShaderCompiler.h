@@ -0,0 +1,57 @@
+#pragma once
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Shader.h"
+
+// a program to be built by one of the compiler threads
+struct ShaderCompileJob
+{
+    ShaderSources sources;
+    bool isRetrievable = false; // the program binary will be saved to the cache
+
+    // written by the worker thread, valid once isDone is set
+    unsigned int program = 0;
+    std::atomic<bool> isDone{ false };
+    // set instead of isDone when the job is dropped before a worker took it, it has no program
+    std::atomic<bool> isCancelled{ false };
+};
+
+// Compiles and links shader programs on worker threads. Used when the driver lacks
+// KHR_parallel_shader_compile; every worker owns an OpenGL context shared with the main one,
+// so the programs it links can be used directly by the render loop.
+class ShaderCompiler
+{
+public:
+    // one callback per worker thread: called with true on the worker to make its shared context
+    // current, and with false before the thread exits to release it
+    ShaderCompiler(const std::vector<std::function<void(bool)>>& workerContexts);
+    ~ShaderCompiler();
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    std::shared_ptr<ShaderCompileJob> submit(const ShaderSources& sources, bool isRetrievable);
+    // drops the job if no worker took it yet; a job being compiled still finishes
+    void cancel(const std::shared_ptr<ShaderCompileJob>& job);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<ShaderCompileJob>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsCondition;
+    bool isStopping;
+
+    void workerLoop(std::function<void(bool)> bindContext);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#version 400 core
+layout (vertices = 16) out;
+
+in vec3 ControlPoint[];
+out vec3 PatchControlPoint[];
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewportSize;
+// screen length of the triangle edges the tessellation aims for
+uniform float pixelsPerSegment;
+// used for every edge instead of the screen space levels when positive
+uniform float fixedTessLevel;
+
+// control points of an edge, indexed like the control net of Bezier.h: i * 4 + j
+const ivec4 EDGE_U0 = ivec4(0, 1, 2, 3);
+const ivec4 EDGE_V0 = ivec4(0, 4, 8, 12);
+const ivec4 EDGE_U1 = ivec4(12, 13, 14, 15);
+const ivec4 EDGE_V1 = ivec4(3, 7, 11, 15);
+
+vec2 toScreen(vec3 position)
+{
+    vec4 clip = projection * view * model * vec4(position, 1.0);
+    // points behind the camera are kept from flipping over
+    return clip.xy / max(clip.w, 0.0001) * 0.5 * viewportSize;
+}
+
+// the control polygon is never shorter than the curve, so its screen length is a safe estimate
+float edgeLevel(ivec4 edge)
+{
+    float polygonLength = 0.0;
+    for (int k = 0; k < 3; k++)
+        polygonLength += distance(toScreen(ControlPoint[edge[k]]), toScreen(ControlPoint[edge[k + 1]]));
+    return clamp(polygonLength / pixelsPerSegment, 1.0, 64.0);
+}
+
+void main()
+{
+    PatchControlPoint[gl_InvocationID] = ControlPoint[gl_InvocationID];
+
+    if (gl_InvocationID == 0)
+    {
+        vec4 levels;
+        if (fixedTessLevel > 0.0)
+            levels = vec4(fixedTessLevel);
+        else
+            levels = vec4(edgeLevel(EDGE_U0), edgeLevel(EDGE_V0), edgeLevel(EDGE_U1), edgeLevel(EDGE_V1));
+
+        // outer levels of the quad domain: u = 0, v = 0, u = 1, v = 1
+        gl_TessLevelOuter[0] = levels[0];
+        gl_TessLevelOuter[1] = levels[1];
+        gl_TessLevelOuter[2] = levels[2];
+        gl_TessLevelOuter[3] = levels[3];
+        // the inner levels follow the finer of the opposite edges
+        gl_TessLevelInner[0] = max(levels[1], levels[3]);
+        gl_TessLevelInner[1] = max(levels[0], levels[2]);
+    }
+}
@@ -0,0 +1,49 @@
+#version 400 core
+layout (quads, equal_spacing, ccw) in;
+
+in vec3 PatchControlPoint[];
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+out vec4 ViewCoordsPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// cubic Bernstein polynomials C(3, i) t^i (1 - t)^(3 - i) and their derivatives, as in Bezier.h
+void bernstein(float t, out vec4 values, out vec4 derivatives)
+{
+    float s = 1.0 - t;
+    values = vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+    derivatives = vec4(-3.0 * s * s, 3.0 * s * s - 6.0 * t * s, 6.0 * t * s - 3.0 * t * t, 3.0 * t * t);
+}
+
+void main()
+{
+    // u weights the rows of the control net, v its columns
+    vec4 bu, du, bv, dv;
+    bernstein(gl_TessCoord.x, bu, du);
+    bernstein(gl_TessCoord.y, bv, dv);
+
+    vec3 position = vec3(0.0);
+    vec3 tangentU = vec3(0.0);
+    vec3 tangentV = vec3(0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            vec3 point = PatchControlPoint[i * 4 + j];
+            position += bu[i] * bv[j] * point;
+            tangentU += du[i] * bv[j] * point;
+            tangentV += bu[i] * dv[j] * point;
+        }
+    }
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    TexCoords = vec2(1.0);
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * cross(tangentU, tangentV);
+    ViewCoordsPos = view * model * vec4(position, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 400 core
+layout (location = 0) in vec3 aPos;
+
+// the control points are passed on untransformed, the evaluation shader places the surface
+out vec3 ControlPoint;
+
+void main()
+{
+    ControlPoint = aPos;
+}
@@ -0,0 +1,40 @@
+// Model matrix of the vertex shaders, included by the Phong, Gouraud and flat shaders.
+//
+// With IS_INSTANCED every instance brings its own model matrix and lamp intensities as vertex
+// attributes (see Mesh::DrawInstanced), otherwise the model matrix is a uniform and nothing glows.
+
+#ifdef IS_INSTANCED
+layout (location = 7) in mat4 aInstanceModel;
+// x the headlights, y the brake lights
+layout (location = 11) in vec4 aInstanceLamps;
+
+// model space direction the instances face, and how far ahead of the origin the headlights begin (x)
+// and how far behind it the brake lights begin (y)
+uniform vec3 lampAxis;
+uniform vec2 lampRange;
+#else
+uniform mat4 model;
+#endif
+
+
+mat4 ModelMatrix()
+{
+#ifdef IS_INSTANCED
+    return aInstanceModel;
+#else
+    return model;
+#endif
+}
+
+// light given off at a model space position, independent of the scene's lights
+vec3 CalcEmission(vec3 position)
+{
+#ifdef IS_INSTANCED
+    float along = dot(position, lampAxis);
+    vec3 headlights = vec3(1.0, 0.95, 0.8) * aInstanceLamps.x * step(lampRange.x, along);
+    vec3 brakeLights = vec3(1.0, 0.05, 0.02) * aInstanceLamps.y * step(lampRange.y, -along);
+    return headlights + brakeLights;
+#else
+    return vec3(0.0);
+#endif
+}
@@ -0,0 +1,226 @@
+// Shared lighting code included by the Phong, Gouraud and flat shaders.
+//
+// Specialized at compile time by the feature defines injected by the Shader class:
+//   IS_DAY                - directional light (sun) is enabled
+//   IS_TEXTURED           - material colors come from textures instead of material.diffuseColor/specularColor
+//   FOG_EQUATION          - 0 (linear), 1 (exp) or 2 (exp2); fog is disabled when undefined
+//   POINT_LIGHTS_COUNTER  - number of point lights
+//   SPOT_LIGHTS_COUNTER   - number of spot lights
+
+uniform vec3 viewPos;
+
+
+struct Material {
+#ifdef IS_TEXTURED
+    sampler2D texture_diffuse;
+    sampler2D texture_specular;
+#else
+    vec3      diffuseColor;
+    vec3      specularColor;
+#endif
+    float     shininess;
+};
+uniform Material material;
+
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+#ifdef IS_DAY
+uniform DirLight dirLight;
+#endif
+
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+#if POINT_LIGHTS_COUNTER > 0
+uniform PointLight pointLights[POINT_LIGHTS_COUNTER];
+#endif
+
+
+struct SpotLight {
+    vec3  position;
+    vec3  direction;
+
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+#if SPOT_LIGHTS_COUNTER > 0
+uniform SpotLight spotLights[SPOT_LIGHTS_COUNTER];
+#endif
+
+
+struct FogParameters
+{
+	vec3 color;
+	float linearStart;
+	float linearEnd;
+	float density;
+};
+#ifdef FOG_EQUATION
+uniform FogParameters fogParams;
+#endif
+
+
+vec3 MaterialDiffuse(vec2 texCoords)
+{
+#ifdef IS_TEXTURED
+    return vec3(texture(material.texture_diffuse, texCoords));
+#else
+    return material.diffuseColor;
+#endif
+}
+
+vec3 MaterialSpecular(vec2 texCoords)
+{
+#ifdef IS_TEXTURED
+    return vec3(texture(material.texture_specular, texCoords));
+#else
+    return material.specularColor;
+#endif
+}
+
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 texCoords)
+{
+    vec3 lightDir = normalize(-light.direction);
+    vec3 reflectDir = reflect(-lightDir, normal);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+    vec3 ambient  = light.ambient  * MaterialDiffuse(texCoords);
+    vec3 diffuse  = light.diffuse  * diff * MaterialDiffuse(texCoords);
+    vec3 specular = light.specular * spec * MaterialSpecular(texCoords);
+
+    return (ambient + diffuse + specular);
+}
+
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 reflectDir = reflect(-lightDir, normal);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 ambient  = light.ambient  * MaterialDiffuse(texCoords);
+    vec3 diffuse  = light.diffuse  * diff * MaterialDiffuse(texCoords);
+    vec3 specular = light.specular * spec * MaterialSpecular(texCoords);
+
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float theta     = dot(lightDir, normalize(-light.direction));
+    float epsilon   = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    if (theta > light.cutOff)
+    {
+        vec3 reflectDir = reflect(-lightDir, normal);
+
+        float diff = max(dot(normal, lightDir), 0.0);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+        float distance    = length(light.position - fragPos);
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+        vec3 ambient  = light.ambient  * MaterialDiffuse(texCoords);
+        vec3 diffuse  = light.diffuse  * diff * MaterialDiffuse(texCoords);
+        vec3 specular = light.specular * spec * MaterialSpecular(texCoords);
+
+        ambient  *= attenuation;
+        diffuse  *= attenuation;
+        specular *= attenuation;
+
+        diffuse  *= intensity;
+        specular *= intensity;
+
+        return (ambient + diffuse + specular);
+    }
+    else
+    {
+        return (light.ambient * MaterialDiffuse(texCoords));
+    }
+}
+
+// sums up the contribution of every light enabled in this variant
+vec3 CalcLighting(vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
+{
+    vec3 result = vec3(0.0, 0.0, 0.0);
+
+    // directional lighting
+#ifdef IS_DAY
+    result += CalcDirLight(dirLight, normal, viewDir, texCoords);
+#endif
+
+    // point lighting
+#if POINT_LIGHTS_COUNTER > 0
+    for(int i = 0; i < POINT_LIGHTS_COUNTER; i++)
+        result += CalcPointLight(pointLights[i], normal, fragPos, viewDir, texCoords);
+#endif
+
+    // spot lighting
+#if SPOT_LIGHTS_COUNTER > 0
+    for(int i = 0; i < SPOT_LIGHTS_COUNTER; i++)
+        result += CalcSpotLight(spotLights[i], normal, fragPos, viewDir, texCoords);
+#endif
+
+    return result;
+}
+
+// https://www.mbsoftworks.sk/tutorials/opengl4/020-fog/
+vec4 ApplyFog(vec4 color, vec4 viewCoordsPos)
+{
+#ifdef FOG_EQUATION
+    float fogCoordinate = abs(viewCoordsPos.z / viewCoordsPos.w);
+
+	float result = 0.0;
+#if FOG_EQUATION == 0
+	float fogLength = fogParams.linearEnd - fogParams.linearStart;
+	result = (fogParams.linearEnd - fogCoordinate) / fogLength;
+#elif FOG_EQUATION == 1
+	result = exp(-fogParams.density * fogCoordinate);
+#else
+	result = exp(-pow(fogParams.density * fogCoordinate, 2.0));
+#endif
+
+	result = 1.0 - clamp(result, 0.0, 1.0);
+    return mix(color, vec4(fogParams.color, 1.0), result);
+#else
+    return color;
+#endif
+}
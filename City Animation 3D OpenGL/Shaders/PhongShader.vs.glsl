@@ -7,16 +7,24 @@ out vec2 TexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec4 ViewCoordsPos;
+#ifdef IS_INSTANCED
+out vec3 Emission;
+#endif
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#include "Include/Instancing.glsl"
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    mat4 world = ModelMatrix();
+    gl_Position = projection * view * world * vec4(aPos, 1.0);
     TexCoords = aTexCoords;
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    ViewCoordsPos = view * model * vec4(aPos, 1.0);
+    FragPos = vec3(world * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(world))) * aNormal;
+    ViewCoordsPos = view * world * vec4(aPos, 1.0);
+#ifdef IS_INSTANCED
+    Emission = CalcEmission(aPos);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+// free camera speed in units per second
+const float FREE_CAMERA_SPEED = 5.0f;
+// reflector turning speed in radians per second, limited to REFLECTOR_MAX_ANGLE either way
+const float REFLECTOR_TURN_SPEED = 0.3f;
+const float REFLECTOR_MAX_ANGLE = 0.5f;
+
+Simulation::Simulation(const glm::vec3& freeCameraPosition, const SplinePath& carPath, float carSpeed)
+    : tick(0), carPath(carPath), carSpeed(carSpeed), droppedTime(0.0), alpha(0.0)
+{
+    current.freeCameraPosition = freeCameraPosition;
+    previous = current;
+}
+
+unsigned int Simulation::Advance(double time, const SimulationInput& input)
+{
+    // ticks are counted rather than accumulated so the same times always give the same states
+    double simulatedTime = time - droppedTime;
+    unsigned int ticksCount = 0;
+    while ((tick + 1) * TIME_STEP <= simulatedTime)
+    {
+        if (ticksCount == MAX_TICKS_PER_ADVANCE)
+        {
+            droppedTime += simulatedTime - tick * TIME_STEP;
+            simulatedTime = tick * TIME_STEP;
+            break;
+        }
+        step(input);
+        ticksCount++;
+    }
+
+    alpha = (simulatedTime - tick * TIME_STEP) / TIME_STEP;
+    return ticksCount;
+}
+
+WorldState Simulation::Interpolate() const
+{
+    // blending the last two ticks keeps motion smooth at any frame rate, at the cost of showing the world one tick late
+    float t = (float)alpha;
+    WorldState state;
+    state.time = previous.time + (current.time - previous.time) * alpha;
+    state.reflectorAngle = previous.reflectorAngle + (current.reflectorAngle - previous.reflectorAngle) * t;
+    state.freeCameraPosition = previous.freeCameraPosition + (current.freeCameraPosition - previous.freeCameraPosition) * t;
+    return state;
+}
+
+void Simulation::TeleportFreeCamera(const glm::vec3& position)
+{
+    previous.freeCameraPosition = position;
+    current.freeCameraPosition = position;
+}
+
+void Simulation::step(const SimulationInput& input)
+{
+    previous = current;
+    tick++;
+    current.time = tick * TIME_STEP;
+
+    float velocity = FREE_CAMERA_SPEED * (float)TIME_STEP;
+    if (input.isMovingForward)
+        current.freeCameraPosition += input.freeCameraFront * velocity;
+    if (input.isMovingBackward)
+        current.freeCameraPosition -= input.freeCameraFront * velocity;
+    if (input.isMovingLeft)
+        current.freeCameraPosition -= input.freeCameraRight * velocity;
+    if (input.isMovingRight)
+        current.freeCameraPosition += input.freeCameraRight * velocity;
+
+    if (input.isReflectorReset)
+        current.reflectorAngle = 0.0f;
+    current.reflectorAngle += input.reflectorTurn * REFLECTOR_TURN_SPEED * (float)TIME_STEP;
+    if (current.reflectorAngle > REFLECTOR_MAX_ANGLE)
+        current.reflectorAngle = REFLECTOR_MAX_ANGLE;
+    if (current.reflectorAngle < -REFLECTOR_MAX_ANGLE)
+        current.reflectorAngle = -REFLECTOR_MAX_ANGLE;
+}
+
+CarPose Simulation::GetCarPose(const WorldState& state) const
+{
+    // the distance is taken in double, so the car doesn't start to stutter after hours of driving
+    double distance = fmod(state.time * carSpeed, (double)std::max(carPath.GetLength(), 1.0e-6f));
+    PathSample sample = carPath.Sample((float)distance);
+
+    // the car faces along the path
+    CarPose pose;
+    pose.position = sample.position;
+    pose.heading = atan2(sample.tangent.x, -sample.tangent.y);
+    return pose;
+}
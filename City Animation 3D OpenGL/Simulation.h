@@ -0,0 +1,82 @@
+#pragma once
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SplinePath.h"
+
+// everything that changes while the animation runs, at one simulation tick
+struct WorldState
+{
+    // simulated seconds, the car's place on its path is a function of it
+    double time = 0.0;
+    // horizontal angle of the car's reflectors relative to its heading
+    float reflectorAngle = 0.0f;
+    glm::vec3 freeCameraPosition = glm::vec3(0.0f);
+};
+
+// controls held during the ticks of one Advance call
+struct SimulationInput
+{
+    bool isMovingForward = false;
+    bool isMovingBackward = false;
+    bool isMovingLeft = false;
+    bool isMovingRight = false;
+    // the free camera moves along its current orientation, which the mouse changes between ticks
+    glm::vec3 freeCameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 freeCameraRight = glm::vec3(1.0f, 0.0f, 0.0f);
+    // -1 turns the reflectors right, 1 left
+    int reflectorTurn = 0;
+    bool isReflectorReset = false;
+};
+
+// place of the car in the space of the pivot its path lies in, the scene graph places the pivot and
+// everything attached to the car
+struct CarPose
+{
+    glm::vec3 position;
+    // turn around the pivot's z axis, the car's front is its model's -y
+    float heading;
+};
+
+// Advances the world in fixed ticks independent of the frame rate. The states before and after the
+// last tick are kept so rendering can interpolate between them at any time in between.
+class Simulation
+{
+public:
+    static constexpr double TIME_STEP = 1.0 / 120.0;
+    // ticks run at most per Advance, a longer stall drops the remaining time instead of catching up
+    static const unsigned int MAX_TICKS_PER_ADVANCE = 12;
+
+    // the car drives along its path at a constant speed, in the path's units per second
+    Simulation(const glm::vec3& freeCameraPosition, const SplinePath& carPath, float carSpeed);
+
+    // runs every tick up to the given time with the input held, returns the number of ticks run
+    unsigned int Advance(double time, const SimulationInput& input);
+    // state one tick before the time of the last Advance, blended from the last two ticks
+    WorldState Interpolate() const;
+    // moves the free camera without interpolating from its old position
+    void TeleportFreeCamera(const glm::vec3& position);
+
+    CarPose GetCarPose(const WorldState& state) const;
+    unsigned long long GetTick() const { return tick; }
+    // weight of the last tick in the interpolated state, for anything stepped along with the simulation
+    double GetAlpha() const { return alpha; }
+
+private:
+    WorldState previous;
+    WorldState current;
+    unsigned long long tick;
+    SplinePath carPath;
+    float carSpeed;
+    // time lost to stalls, subtracted from the time given to Advance
+    double droppedTime;
+    // fraction of a tick from the current state to the time of the last Advance
+    double alpha;
+
+    void step(const SimulationInput& input);
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "SimulationThread.h"
+#include "Profiler.h"
+#include "SceneComponents.h"
+
+#include <algorithm>
+#include <chrono>
+
+// objects a culling job tests, fewer are tested on the simulation thread alone
+const size_t CULLING_GRAIN_SIZE = 64;
+// entities following the scene graph a job refreshes
+const size_t TRANSFORM_GRAIN_SIZE = 256;
+
+SimulationThread::SimulationThread(const SceneDescription& scene, std::function<double()> getTime, const Benchmark* benchmark, JobSystem& jobs)
+    : scene(scene), getTime(getTime), benchmark(benchmark), jobs(jobs),
+    simulation(scene.startCameraPosition, scene.carPath, scene.carSpeed),
+    stationaryCamera(scene.startCameraPosition), followingCamera(scene.startCameraPosition),
+    fppCamera(scene.startCameraPosition), freeCamera(scene.startCameraPosition),
+    publishedPackets(0), consumedPackets(0), isStopping(false)
+{
+    stationaryCamera.UpdateFront(glm::normalize(scene.startCameraTarget - scene.startCameraPosition));
+
+    thread = std::thread(&SimulationThread::threadLoop, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(signalMutex);
+        isStopping = true;
+    }
+    signal.notify_all();
+    thread.join();
+}
+
+void SimulationThread::PostInput(const UserInput& input)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    float mouseOffsetX = pendingInput.mouseOffsetX + input.mouseOffsetX;
+    float mouseOffsetY = pendingInput.mouseOffsetY + input.mouseOffsetY;
+    float scrollOffset = pendingInput.scrollOffset + input.scrollOffset;
+
+    pendingInput = input;
+    pendingInput.mouseOffsetX = mouseOffsetX;
+    pendingInput.mouseOffsetY = mouseOffsetY;
+    pendingInput.scrollOffset = scrollOffset;
+}
+
+UserInput SimulationThread::takeInput()
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    UserInput input = pendingInput;
+    pendingInput.mouseOffsetX = 0.0f;
+    pendingInput.mouseOffsetY = 0.0f;
+    pendingInput.scrollOffset = 0.0f;
+    return input;
+}
+
+const FramePacket& SimulationThread::WaitForPacket()
+{
+    PROFILE_SCOPE("WaitForPacket");
+
+    // every packet is drawn exactly once, so a benchmark run sees the same frames every time
+    if (!packets.Acquire())
+    {
+        std::unique_lock<std::mutex> lock(signalMutex);
+        signal.wait(lock, [this] { return publishedPackets.load() > consumedPackets.load(); });
+        packets.Acquire();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(signalMutex);
+        consumedPackets++;
+    }
+    signal.notify_all();
+    return packets.GetReadBuffer();
+}
+
+void SimulationThread::threadLoop()
+{
+    PROFILE_THREAD("Simulation");
+
+    for (unsigned long long index = 0; ; index++)
+    {
+        // stay one packet ahead of the render thread, it draws packet N while N + 1 is built
+        {
+            std::unique_lock<std::mutex> lock(signalMutex);
+            signal.wait(lock, [this] { return isStopping.load() || publishedPackets.load() <= consumedPackets.load(); });
+            if (isStopping)
+                break;
+        }
+
+        {
+            PROFILE_SCOPE("BuildFramePacket");
+            buildPacket(packets.GetWriteBuffer(), takeInput(), index);
+            packets.Publish();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(signalMutex);
+            publishedPackets++;
+        }
+        signal.notify_all();
+    }
+}
+
+void SimulationThread::buildPacket(FramePacket& packet, const UserInput& input, unsigned long long index)
+{
+    UserInput frameInput = input;
+    double time;
+    if (benchmark != NULL)
+    {
+        // the script replaces the controls
+        BenchmarkStep step = benchmark->GetStep((unsigned int)index);
+        frameInput = UserInput();
+        frameInput.camera = step.camera;
+        frameInput.shading = step.shading;
+        frameInput.isDay = step.isDay;
+        frameInput.isFogEnabled = step.isFogEnabled;
+        freeCamera.UpdatePositionAndFront(step.cameraPosition, glm::normalize(step.cameraTarget - step.cameraPosition));
+        simulation.TeleportFreeCamera(step.cameraPosition);
+        time = index * Benchmark::TIME_STEP;
+    }
+    else
+    {
+        time = getTime();
+    }
+
+    Camera* cameras[] = { &stationaryCamera, &followingCamera, &fppCamera, &freeCamera };
+    Camera* activeCamera = cameras[frameInput.camera];
+    if (frameInput.camera == FREE_CAMERA)
+        freeCamera.ProcessMouseMovement(frameInput.mouseOffsetX, frameInput.mouseOffsetY);
+    activeCamera->ProcessMouseScroll(frameInput.scrollOffset);
+
+    // advance the world in fixed ticks and show it interpolated to the current time
+    frameInput.simulation.freeCameraFront = freeCamera.Front;
+    frameInput.simulation.freeCameraRight = freeCamera.Right;
+    unsigned int ticksCount = simulation.Advance(time, frameInput.simulation);
+    WorldState world = simulation.Interpolate();
+
+    // the traffic takes the same ticks, so it's interpolated with the same weight
+    auto trafficStart = std::chrono::steady_clock::now();
+    for (unsigned int tick = 0; tick < ticksCount; tick++)
+        scene.traffic.Step((float)Simulation::TIME_STEP, jobs);
+    packet.trafficMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - trafficStart).count();
+    packet.carsCount = (unsigned int)scene.traffic.GetCarsCount();
+    CarPose car = simulation.GetCarPose(world);
+
+    // only the car's part of the graph changes, the static nodes keep their matrices
+    SceneGraph& graph = scene.graph;
+    graph.SetTranslation(scene.carSpinNode, car.position);
+    graph.SetRotation(scene.carSpinNode, glm::angleAxis(car.heading, glm::vec3(0.0f, 0.0f, 1.0f)));
+    graph.Update();
+
+    glm::vec3 carPosition = graph.GetWorldPosition(scene.carEyeNode);
+    glm::vec3 carDirection = graph.GetWorldPosition(scene.carFrontNode) - graph.GetWorldPosition(scene.carBackNode);
+
+    freeCamera.Position = world.freeCameraPosition;
+    followingCamera.UpdateFront(glm::normalize(carPosition - scene.startCameraPosition));
+    fppCamera.UpdatePositionAndFront(carPosition, carDirection);
+
+    packet.index = index;
+    packet.time = world.time;
+    packet.projection = glm::perspective(glm::radians(activeCamera->Zoom), scene.aspectRatio, 0.1f, 100.0f);
+    packet.view = activeCamera->GetViewMatrix();
+    packet.viewPosition = activeCamera->Position;
+    packet.shading = frameInput.shading;
+    packet.isDay = frameInput.isDay;
+    packet.isFogEnabled = frameInput.isFogEnabled;
+
+    // the entities attached to the graph take over their nodes' matrices, the lights sit at their
+    // transform's origin; every step is one sweep over the component arrays
+    EntityStore& entities = scene.entities;
+    entities.ParallelEach<NodeLink, Transform>(jobs, TRANSFORM_GRAIN_SIZE, [&graph](NodeLink& link, Transform& transform) {
+        transform.world = graph.GetWorldMatrix(link.node);
+    });
+    entities.Each<Transform, PointLight>([](Transform& transform, PointLight& light) {
+        light.position = glm::vec3(transform.world[3]);
+    });
+    entities.Each<Transform, SpotLight>([](Transform& transform, SpotLight& light) {
+        light.position = glm::vec3(transform.world[3]);
+    });
+    glm::vec3 reflectorTarget = glm::angleAxis(world.reflectorAngle, glm::vec3(0.0f, 1.0f, 0.0f)) * carDirection + glm::vec3(0.0f, -0.05f, 0.0f);
+    entities.Each<SpotLight, CarReflector>([&reflectorTarget](SpotLight& light, CarReflector&) {
+        light.direction = reflectorTarget;
+    });
+
+    // the packet's vectors keep their capacity, so building the draw list doesn't allocate after the first frames
+    packet.pointLights.clear();
+    packet.spotLights.clear();
+    entities.Each<PointLight>([&packet](PointLight& light) { packet.pointLights.push_back(light); });
+    entities.Each<SpotLight>([&packet](SpotLight& light) { packet.spotLights.push_back(light); });
+
+    packet.drawItems.clear();
+    packet.lightTagModels.clear();
+    packet.culledObjects = 0;
+    Frustum frustum(packet.projection * packet.view);
+
+    candidates.clear();
+    entities.Each<Transform, Renderable>([this](Transform& transform, Renderable& renderable) {
+        addCandidate(renderable.object, transform.world, renderable.bounds);
+    });
+    cullCandidates(packet, frustum);
+
+    // the cars are culled one by one and drawn together, the headlights are on at night
+    scene.traffic.BuildInstances((float)simulation.GetAlpha(), frustum, packet.viewPosition, scene.trafficDrawDistance, !packet.isDay,
+        jobs, packet.carInstances);
+    packet.culledObjects += packet.carsCount - (unsigned int)packet.carInstances.size();
+    if (!packet.carInstances.empty())
+    {
+        DrawItem item;
+        item.object = TRAFFIC_OBJECT;
+        item.model = glm::mat4(1.0f);
+        item.depth = 0.0f;
+        packet.drawItems.push_back(item);
+    }
+
+    // small cubes marking the lights, upright and unscaled whatever the light is attached to
+    entities.Each<Transform, LightTag>([this, &packet, &frustum](Transform& transform, LightTag& tag) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(transform.world[3]));
+        model = glm::scale(model, glm::vec3(tag.scale));
+        if (frustum.Intersects(scene.lightTagBounds.Transformed(model)))
+            packet.lightTagModels.push_back(model);
+        else
+            packet.culledObjects++;
+    });
+    if (!packet.lightTagModels.empty())
+    {
+        DrawItem item;
+        item.object = LIGHT_TAGS_OBJECT;
+        item.model = glm::mat4(1.0f);
+        item.depth = 0.0f;
+        packet.drawItems.push_back(item);
+    }
+
+    // textured objects front to back so hidden fragments fail the depth test early, the objects
+    // needing other programs after them so each program is bound once
+    auto drawStage = [](SceneObject object) {
+        if (object == BEZIER_SURFACE_OBJECT || object == TERRAIN_OBJECT || object == WATER_OBJECT)
+            return 1;
+        return object == LIGHT_TAGS_OBJECT ? 2 : 0;
+    };
+    std::sort(packet.drawItems.begin(), packet.drawItems.end(), [&drawStage](const DrawItem& a, const DrawItem& b) {
+        int aStage = drawStage(a.object);
+        int bStage = drawStage(b.object);
+        if (aStage != bStage)
+            return aStage < bStage;
+        return a.depth < b.depth;
+    });
+}
+
+void SimulationThread::addCandidate(SceneObject object, const glm::mat4& model, const BoundingSphere& bounds)
+{
+    DrawCandidate candidate;
+    candidate.object = object;
+    candidate.model = model;
+    candidate.bounds = bounds;
+    candidates.push_back(candidate);
+}
+
+void SimulationThread::cullCandidates(FramePacket& packet, const Frustum& frustum)
+{
+    PROFILE_SCOPE("Culling");
+
+    // every job writes only the flags of its own range, the draw items are added in order afterwards
+    visibility.resize(candidates.size());
+    jobs.ParallelFor(0, candidates.size(), CULLING_GRAIN_SIZE, [this, &frustum](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            visibility[i] = frustum.Intersects(candidates[i].bounds.Transformed(candidates[i].model)) ? 1 : 0;
+    });
+
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        if (!visibility[i])
+        {
+            packet.culledObjects++;
+            continue;
+        }
+
+        DrawItem item;
+        item.object = candidates[i].object;
+        item.model = candidates[i].model;
+        item.depth = -(packet.view * glm::vec4(candidates[i].bounds.Transformed(candidates[i].model).center, 1.0f)).z;
+        packet.drawItems.push_back(item);
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Camera.h"
+#include "Simulation.h"
+#include "FramePacket.h"
+#include "TripleBuffer.h"
+#include "Frustum.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "EntityStore.h"
+#include "Traffic.h"
+
+// state of the controls, collected by the window thread
+struct UserInput
+{
+    SimulationInput simulation;
+    CameraMode camera = FREE_CAMERA;
+    ShadingMode shading = PHONG_SHADING;
+    bool isDay = true;
+    bool isFogEnabled = false;
+    // summed up until the simulation thread takes them
+    float mouseOffsetX = 0.0f;
+    float mouseOffsetY = 0.0f;
+    float scrollOffset = 0.0f;
+};
+
+// the scene's objects and lights as entities (see SceneComponents.h) and the graph placing the
+// moving ones; the simulation thread animates its own copy, entities without a NodeLink keep their
+// transforms for the whole run
+struct SceneDescription
+{
+    EntityStore entities;
+
+    SceneGraph graph;
+    // the spin node moves and turns the car along its path in the pivot's space; the eye, front and
+    // back points are children of the car node
+    SceneNode carPivotNode;
+    SceneNode carSpinNode;
+    SceneNode carNode;
+    SceneNode carEyeNode;
+    SceneNode carFrontNode;
+    SceneNode carBackNode;
+
+    BoundingSphere lightTagBounds;
+
+    // in the pivot's x-y plane, the car drives it at carSpeed units per second
+    SplinePath carPath;
+    float carSpeed = 0.0f;
+
+    // stepped with the simulation's ticks, drawn within the distance
+    Traffic traffic;
+    float trafficDrawDistance = 0.0f;
+
+    glm::vec3 startCameraPosition;
+    glm::vec3 startCameraTarget;
+    float aspectRatio;
+};
+
+// Runs the simulation, the cameras and the scene traversal (culling, sorting, building the draw
+// list) on its own thread, one frame ahead of the render thread. Frame packets are handed over
+// through a lock-free triple buffer; the threads only sleep on a condition variable when one of
+// them is waiting for the other.
+class SimulationThread
+{
+public:
+    // getTime returns the seconds since start and must be callable from any thread; with a
+    // benchmark the packets follow its script and fixed timestep instead. Culling is spread over
+    // the job system's workers once there are enough objects.
+    SimulationThread(const SceneDescription& scene, std::function<double()> getTime, const Benchmark* benchmark, JobSystem& jobs);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // window thread: hands over the controls, the offsets are added to the ones not taken yet
+    void PostInput(const UserInput& input);
+    // render thread: waits for the next packet, which stays valid until the following call
+    const FramePacket& WaitForPacket();
+
+private:
+    SceneDescription scene;
+    std::function<double()> getTime;
+    const Benchmark* benchmark;
+    JobSystem& jobs;
+
+    // touched only by the simulation thread
+    Simulation simulation;
+    Camera stationaryCamera;
+    Camera followingCamera;
+    Camera fppCamera;
+    Camera freeCamera;
+
+    std::mutex inputMutex;
+    UserInput pendingInput;
+
+    TripleBuffer<FramePacket> packets;
+    std::atomic<unsigned long long> publishedPackets;
+    std::atomic<unsigned long long> consumedPackets;
+    std::atomic<bool> isStopping;
+    std::mutex signalMutex;
+    std::condition_variable signal;
+
+    std::thread thread;
+
+    // objects considered for drawing and whether they passed culling, kept to reuse their memory
+    struct DrawCandidate
+    {
+        SceneObject object;
+        glm::mat4 model;
+        BoundingSphere bounds;
+    };
+    std::vector<DrawCandidate> candidates;
+    std::vector<unsigned char> visibility;
+
+    void threadLoop();
+    UserInput takeInput();
+    void buildPacket(FramePacket& packet, const UserInput& input, unsigned long long index);
+    void addCandidate(SceneObject object, const glm::mat4& model, const BoundingSphere& bounds);
+    void cullCandidates(FramePacket& packet, const Frustum& frustum);
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "SplinePath.h"
+#include "PatchBasis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+typedef BernsteinBasis<3> CubicBasis;
+
+// Gauss-Legendre nodes and weights on [0, 1], the length of a piece of a segment is integrated from the speed at them
+const float GAUSS_NODES[3] = { 0.5f - 0.5f * 0.7745967f, 0.5f, 0.5f + 0.5f * 0.7745967f };
+const float GAUSS_WEIGHTS[3] = { 5.0f / 18.0f, 8.0f / 18.0f, 5.0f / 18.0f };
+
+SplinePath::SplinePath() : lengths(1, 0.0f), isClosed(false)
+{
+}
+
+SplinePath::SplinePath(const std::vector<glm::vec3>& controlPoints, bool isClosed) : controlPoints(controlPoints), isClosed(isClosed)
+{
+    size_t segmentsCount = GetSegmentCount();
+    lengths.reserve(segmentsCount * TABLE_STEPS + 1);
+    lengths.push_back(0.0f);
+
+    float length = 0.0f;
+    for (size_t segment = 0; segment < segmentsCount; segment++)
+    {
+        for (int step = 0; step < TABLE_STEPS; step++)
+        {
+            length += lengthBetween(segment, (float)step / TABLE_STEPS, (float)(step + 1) / TABLE_STEPS);
+            lengths.push_back(length);
+        }
+    }
+}
+
+SplinePath SplinePath::FromBezier(const std::vector<glm::vec3>& controlPoints, bool isClosed)
+{
+    if (controlPoints.size() < 4 || controlPoints.size() % 3 != 1)
+    {
+        std::cout << "ERROR::SPLINE_PATH::WRONG_CONTROL_POINTS_COUNT: " << controlPoints.size() << std::endl;
+        return SplinePath();
+    }
+    return SplinePath(controlPoints, isClosed);
+}
+
+SplinePath SplinePath::FromCatmullRom(const std::vector<glm::vec3>& points, bool isClosed)
+{
+    if (points.size() < 2)
+    {
+        std::cout << "ERROR::SPLINE_PATH::TOO_FEW_POINTS: " << points.size() << std::endl;
+        return SplinePath();
+    }
+
+    // the points before the first and after the last one of an open spline are mirrored
+    long count = (long)points.size();
+    auto point = [&points, count, isClosed](long i) {
+        if (isClosed)
+            return points[(i % count + count) % count];
+        if (i < 0)
+            return 2.0f * points[0] - points[1];
+        if (i >= count)
+            return 2.0f * points[count - 1] - points[count - 2];
+        return points[i];
+    };
+
+    // the segment from p1 to p2 is the cubic Bezier curve with the inner control points a sixth of
+    // the neighbouring chords away
+    long segmentsCount = isClosed ? count : count - 1;
+    std::vector<glm::vec3> controlPoints;
+    controlPoints.reserve(3 * segmentsCount + 1);
+    controlPoints.push_back(point(0));
+    for (long i = 0; i < segmentsCount; i++)
+    {
+        glm::vec3 p0 = point(i - 1), p1 = point(i), p2 = point(i + 1), p3 = point(i + 2);
+        controlPoints.push_back(p1 + (p2 - p0) / 6.0f);
+        controlPoints.push_back(p2 - (p3 - p1) / 6.0f);
+        controlPoints.push_back(p2);
+    }
+    return SplinePath(controlPoints, isClosed);
+}
+
+float SplinePath::ParameterAt(float distance) const
+{
+    if (GetLength() <= 0.0f)
+        return 0.0f;
+
+    distance = wrapDistance(distance);
+    return parameterInEntry(findEntry(distance, 0), distance);
+}
+
+float SplinePath::wrapDistance(float distance) const
+{
+    float length = GetLength();
+    if (isClosed)
+    {
+        distance = fmod(distance, length);
+        if (distance < 0.0f)
+            distance += length;
+    }
+    return glm::clamp(distance, 0.0f, length);
+}
+
+size_t SplinePath::findEntry(float distance, size_t first) const
+{
+    size_t entry = std::upper_bound(lengths.begin() + first, lengths.end(), distance) - lengths.begin();
+    return std::min(std::max(entry, (size_t)1), lengths.size() - 1) - 1;
+}
+
+float SplinePath::parameterInEntry(size_t entry, float distance) const
+{
+    // how far the distance is from the entry towards the next one
+    float stepLength = lengths[entry + 1] - lengths[entry];
+    float fraction = stepLength > 0.0f ? (distance - lengths[entry]) / stepLength : 0.0f;
+
+    // the speed changes within a step, most where the path almost stops; a Newton step on the
+    // length from the entry on corrects the linear guess
+    size_t segment = entry / TABLE_STEPS;
+    float from = (float)(entry % TABLE_STEPS) / TABLE_STEPS;
+    float t = from + fraction / TABLE_STEPS;
+    glm::vec3 position, derivative;
+    evaluate(segment, t, position, derivative);
+    float speed = glm::length(derivative);
+    if (speed > 0.0f)
+    {
+        float error = lengths[entry] + lengthBetween(segment, from, t) - distance;
+        t = glm::clamp(t - error / speed, from, from + 1.0f / TABLE_STEPS);
+    }
+    return segment + t;
+}
+
+PathSample SplinePath::Evaluate(float parameter) const
+{
+    PathSample sample = { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+    size_t segmentsCount = GetSegmentCount();
+    if (segmentsCount == 0)
+        return sample;
+
+    parameter = glm::clamp(parameter, 0.0f, (float)segmentsCount);
+    size_t segment = std::min((size_t)parameter, segmentsCount - 1);
+    glm::vec3 derivative;
+    evaluate(segment, parameter - segment, sample.position, derivative);
+
+    // a cusp has no direction, the chord of the segment stands in for it
+    float speed = glm::length(derivative);
+    if (speed < 1.0e-6f)
+        derivative = controlPoints[3 * segment + 3] - controlPoints[3 * segment];
+    speed = glm::length(derivative);
+    if (speed > 0.0f)
+        sample.tangent = derivative / speed;
+    return sample;
+}
+
+void SplinePath::Sample(const float* distances, size_t count, PathSample* samples) const
+{
+    if (GetLength() <= 0.0f)
+    {
+        for (size_t i = 0; i < count; i++)
+            samples[i] = Evaluate(0.0f);
+        return;
+    }
+
+    // the followers of a run ordered along the path keep the entry of the one before while they're
+    // within its step and search only the rest of the table past it; a follower behind the one
+    // before starts a new run with a search of the whole table. The entries are the ones
+    // ParameterAt finds, so the samples are too
+    size_t entry = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        float distance = wrapDistance(distances[i]);
+        if (distance < lengths[entry])
+            entry = findEntry(distance, 0);
+        else if (entry + 2 < lengths.size() && distance >= lengths[entry + 1])
+            entry = findEntry(distance, entry + 1);
+        samples[i] = Evaluate(parameterInEntry(entry, distance));
+    }
+}
+
+float SplinePath::lengthBetween(size_t segment, float from, float to) const
+{
+    float length = 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        glm::vec3 position, derivative;
+        evaluate(segment, from + (to - from) * GAUSS_NODES[k], position, derivative);
+        length += GAUSS_WEIGHTS[k] * glm::length(derivative);
+    }
+    return length * (to - from);
+}
+
+void SplinePath::evaluate(size_t segment, float t, glm::vec3& position, glm::vec3& derivative) const
+{
+    float weights[CubicBasis::ORDER], derivatives[CubicBasis::ORDER];
+    CubicBasis::Evaluate(t, weights, derivatives);
+
+    const glm::vec3* control = &controlPoints[3 * segment];
+    position = glm::vec3(0.0f);
+    derivative = glm::vec3(0.0f);
+    for (int k = 0; k < CubicBasis::ORDER; k++)
+    {
+        position += weights[k] * control[k];
+        derivative += derivatives[k] * control[k];
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef SPLINE_PATH_H
+#define SPLINE_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// a point of a path and the unit direction the path runs in there
+struct PathSample
+{
+    glm::vec3 position;
+    glm::vec3 tangent;
+};
+
+// Path of cubic Bezier segments, each one starting where the previous one ended, evaluated with the
+// Bernstein basis of the Bezier patches. A table of the distance along the path at a few parameters
+// per segment maps a distance back to a parameter, so followers advanced by equal distances move at
+// constant speed whatever the spacing of the control points; a lookup is a binary search over the
+// table, a linear interpolation between two of its entries and a Newton step refining it.
+//
+// A parameter runs from 0 at the start to the number of segments at the end, its integer part
+// picking the segment.
+class SplinePath
+{
+public:
+    // an empty path, every sample is at the origin
+    SplinePath();
+
+    // 3 * segments + 1 control points, the last point of a segment is the first of the next; a
+    // closed path should end where it starts
+    static SplinePath FromBezier(const std::vector<glm::vec3>& controlPoints, bool isClosed);
+    // uniform Catmull-Rom spline through every point, back around to the first one if it's closed;
+    // an open one starts and ends at its first and last point
+    static SplinePath FromCatmullRom(const std::vector<glm::vec3>& points, bool isClosed);
+
+    float GetLength() const { return lengths.back(); }
+    size_t GetSegmentCount() const { return controlPoints.size() / 3; }
+    bool IsClosed() const { return isClosed; }
+
+    // parameter at a distance from the start, wrapped around a closed path and clamped to the ends of an open one
+    float ParameterAt(float distance) const;
+    PathSample Evaluate(float parameter) const;
+    PathSample Sample(float distance) const { return Evaluate(ParameterAt(distance)); }
+    // samples at the distances of count followers, any thread may sample a path nobody changes; followers
+    // ordered along the path share their table lookups
+    void Sample(const float* distances, size_t count, PathSample* samples) const;
+
+private:
+    // table entries per segment
+    static const int TABLE_STEPS = 32;
+
+    std::vector<glm::vec3> controlPoints;
+    // distance from the start at every parameter k / TABLE_STEPS
+    std::vector<float> lengths;
+    bool isClosed;
+
+    SplinePath(const std::vector<glm::vec3>& controlPoints, bool isClosed);
+    // distance wrapped around a closed path and clamped to the ends, of a path with a length
+    float wrapDistance(float distance) const;
+    // the last table entry not beyond a wrapped distance, searched for from the entry first on
+    size_t findEntry(float distance, size_t first) const;
+    // parameter at a wrapped distance within the step of the table starting at entry
+    float parameterInEntry(size_t entry, float distance) const;
+    // length of a segment between two of its parameters
+    float lengthBetween(size_t segment, float from, float to) const;
+    void evaluate(size_t segment, float t, glm::vec3& position, glm::vec3& derivative) const;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer(size_t regionSize) : regionSize(regionSize), region(FRAMES_IN_FLIGHT - 1), isWriting(false), refusedWrites(0), mapping(NULL)
+{
+    for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++)
+        fences[i] = NULL;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+    size_t size = regionSize * FRAMES_IN_FLIGHT;
+    if (GLAD_GL_VERSION_4_4)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, size, NULL, flags);
+        mapping = (char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags | GL_MAP_FLUSH_EXPLICIT_BIT);
+        if (mapping == NULL)
+            std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAPPING_FAILED" << std::endl;
+    }
+    if (mapping == NULL)
+        glBufferData(GL_COPY_READ_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        if (fences[i] != NULL)
+            glDeleteSync(fences[i]);
+    }
+
+    // deleting a buffer unmaps it
+    glDeleteBuffers(1, &buffer);
+}
+
+void* StreamBuffer::BeginWrite()
+{
+    unsigned int next = (region + 1) % FRAMES_IN_FLIGHT;
+
+    if (mapping != NULL)
+    {
+        // a zero timeout only polls the fence
+        if (fences[next] != NULL)
+        {
+            GLenum status = glClientWaitSync(fences[next], 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                refusedWrites++;
+                return NULL;
+            }
+            glDeleteSync(fences[next]);
+            fences[next] = NULL;
+        }
+
+        region = next;
+        isWriting = true;
+        return mapping + GetOffset();
+    }
+
+    // the regions of the old storage may still be read, a new one is allocated once the ring wraps
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    if (next == 0)
+        glBufferData(GL_COPY_READ_BUFFER, regionSize * FRAMES_IN_FLIGHT, NULL, GL_STREAM_DRAW);
+
+    region = next;
+    void* pointer = glMapBufferRange(GL_COPY_READ_BUFFER, GetOffset(), regionSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    isWriting = pointer != NULL;
+    if (pointer == NULL)
+        std::cout << "ERROR::STREAM_BUFFER::REGION_NOT_MAPPED" << std::endl;
+    return pointer;
+}
+
+void StreamBuffer::EndWrite(size_t size)
+{
+    if (!isWriting)
+        return;
+    isWriting = false;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    if (mapping != NULL)
+    {
+        if (size > 0)
+            glFlushMappedBufferRange(GL_COPY_READ_BUFFER, GetOffset(), size);
+    }
+    else
+    {
+        if (size > 0)
+            glFlushMappedBufferRange(GL_COPY_READ_BUFFER, 0, size);
+        if (glUnmapBuffer(GL_COPY_READ_BUFFER) != GL_TRUE)
+            std::cout << "ERROR::STREAM_BUFFER::REGION_CORRUPTED" << std::endl;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void StreamBuffer::Fence()
+{
+    // orphaned storage is never written again, only the persistent regions need to know when they're free
+    if (mapping == NULL)
+        return;
+
+    if (fences[region] != NULL)
+        glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Ring of FRAMES_IN_FLIGHT regions the CPU fills with data the GPU reads in the same frame, while
+// the GPU may still read the regions of the previous frames. With OpenGL 4.4 the buffer is mapped
+// once persistently and every region is guarded by a fence; a region whose fence hasn't signalled
+// yet is refused instead of waited for. Older contexts map each region unsynchronized and orphan
+// the whole buffer when the ring wraps, so the driver hands out fresh storage instead of stalling.
+class StreamBuffer
+{
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    // regionSize bytes can be written per frame
+    StreamBuffer(size_t regionSize);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // pointer to the next region, or NULL if the GPU still reads it; any thread may write through it
+    // until EndWrite, the calls themselves belong to the thread owning the context
+    void* BeginWrite();
+    // makes the first size bytes written since BeginWrite visible to the GPU
+    void EndWrite(size_t size);
+    // call once the commands reading the region were issued, it's handed out again after they finish
+    void Fence();
+
+    unsigned int GetBuffer() const { return buffer; }
+    size_t GetRegionSize() const { return regionSize; }
+    // start of the region last returned by BeginWrite, in bytes
+    size_t GetOffset() const { return region * regionSize; }
+    bool IsPersistent() const { return mapping != NULL; }
+    // regions refused because the GPU was behind
+    unsigned int GetRefusedWrites() const { return refusedWrites; }
+
+private:
+    unsigned int buffer;
+    size_t regionSize;
+    unsigned int region;
+    bool isWriting;
+    unsigned int refusedWrites;
+
+    // the persistent mapping of the whole buffer, NULL when orphaning
+    char* mapping;
+    GLsync fences[FRAMES_IN_FLIGHT];
+};
+
+#endif
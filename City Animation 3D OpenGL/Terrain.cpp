@@ -0,0 +1,292 @@
+#include "Terrain.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+
+// vertices along the side of a patch slot, enough for the largest level
+const int SLOT_SIDE = (1 << Terrain::MAX_LEVEL) + 1;
+const int SLOT_VERTICES = SLOT_SIDE * SLOT_SIDE;
+const int VERTEX_SIZE = BezierSurface<3, float>::VERTEX_SIZE;
+
+// edges of a patch, bits of the masks telling which neighbours are coarser
+const int EDGE_MIN_X = 1;
+const int EDGE_MAX_X = 2;
+const int EDGE_MIN_Z = 4;
+const int EDGE_MAX_Z = 8;
+
+// a patch is tessellated one level coarser every time its distance doubles, in patch sizes
+const float LOD_DISTANCE = 1.0f;
+
+// height and slopes by the patch parameters at a patch corner
+struct TerrainCorner
+{
+    float height;
+    float slopeX;
+    float slopeZ;
+};
+
+// control height next to a corner, dx and dz are -1, 0 or 1 steps of a third of the patch away from it;
+// both patches sharing the corner compute it the same way, so their edges get identical control points
+static float controlHeight(const TerrainCorner& corner, int dx, int dz)
+{
+    return corner.height + (dx * corner.slopeX + dz * corner.slopeZ) / 3.0f;
+}
+
+Terrain::Terrain(int patchesPerSide, float patchSize, const glm::vec3& origin, const std::function<float(float, float)>& height)
+    : patchesPerSide(patchesPerSide), patchSize(patchSize), origin(origin), patches(patchesPerSide * patchesPerSide),
+    levels(patchesPerSide * patchesPerSide, MIN_LEVEL), vertices((size_t)patchesPerSide * patchesPerSide * SLOT_VERTICES * VERTEX_SIZE)
+{
+    // heights and slopes at the corners, the slopes by central differences
+    int cornersPerSide = patchesPerSide + 1;
+    float step = patchSize * 0.01f;
+    std::vector<TerrainCorner> corners(cornersPerSide * cornersPerSide);
+    for (int a = 0; a < cornersPerSide; a++)
+    {
+        for (int b = 0; b < cornersPerSide; b++)
+        {
+            float x = origin.x + a * patchSize;
+            float z = origin.z + b * patchSize;
+
+            TerrainCorner& corner = corners[a * cornersPerSide + b];
+            corner.height = height(x, z);
+            corner.slopeX = (height(x + step, z) - height(x - step, z)) / (2.0f * step) * patchSize;
+            corner.slopeZ = (height(x, z + step) - height(x, z - step)) / (2.0f * step) * patchSize;
+        }
+    }
+
+    // control points of every patch, offset along the slopes of the nearest corner
+    std::vector<glm::vec3> terrainPositions;
+    for (int px = 0; px < patchesPerSide; px++)
+    {
+        for (int pz = 0; pz < patchesPerSide; pz++)
+        {
+            float control[16];
+            std::vector<glm::vec3> patchPositions;
+            for (int k = 0; k < 4; k++)
+            {
+                for (int l = 0; l < 4; l++)
+                {
+                    const TerrainCorner& corner = corners[(px + k / 2) * cornersPerSide + pz + l / 2];
+                    int dx = k == 1 ? 1 : (k == 2 ? -1 : 0);
+                    int dz = l == 1 ? 1 : (l == 2 ? -1 : 0);
+                    control[k * 4 + l] = controlHeight(corner, dx, dz);
+
+                    glm::vec3 position(origin.x + (px + k / 3.0f) * patchSize, origin.y + control[k * 4 + l], origin.z + (pz + l / 3.0f) * patchSize);
+                    patchPositions.push_back(position);
+                    terrainPositions.push_back(position);
+                }
+            }
+
+            // the patch lies within the convex hull of its control points
+            Patch& patch = patches[pz * patchesPerSide + px];
+            patch.surface.SetBaseZValues(control);
+            patch.bounds = BoundingSphere::FromPoints(patchPositions);
+        }
+    }
+    bounds = BoundingSphere::FromPoints(terrainPositions);
+
+    std::vector<unsigned int> indices;
+    for (int level = MIN_LEVEL; level <= MAX_LEVEL; level++)
+    {
+        for (int coarserEdges = 0; coarserEdges < 16; coarserEdges++)
+        {
+            patternOffsets[level][coarserEdges] = indices.size();
+            buildPattern(level, coarserEdges, indices);
+            patternCounts[level][coarserEdges] = (unsigned int)(indices.size() - patternOffsets[level][coarserEdges]);
+        }
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+Terrain::~Terrain()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void Terrain::Update(const glm::vec3& cameraPosition, JobSystem& jobs)
+{
+    PROFILE_SCOPE("Terrain update");
+
+    for (size_t i = 0; i < patches.size(); i++)
+        levels[i] = selectLevel(patches[i], cameraPosition);
+
+    // neighbours may differ by one level at most, so an edge is stitched by skipping every other vertex;
+    // levels are only raised, each pass settles the patches one step further from a fine one
+    bool isChanged = true;
+    while (isChanged)
+    {
+        isChanged = false;
+        for (int pz = 0; pz < patchesPerSide; pz++)
+        {
+            for (int px = 0; px < patchesPerSide; px++)
+            {
+                int& level = levels[pz * patchesPerSide + px];
+                int finest = level;
+                if (px > 0)
+                    finest = std::max(finest, levels[pz * patchesPerSide + px - 1]);
+                if (px + 1 < patchesPerSide)
+                    finest = std::max(finest, levels[pz * patchesPerSide + px + 1]);
+                if (pz > 0)
+                    finest = std::max(finest, levels[(pz - 1) * patchesPerSide + px]);
+                if (pz + 1 < patchesPerSide)
+                    finest = std::max(finest, levels[(pz + 1) * patchesPerSide + px]);
+
+                if (level < finest - 1)
+                {
+                    level = finest - 1;
+                    isChanged = true;
+                }
+            }
+        }
+    }
+
+    changedPatches.clear();
+    for (size_t i = 0; i < patches.size(); i++)
+    {
+        if (patches[i].level != levels[i])
+            changedPatches.push_back((int)i);
+    }
+    if (changedPatches.empty())
+        return;
+
+    // every patch writes its own slot, a job per patch
+    {
+        PROFILE_SCOPE("Terrain tessellation");
+        jobs.ParallelFor(0, changedPatches.size(), 1, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                int index = changedPatches[i];
+                tessellate(index, levels[index], &vertices[(size_t)index * SLOT_VERTICES * VERTEX_SIZE]);
+            }
+        });
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    for (int index : changedPatches)
+    {
+        int side = (1 << levels[index]) + 1;
+        size_t offset = (size_t)index * SLOT_VERTICES * VERTEX_SIZE;
+        glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(float), side * side * VERTEX_SIZE * sizeof(float), &vertices[offset]);
+        patches[index].level = levels[index];
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Terrain::Draw(const Frustum& frustum)
+{
+    glBindVertexArray(VAO);
+    renderStats.vertexArrayBinds++;
+
+    for (int pz = 0; pz < patchesPerSide; pz++)
+    {
+        for (int px = 0; px < patchesPerSide; px++)
+        {
+            int index = pz * patchesPerSide + px;
+            const Patch& patch = patches[index];
+            if (patch.level < 0 || !frustum.Intersects(patch.bounds))
+                continue;
+
+            int coarserEdges = 0;
+            if (px > 0 && patches[index - 1].level < patch.level)
+                coarserEdges |= EDGE_MIN_X;
+            if (px + 1 < patchesPerSide && patches[index + 1].level < patch.level)
+                coarserEdges |= EDGE_MAX_X;
+            if (pz > 0 && patches[index - patchesPerSide].level < patch.level)
+                coarserEdges |= EDGE_MIN_Z;
+            if (pz + 1 < patchesPerSide && patches[index + patchesPerSide].level < patch.level)
+                coarserEdges |= EDGE_MAX_Z;
+
+            // the patterns index a slot from its start, the base vertex moves them to the patch's slot
+            unsigned int count = patternCounts[patch.level][coarserEdges];
+            glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT,
+                (void*)(patternOffsets[patch.level][coarserEdges] * sizeof(unsigned int)), index * SLOT_VERTICES);
+            renderStats.AddDraw(count / 3);
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+int Terrain::selectLevel(const Patch& patch, const glm::vec3& cameraPosition) const
+{
+    float distance = std::max(glm::length(patch.bounds.center - cameraPosition) - patch.bounds.radius, 0.0f);
+    int level = MAX_LEVEL - (int)std::floor(std::log2(1.0f + distance / (patchSize * LOD_DISTANCE)));
+    return std::max(level, MIN_LEVEL);
+}
+
+void Terrain::tessellate(int index, int level, float* vertices) const
+{
+    patches[index].surface.FillTile(vertices, 1 << level, origin, index % patchesPerSide, index / patchesPerSide, patchSize);
+}
+
+void Terrain::buildPattern(int level, int coarserEdges, std::vector<unsigned int>& indices)
+{
+    int cells = 1 << level;
+    int side = cells + 1;
+
+    // an odd vertex on an edge facing a coarser patch is replaced by an even neighbour, the
+    // triangles using it turn into a fan to the even vertices or collapse and are dropped; the
+    // cells are split along the other diagonal, so the vertices move towards the corners at
+    // (0, 0) and (cells, cells), otherwise a corner cell would get a sliver standing on its diagonal
+    auto vertex = [cells, side, coarserEdges](int i, int j) {
+        if (i == 0 && (coarserEdges & EDGE_MIN_X))
+            j -= j % 2;
+        else if (i == cells && (coarserEdges & EDGE_MAX_X))
+            j += j % 2;
+        if (j == 0 && (coarserEdges & EDGE_MIN_Z))
+            i -= i % 2;
+        else if (j == cells && (coarserEdges & EDGE_MAX_Z))
+            i += i % 2;
+        return (unsigned int)(i * side + j);
+    };
+    auto addTriangle = [&indices](unsigned int a, unsigned int b, unsigned int c) {
+        if (a != b && b != c && a != c)
+        {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    };
+
+    for (int i = 0; i < cells; i++)
+    {
+        for (int j = 0; j < cells; j++)
+        {
+            unsigned int v1 = vertex(i, j);
+            unsigned int v2 = vertex(i + 1, j);
+            unsigned int v3 = vertex(i, j + 1);
+            unsigned int v4 = vertex(i + 1, j + 1);
+
+            addTriangle(v1, v2, v3);
+            addTriangle(v3, v2, v4);
+        }
+    }
+}
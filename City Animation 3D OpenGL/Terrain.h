@@ -0,0 +1,74 @@
+#pragma once
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "Bezier.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+
+// Landscape made of a grid of bicubic Bezier patches. The control nets are built from the height
+// and slopes at the patch corners, which neighbours share, so the surface is C1 across the patches.
+// Every patch is tessellated at a level of detail picked from its distance to the camera; a patch
+// next to a coarser one skips its odd edge vertices so the shared edges match without cracks.
+class Terrain
+{
+public:
+    // a patch at a level has 2^level cells along each side
+    static const int MIN_LEVEL = 1;
+    static const int MAX_LEVEL = 5;
+
+    // patchesPerSide * patchesPerSide square patches spreading from origin along +x and +z;
+    // height(x, z) is sampled at the patch corners. Needs the OpenGL context.
+    Terrain(int patchesPerSide, float patchSize, const glm::vec3& origin, const std::function<float(float, float)>& height);
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // picks the level of every patch and tessellates the ones whose level changed, spread over
+    // the job system's workers; must be called on the thread owning the context
+    void Update(const glm::vec3& cameraPosition, JobSystem& jobs);
+    // draws the patches intersecting the frustum
+    void Draw(const Frustum& frustum);
+
+    const BoundingSphere& GetBounds() const { return bounds; }
+    int GetLevel(int x, int z) const { return patches[z * patchesPerSide + x].level; }
+
+private:
+    struct Patch
+    {
+        BezierSurface<3, float> surface;
+        BoundingSphere bounds;
+        // level of the vertices in the buffer, -1 before the first tessellation
+        int level = -1;
+    };
+
+    int patchesPerSide;
+    float patchSize;
+    glm::vec3 origin;
+    std::vector<Patch> patches;
+    BoundingSphere bounds;
+
+    // levels wanted in the next update and the patches whose vertices are outdated
+    std::vector<int> levels;
+    std::vector<int> changedPatches;
+    // one slot of the largest level per patch, in the vertex buffer and here while tessellating
+    std::vector<float> vertices;
+
+    // index patterns by level and by the edges facing a coarser patch, all in the element buffer
+    size_t patternOffsets[MAX_LEVEL + 1][16];
+    unsigned int patternCounts[MAX_LEVEL + 1][16];
+
+    unsigned int VAO, VBO, EBO;
+
+    int selectLevel(const Patch& patch, const glm::vec3& cameraPosition) const;
+    void tessellate(int index, int level, float* vertices) const;
+    static void buildPattern(int level, int coarserEdges, std::vector<unsigned int>& indices);
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "TextOverlay.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+
+// glyphs of the characters from ' ' to '_', one byte per row from the top, the lowest 5 bits from right to left
+static const unsigned char FONT_GLYPHS[64][7] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x04 }, // !
+    { 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // #
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // %
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // &
+    { 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // )
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // *
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ,
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // /
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // <
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // >
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ?
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // @
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // G
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // H
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // L
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // N
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // O
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // P
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // Q
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // R
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // S
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // W
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // X
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // Y
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // Z
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // backslash
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // ]
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // _
+};
+
+const char FIRST_GLYPH = ' ';
+const char LAST_GLYPH = '_';
+
+// the atlas has 16x4 cells of 6x8 texels, the glyph in the top left 5x7 texels of its cell
+const int GLYPH_WIDTH = 5;
+const int GLYPH_HEIGHT = 7;
+const int CELL_WIDTH = 6;
+const int CELL_HEIGHT = 8;
+const int ATLAS_COLUMNS = 16;
+const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+const int ATLAS_HEIGHT = 4 * CELL_HEIGHT;
+
+// the unused corner texel of the space's cell is opaque, backgrounds sample it
+const int SOLID_TEXEL_X = CELL_WIDTH - 1;
+const int SOLID_TEXEL_Y = CELL_HEIGHT - 1;
+
+const int FLOATS_PER_VERTEX = 8;
+
+TextOverlay::TextOverlay(float scale) : scale(scale)
+{
+    shader = new Shader("Shaders/overlay.vs.glsl", "Shaders/overlay.fs.glsl");
+
+    // build the font atlas
+    std::vector<unsigned char> atlas(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for (int glyph = 0; glyph < 64; glyph++)
+    {
+        int cellX = (glyph % ATLAS_COLUMNS) * CELL_WIDTH;
+        int cellY = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+        for (int row = 0; row < GLYPH_HEIGHT; row++)
+        {
+            for (int column = 0; column < GLYPH_WIDTH; column++)
+            {
+                if (FONT_GLYPHS[glyph][row] & (1 << (GLYPH_WIDTH - 1 - column)))
+                    atlas[(cellY + row) * ATLAS_WIDTH + cellX + column] = 255;
+            }
+        }
+    }
+    atlas[SOLID_TEXEL_Y * ATLAS_WIDTH + SOLID_TEXEL_X] = 255;
+
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // vertex layout: position, texture coordinates, color
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+}
+
+TextOverlay::~TextOverlay()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteTextures(1, &fontTexture);
+    delete shader;
+}
+
+void TextOverlay::AddText(float x, float y, const std::string& text, const glm::vec4& color)
+{
+    glm::vec2 glyphSize = glm::vec2(GLYPH_WIDTH, GLYPH_HEIGHT) * scale;
+    glm::vec2 glyphTexSize = glm::vec2((float)GLYPH_WIDTH / ATLAS_WIDTH, (float)GLYPH_HEIGHT / ATLAS_HEIGHT);
+    float advance = CELL_WIDTH * scale;
+    float lineHeight = (CELL_HEIGHT + 1) * scale;
+
+    glm::vec2 position = glm::vec2(x, y);
+    float width = 0.0f;
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            position = glm::vec2(x, position.y + lineHeight);
+            continue;
+        }
+
+        if (c >= 'a' && c <= 'z')
+            c = c - 'a' + 'A';
+        if (c >= FIRST_GLYPH && c <= LAST_GLYPH && c != ' ')
+        {
+            int glyph = c - FIRST_GLYPH;
+            glm::vec2 texCoords = glm::vec2((float)(glyph % ATLAS_COLUMNS * CELL_WIDTH) / ATLAS_WIDTH, (float)(glyph / ATLAS_COLUMNS * CELL_HEIGHT) / ATLAS_HEIGHT);
+            addQuad(textVertices, position, glyphSize, texCoords, glyphTexSize, color);
+        }
+        position.x += advance;
+        width = std::max(width, position.x - x);
+    }
+
+    // background with a margin of two font texels around the text
+    float margin = 2.0f * scale;
+    glm::vec2 textSize = glm::vec2(width, position.y - y + glyphSize.y);
+    glm::vec2 solidTexCoords = glm::vec2((SOLID_TEXEL_X + 0.5f) / ATLAS_WIDTH, (SOLID_TEXEL_Y + 0.5f) / ATLAS_HEIGHT);
+    addQuad(backgroundVertices, glm::vec2(x - margin, y - margin), textSize + glm::vec2(2.0f * margin), solidTexCoords, glm::vec2(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+}
+
+void TextOverlay::Draw(unsigned int screenWidth, unsigned int screenHeight)
+{
+    if (textVertices.empty() && backgroundVertices.empty())
+        return;
+
+    std::vector<float>& vertices = backgroundVertices;
+    vertices.insert(vertices.end(), textVertices.begin(), textVertices.end());
+    GLsizei verticesCount = (GLsizei)(vertices.size() / FLOATS_PER_VERTEX);
+
+    // the overlay is blended over everything, restore the scene's state afterwards
+    GLboolean isDepthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean isBlendEnabled = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader->use();
+    shader->setVec2("screenSize", (float)screenWidth, (float)screenHeight);
+    shader->setInt("font", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    renderStats.textureBinds++;
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, verticesCount);
+    glBindVertexArray(0);
+    renderStats.vertexArrayBinds++;
+    renderStats.AddDraw(verticesCount / 3);
+
+    if (isDepthTestEnabled)
+        glEnable(GL_DEPTH_TEST);
+    if (!isBlendEnabled)
+        glDisable(GL_BLEND);
+
+    backgroundVertices.clear();
+    textVertices.clear();
+}
+
+void TextOverlay::addQuad(std::vector<float>& vertices, glm::vec2 position, glm::vec2 size, glm::vec2 texCoords, glm::vec2 texSize, const glm::vec4& color)
+{
+    const glm::vec2 corners[6] = {
+        glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 1.0f),
+        glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f)
+    };
+
+    for (const glm::vec2& corner : corners)
+    {
+        glm::vec2 vertexPosition = position + corner * size;
+        glm::vec2 vertexTexCoords = texCoords + corner * texSize;
+        vertices.insert(vertices.end(), {
+            vertexPosition.x, vertexPosition.y, vertexTexCoords.x, vertexTexCoords.y,
+            color.r, color.g, color.b, color.a });
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+// Draws text over the rendered frame with a built-in 5x7 bitmap font covering the printable ASCII
+// characters up to '_', lowercase letters are drawn as uppercase.
+class TextOverlay
+{
+public:
+    // a character takes 6x9 pixels times the scale
+    TextOverlay(float scale = 2.0f);
+    ~TextOverlay();
+
+    TextOverlay(const TextOverlay&) = delete;
+    TextOverlay& operator=(const TextOverlay&) = delete;
+
+    // queues text on a translucent background, x and y are the pixels from the top left corner of
+    // the screen to the top left corner of the text, lines are separated by '\n'
+    void AddText(float x, float y, const std::string& text, const glm::vec4& color = glm::vec4(1.0f));
+    // draws the queued text and clears the queue
+    void Draw(unsigned int screenWidth, unsigned int screenHeight);
+
+private:
+    Shader* shader;
+    unsigned int fontTexture;
+    unsigned int VAO, VBO;
+    float scale;
+    // position, texture coordinates and color of every vertex, backgrounds go before the text
+    std::vector<float> backgroundVertices;
+    std::vector<float> textVertices;
+
+    void addQuad(std::vector<float>& vertices, glm::vec2 position, glm::vec2 size, glm::vec2 texCoords, glm::vec2 texSize, const glm::vec4& color);
+};
+
+#endif
@@ -0,0 +1,513 @@
+#include "Traffic.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRAFFIC_SSE2
+#include <immintrin.h>
+#endif
+
+// cars a job moves, fewer are moved on the calling thread alone
+const size_t TRAFFIC_GRAIN_SIZE = 1024;
+
+// intelligent driver model, in world units (a car is about 0.3 long) and seconds
+const float CRUISE_SPEED = 1.2f;
+const float MAX_ACCELERATION = 0.8f;
+const float COMFORTABLE_DECELERATION = 0.6f;
+const float MAX_DECELERATION = 2.0f;
+const float TIME_HEADWAY = 0.8f;
+const float MIN_GAP = 0.06f;
+// keeps the gap term finite when cars touch
+const float SMALLEST_GAP = 0.01f;
+// gap of a car with nothing ahead within the lanes it looks at
+const float FREE_GAP = 1000.0f;
+// lanes the first car of a lane looks ahead over
+const int LOOKAHEAD_LANES = 3;
+
+// the lanes run this fraction of a block right of the street's center, the intersections reach twice as far
+const float LANE_OFFSET = 0.06f;
+// bumper to bumper distance of the cars placed at the start, in car lengths
+const float INITIAL_SPACING = 2.2f;
+
+// the two streets of an intersection drive in turn, the last seconds of a phase are red for both so
+// the intersection clears before the other street drives
+const unsigned int PHASES_COUNT = 2;
+const double PHASE_SECONDS = 4.0;
+const double CLEARANCE_SECONDS = 0.6;
+// start of the cycle from one intersection to the next
+const double SIGNAL_STAGGER_SECONDS = 1.3;
+
+// lamps: brake lights glow while a car brakes this hard or stands, tail lights at night are dimmer
+const float BRAKE_LIGHTS_DECELERATION = -0.3f;
+const float STANDING_SPEED = 0.05f;
+const float TAIL_LIGHTS = 0.3f;
+
+static unsigned int nextRandom(unsigned int& state)
+{
+    // xorshift32, the state never becomes 0
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// values[i] = values[order[i]] for every field of the cars; the scratch takes the old storage
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<unsigned int>& order, std::vector<T>& scratch)
+{
+    scratch.resize(values.size());
+    for (size_t i = 0; i < order.size(); i++)
+        scratch[i] = values[order[i]];
+    values.swap(scratch);
+}
+
+Traffic::Traffic() : carLength(0.3f), carModel(1.0f), time(0.0)
+{
+    laneStarts.assign(1, 0);
+}
+
+Traffic::Traffic(const TrafficLayout& layout) : carLength(layout.carLength), carModel(layout.carModel), time(0.0)
+{
+    buildLanes(layout);
+    placeCars(layout.carsCount);
+}
+
+void Traffic::buildLanes(const TrafficLayout& layout)
+{
+    int side = std::max((int)(layout.side / layout.blockSize) + 1, 2);
+    float first = -0.5f * (side - 1) * layout.blockSize;
+    float offset = LANE_OFFSET * layout.blockSize;
+    float radius = 2.0f * offset;
+
+    std::vector<glm::vec3> intersections(side * side);
+    std::vector<unsigned char> isOpen(side * side);
+    signalOffsets.resize(side * side);
+    for (int iz = 0; iz < side; iz++)
+    {
+        for (int ix = 0; ix < side; ix++)
+        {
+            int node = iz * side + ix;
+            float x = layout.center.x + first + ix * layout.blockSize;
+            float z = layout.center.y + first + iz * layout.blockSize;
+            intersections[node] = glm::vec3(x, 0.0f, z);
+            isOpen[node] = layout.isOpen(x, z) ? 1 : 0;
+            signalOffsets[node] = (float)fmod((ix + iz) * SIGNAL_STAGGER_SECONDS, PHASE_SECONDS * PHASES_COUNT);
+        }
+    }
+
+    auto ground = [&layout](glm::vec3 point) {
+        point.y = layout.height(point.x, point.z);
+        return point;
+    };
+    auto addLane = [this](const glm::vec3& start, const glm::vec3& end, unsigned int signal, unsigned int phase) {
+        Lane lane;
+        lane.start = start;
+        lane.length = glm::length(end - start);
+        lane.direction = (end - start) / lane.length;
+        lane.firstNext = 0;
+        lane.nextCount = 0;
+        lane.signal = signal;
+        lane.phase = phase;
+        lanes.push_back(lane);
+        return (unsigned int)lanes.size() - 1;
+    };
+
+    // a lane each way along every street between two open intersections, from the edge of one to the
+    // stop line of the other; the street drives in the phase of its axis
+    std::vector<std::vector<unsigned int>> incoming(side * side), outgoing(side * side);
+    for (int node = 0; node < side * side; node++)
+    {
+        int neighbours[2] = { node % side + 1 < side ? node + 1 : -1, node + side < side * side ? node + side : -1 };
+        for (int axis = 0; axis < 2; axis++)
+        {
+            int neighbour = neighbours[axis];
+            if (!isOpen[node] || neighbour < 0 || !isOpen[neighbour])
+                continue;
+
+            for (int way = 0; way < 2; way++)
+            {
+                int from = way == 0 ? node : neighbour;
+                int to = way == 0 ? neighbour : node;
+                glm::vec3 direction = glm::normalize(intersections[to] - intersections[from]);
+                glm::vec3 right = glm::vec3(-direction.z, 0.0f, direction.x);
+                glm::vec3 start = ground(intersections[from] + direction * radius + right * offset);
+                glm::vec3 end = ground(intersections[to] - direction * radius + right * offset);
+
+                unsigned int lane = addLane(start, end, (unsigned int)to, (unsigned int)axis);
+                outgoing[from].push_back(lane);
+                incoming[to].push_back(lane);
+            }
+        }
+    }
+
+    // the lanes within the intersections, from every stop line straight on and to the right; the
+    // lanes of the same phase never cross that way. Turning left or back only where there's no other way
+    for (int node = 0; node < side * side; node++)
+    {
+        for (unsigned int in : incoming[node])
+        {
+            std::vector<unsigned int> connections;
+            for (int pass = 0; pass < 2 && connections.empty(); pass++)
+            {
+                for (unsigned int out : outgoing[node])
+                {
+                    const glm::vec3& from = lanes[in].direction;
+                    const glm::vec3& to = lanes[out].direction;
+                    bool isTurningBack = glm::dot(from, to) < -0.5f;
+                    bool isTurningLeft = from.x * to.z - from.z * to.x < -0.5f;
+                    if ((isTurningBack || isTurningLeft) && pass == 0)
+                        continue;
+                    glm::vec3 end = lanes[in].start + lanes[in].direction * lanes[in].length;
+                    connections.push_back(addLane(end, lanes[out].start, NO_SIGNAL, 0));
+                    lanes.back().firstNext = (unsigned int)successors.size();
+                    lanes.back().nextCount = 1;
+                    successors.push_back(out);
+                }
+            }
+
+            lanes[in].firstNext = (unsigned int)successors.size();
+            lanes[in].nextCount = (unsigned int)connections.size();
+            successors.insert(successors.end(), connections.begin(), connections.end());
+        }
+    }
+}
+
+void Traffic::placeCars(unsigned int carsCount)
+{
+    // the street lanes are filled one place after another, each place on every lane before the next
+    float spacing = INITIAL_SPACING * carLength;
+    unsigned int placesCount = 0;
+    for (const Lane& lane : lanes)
+    {
+        if (lane.signal != NO_SIGNAL)
+            placesCount = std::max(placesCount, (unsigned int)(lane.length / spacing));
+    }
+
+    for (unsigned int place = 0; place < placesCount && carLanes.size() < carsCount; place++)
+    {
+        for (unsigned int lane = 0; lane < lanes.size() && carLanes.size() < carsCount; lane++)
+        {
+            if (lanes[lane].signal == NO_SIGNAL || (place + 1) * spacing > lanes[lane].length)
+                continue;
+
+            unsigned int seed = (unsigned int)carLanes.size() * 2654435761u + 1u;
+            seed = seed == 0 ? 1u : seed;
+            carLanes.push_back(lane);
+            positions.push_back(lanes[lane].length - (place + 0.5f) * spacing);
+            speeds.push_back(0.0f);
+            desiredSpeeds.push_back(CRUISE_SPEED * (0.8f + 0.4f * (nextRandom(seed) & 0xFFFF) / 65535.0f));
+            accelerations.push_back(0.0f);
+            nextLanes.push_back(pickNextLane(lane, seed));
+            seeds.push_back(seed);
+        }
+    }
+    if (carLanes.size() < carsCount)
+        std::cout << "Traffic: " << carLanes.size() << " of " << carsCount << " cars fit on the streets" << std::endl;
+
+    size_t count = carLanes.size();
+    previousX.resize(count);
+    previousY.resize(count);
+    previousZ.resize(count);
+    worldX.resize(count);
+    worldY.resize(count);
+    worldZ.resize(count);
+    headingX.resize(count);
+    headingZ.resize(count);
+    laneStarts.resize(lanes.size() + 1);
+    sortCars();
+    for (size_t car = 0; car < count; car++)
+        updateWorldPosition(car);
+    previousX = worldX;
+    previousY = worldY;
+    previousZ = worldZ;
+}
+
+bool Traffic::isRed(unsigned int lane) const
+{
+    if (lanes[lane].signal == NO_SIGNAL)
+        return false;
+
+    double cycleTime = fmod(time + signalOffsets[lanes[lane].signal], PHASE_SECONDS * PHASES_COUNT);
+    unsigned int phase = (unsigned int)(cycleTime / PHASE_SECONDS);
+    return phase != lanes[lane].phase || cycleTime - phase * PHASE_SECONDS > PHASE_SECONDS - CLEARANCE_SECONDS;
+}
+
+bool Traffic::hasRoomAfter(unsigned int lane) const
+{
+    if (lane == NO_LANE || lanes[lane].nextCount != 1)
+        return true;
+
+    // every car already crossing needs its place behind the last one on the street it leaves by
+    unsigned int exit = successors[lanes[lane].firstNext];
+    if (laneStarts[exit + 1] == laneStarts[exit])
+        return true;
+    unsigned int crossingCount = laneStarts[lane + 1] - laneStarts[lane];
+    float room = positions[laneStarts[exit + 1] - 1] - carLength;
+    return room >= (crossingCount + 1) * (carLength + MIN_GAP);
+}
+
+unsigned int Traffic::pickNextLane(unsigned int lane, unsigned int& seed) const
+{
+    if (lanes[lane].nextCount == 0)
+        return NO_LANE;
+    return successors[lanes[lane].firstNext + nextRandom(seed) % lanes[lane].nextCount];
+}
+
+void Traffic::Step(float timeStep, JobSystem& jobs)
+{
+    PROFILE_SCOPE("Traffic step");
+
+    time += timeStep;
+    size_t count = carLanes.size();
+    gaps.resize(count);
+    leaderSpeeds.resize(count);
+
+    // every pass writes only the fields of the cars of its own range, the ones it reads of the others
+    // were written by an earlier pass
+    jobs.ParallelFor(0, count, TRAFFIC_GRAIN_SIZE, [this](size_t begin, size_t end) {
+        findGaps(begin, end);
+    });
+    jobs.ParallelFor(0, count, TRAFFIC_GRAIN_SIZE, [this, timeStep](size_t begin, size_t end) {
+        accelerate(begin, end, timeStep);
+    });
+    jobs.ParallelFor(0, count, TRAFFIC_GRAIN_SIZE, [this](size_t begin, size_t end) {
+        advanceLanes(begin, end);
+    });
+    sortCars();
+}
+
+void Traffic::findGaps(size_t begin, size_t end)
+{
+    for (size_t car = begin; car < end; car++)
+    {
+        unsigned int lane = carLanes[car];
+        if (car > laneStarts[lane])
+        {
+            gaps[car] = positions[car - 1] - positions[car] - carLength;
+            leaderSpeeds[car] = speeds[car - 1];
+            continue;
+        }
+
+        // a car waiting at the stop line for room behind the intersection tries another way, so
+        // the cars around a block of full streets don't wait for each other forever
+        if (speeds[car] < STANDING_SPEED && lanes[lane].signal != NO_SIGNAL && !hasRoomAfter(nextLanes[car]))
+            nextLanes[car] = pickNextLane(lane, seeds[car]);
+
+        // the first car of a lane looks ahead over the lanes it's going to take; a red signal, or a
+        // green one with no room behind the intersection, is a standing car at the stop line, unless
+        // the car is already too near to stop
+        float ahead = lanes[lane].length - positions[car];
+        float stoppingDistance = speeds[car] * speeds[car] / (2.0f * MAX_DECELERATION);
+        unsigned int next = nextLanes[car];
+        float gap = FREE_GAP;
+        float leaderSpeed = speeds[car];
+        for (int k = 0; k < LOOKAHEAD_LANES; k++)
+        {
+            if (lanes[lane].signal != NO_SIGNAL && (isRed(lane) || !hasRoomAfter(next)) && ahead > stoppingDistance)
+            {
+                gap = ahead;
+                leaderSpeed = 0.0f;
+                break;
+            }
+            if (next == NO_LANE)
+                break;
+            if (laneStarts[next + 1] > laneStarts[next])
+            {
+                unsigned int last = laneStarts[next + 1] - 1;
+                gap = ahead + positions[last] - carLength;
+                leaderSpeed = speeds[last];
+                break;
+            }
+
+            ahead += lanes[next].length;
+            lane = next;
+            next = lanes[lane].nextCount == 1 ? successors[lanes[lane].firstNext] : NO_LANE;
+        }
+        gaps[car] = gap;
+        leaderSpeeds[car] = leaderSpeed;
+    }
+}
+
+void Traffic::accelerate(size_t begin, size_t end, float timeStep)
+{
+    // a = A * (1 - (v / v0)^4 - (s* / s)^2) with the desired gap s* = s0 + max(0, v * T + v * dv / (2 * sqrt(A * B)))
+    const float interaction = 1.0f / (2.0f * sqrt(MAX_ACCELERATION * COMFORTABLE_DECELERATION));
+    const float halfStep = 0.5f * timeStep;
+
+    size_t car = begin;
+#ifdef TRAFFIC_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 smallestGap = _mm_set1_ps(SMALLEST_GAP);
+    const __m128 minGap = _mm_set1_ps(MIN_GAP);
+    const __m128 headway = _mm_set1_ps(TIME_HEADWAY);
+    const __m128 interactions = _mm_set1_ps(interaction);
+    const __m128 maxAcceleration = _mm_set1_ps(MAX_ACCELERATION);
+    const __m128 maxDeceleration = _mm_set1_ps(-MAX_DECELERATION);
+    const __m128 step = _mm_set1_ps(timeStep);
+    const __m128 halfSteps = _mm_set1_ps(halfStep);
+    for (; car + 4 <= end; car += 4)
+    {
+        __m128 speed = _mm_loadu_ps(&speeds[car]);
+        __m128 gap = _mm_max_ps(_mm_loadu_ps(&gaps[car]), smallestGap);
+        __m128 ratio = _mm_div_ps(speed, _mm_loadu_ps(&desiredSpeeds[car]));
+        ratio = _mm_mul_ps(ratio, ratio);
+        ratio = _mm_mul_ps(ratio, ratio);
+        __m128 approach = _mm_mul_ps(_mm_mul_ps(speed, _mm_sub_ps(speed, _mm_loadu_ps(&leaderSpeeds[car]))), interactions);
+        __m128 desiredGap = _mm_add_ps(minGap, _mm_max_ps(_mm_add_ps(_mm_mul_ps(speed, headway), approach), zero));
+        __m128 pressure = _mm_div_ps(desiredGap, gap);
+        __m128 acceleration = _mm_mul_ps(maxAcceleration, _mm_sub_ps(_mm_sub_ps(one, ratio), _mm_mul_ps(pressure, pressure)));
+        acceleration = _mm_max_ps(acceleration, maxDeceleration);
+        __m128 newSpeed = _mm_max_ps(_mm_add_ps(speed, _mm_mul_ps(acceleration, step)), zero);
+
+        _mm_storeu_ps(&positions[car], _mm_add_ps(_mm_loadu_ps(&positions[car]), _mm_mul_ps(_mm_add_ps(speed, newSpeed), halfSteps)));
+        _mm_storeu_ps(&speeds[car], newSpeed);
+        _mm_storeu_ps(&accelerations[car], acceleration);
+    }
+#endif
+    for (; car < end; car++)
+    {
+        float speed = speeds[car];
+        float gap = std::max(gaps[car], SMALLEST_GAP);
+        float ratio = speed / desiredSpeeds[car];
+        ratio = ratio * ratio;
+        ratio = ratio * ratio;
+        float approach = speed * (speed - leaderSpeeds[car]) * interaction;
+        float desiredGap = MIN_GAP + std::max(speed * TIME_HEADWAY + approach, 0.0f);
+        float pressure = desiredGap / gap;
+        float acceleration = std::max(MAX_ACCELERATION * (1.0f - ratio - pressure * pressure), -MAX_DECELERATION);
+        float newSpeed = std::max(speed + acceleration * timeStep, 0.0f);
+
+        positions[car] += (speed + newSpeed) * halfStep;
+        speeds[car] = newSpeed;
+        accelerations[car] = acceleration;
+    }
+}
+
+void Traffic::advanceLanes(size_t begin, size_t end)
+{
+    for (size_t car = begin; car < end; car++)
+    {
+        previousX[car] = worldX[car];
+        previousY[car] = worldY[car];
+        previousZ[car] = worldZ[car];
+
+        while (positions[car] >= lanes[carLanes[car]].length && nextLanes[car] != NO_LANE)
+        {
+            positions[car] -= lanes[carLanes[car]].length;
+            carLanes[car] = nextLanes[car];
+            nextLanes[car] = pickNextLane(carLanes[car], seeds[car]);
+        }
+        updateWorldPosition(car);
+    }
+}
+
+void Traffic::updateWorldPosition(size_t car)
+{
+    const Lane& lane = lanes[carLanes[car]];
+    glm::vec3 position = lane.start + lane.direction * positions[car];
+    worldX[car] = position.x;
+    worldY[car] = position.y;
+    worldZ[car] = position.z;
+
+    // upright along the lane, whatever its slope
+    float horizontal = sqrt(lane.direction.x * lane.direction.x + lane.direction.z * lane.direction.z);
+    headingX[car] = lane.direction.x / horizontal;
+    headingZ[car] = lane.direction.z / horizontal;
+}
+
+void Traffic::sortCars()
+{
+    PROFILE_SCOPE("Traffic sort");
+
+    // counting sort by lane keeps the order within a lane, so only the cars that just came onto a
+    // lane are out of place; they're at the back of it and moved there by insertion
+    size_t count = carLanes.size();
+    std::fill(laneStarts.begin(), laneStarts.end(), 0);
+    for (size_t car = 0; car < count; car++)
+        laneStarts[carLanes[car] + 1]++;
+    for (size_t lane = 0; lane < lanes.size(); lane++)
+        laneStarts[lane + 1] += laneStarts[lane];
+
+    laneCursors.assign(laneStarts.begin(), laneStarts.end() - 1);
+    order.resize(count);
+    for (size_t car = 0; car < count; car++)
+        order[laneCursors[carLanes[car]]++] = (unsigned int)car;
+
+    for (size_t lane = 0; lane < lanes.size(); lane++)
+    {
+        for (unsigned int i = laneStarts[lane] + 1; i < laneStarts[lane + 1]; i++)
+        {
+            unsigned int car = order[i];
+            unsigned int j = i;
+            for (; j > laneStarts[lane] && positions[order[j - 1]] < positions[car]; j--)
+                order[j] = order[j - 1];
+            order[j] = car;
+        }
+    }
+
+    permute(carLanes, order, indexScratch);
+    permute(nextLanes, order, indexScratch);
+    permute(seeds, order, indexScratch);
+    permute(positions, order, floatScratch);
+    permute(speeds, order, floatScratch);
+    permute(desiredSpeeds, order, floatScratch);
+    permute(accelerations, order, floatScratch);
+    permute(previousX, order, floatScratch);
+    permute(previousY, order, floatScratch);
+    permute(previousZ, order, floatScratch);
+    permute(worldX, order, floatScratch);
+    permute(worldY, order, floatScratch);
+    permute(worldZ, order, floatScratch);
+    permute(headingX, order, floatScratch);
+    permute(headingZ, order, floatScratch);
+}
+
+void Traffic::BuildInstances(float alpha, const Frustum& frustum, const glm::vec3& viewPosition, float drawDistance, bool areHeadlightsOn,
+    JobSystem& jobs, std::vector<CarInstance>& instances)
+{
+    PROFILE_SCOPE("Traffic instances");
+
+    // every job writes the instances and flags of its own cars, the visible ones are moved together afterwards
+    size_t count = carLanes.size();
+    instances.resize(count);
+    visibility.resize(count);
+    jobs.ParallelFor(0, count, TRAFFIC_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        BoundingSphere bounds;
+        bounds.radius = 0.6f * carLength;
+        for (size_t car = begin; car < end; car++)
+        {
+            glm::vec3 previous = glm::vec3(previousX[car], previousY[car], previousZ[car]);
+            glm::vec3 position = previous + (glm::vec3(worldX[car], worldY[car], worldZ[car]) - previous) * alpha;
+            glm::vec3 offset = position - viewPosition;
+            bounds.center = position;
+            visibility[car] = glm::dot(offset, offset) <= drawDistance * drawDistance && frustum.Intersects(bounds) ? 1 : 0;
+            if (!visibility[car])
+                continue;
+
+            // turns +z to the heading around the vertical axis
+            float x = headingX[car];
+            float z = headingZ[car];
+            glm::mat4 placement = glm::mat4(glm::vec4(z, 0.0f, -x, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f), glm::vec4(x, 0.0f, z, 0.0f), glm::vec4(position, 1.0f));
+
+            bool isBraking = accelerations[car] < BRAKE_LIGHTS_DECELERATION || speeds[car] < STANDING_SPEED;
+            CarInstance& instance = instances[car];
+            instance.model = placement * carModel;
+            instance.lamps = glm::vec4(areHeadlightsOn ? 1.0f : 0.0f, isBraking ? 1.0f : (areHeadlightsOn ? TAIL_LIGHTS : 0.0f), 0.0f, 0.0f);
+        }
+    });
+
+    size_t visibleCount = 0;
+    for (size_t car = 0; car < count; car++)
+    {
+        if (!visibility[car])
+            continue;
+        if (visibleCount != car)
+            instances[visibleCount] = instances[car];
+        visibleCount++;
+    }
+    instances.resize(visibleCount);
+}
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "FramePacket.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+
+// where the streets go and what drives on them
+struct TrafficLayout
+{
+    unsigned int carsCount = 0;
+    // the streets form a square grid of intersections blockSize apart, side long and centered on the
+    // x and z of center; the heights come from the ground
+    glm::vec2 center = glm::vec2(0.0f);
+    float side = 0.0f;
+    float blockSize = 2.0f;
+    // bumper to bumper, the gaps between the cars are measured without it
+    float carLength = 0.3f;
+    // places the car model facing +z with its wheels on the origin
+    glm::mat4 carModel = glm::mat4(1.0f);
+    // height of the ground, and whether a street may pass a point; intersections on closed points are left out
+    std::function<float(float, float)> height;
+    std::function<bool(float, float)> isOpen;
+};
+
+// Cars driving a grid of streets. Every street has a lane each way, the intersections join them with
+// short lanes for going straight and turning right, and a signal at every intersection lets its two
+// streets drive in turn, so the lanes within an intersection never cross while they're used. The cars
+// follow each other with the intelligent driver model (Treiber et al.), stop at red signals and
+// pick a random way at every intersection.
+//
+// The state of the cars is kept in arrays, one per field, sorted by lane and, within a lane, from the
+// car nearest to its end on; the car ahead is then the previous one or the last one of the next lane.
+// A step runs over them in a few passes spread over the job system: finding the gaps, the
+// acceleration (vectorized), moving on to the next lanes, and sorting again, which only moves the few
+// cars that changed lanes.
+class Traffic
+{
+public:
+    Traffic();
+    // as many cars as fit on the streets, at most layout.carsCount
+    Traffic(const TrafficLayout& layout);
+
+    // advances every car by timeStep seconds
+    void Step(float timeStep, JobSystem& jobs);
+    // model matrices and lamps of the cars intersecting the frustum within drawDistance of the
+    // viewer, their positions blended from the last two steps by alpha; the headlights are on at night
+    void BuildInstances(float alpha, const Frustum& frustum, const glm::vec3& viewPosition, float drawDistance, bool areHeadlightsOn,
+        JobSystem& jobs, std::vector<CarInstance>& instances);
+
+    size_t GetCarsCount() const { return carLanes.size(); }
+    size_t GetLanesCount() const { return lanes.size(); }
+
+private:
+    static const unsigned int NO_LANE = ~0u;
+    static const unsigned int NO_SIGNAL = ~0u;
+
+    struct Lane
+    {
+        glm::vec3 start;
+        // unit vector from the start to the end
+        glm::vec3 direction;
+        float length;
+        // lanes a car may continue on, a range of successors
+        unsigned int firstNext;
+        unsigned int nextCount;
+        // intersection whose signal guards the end of the lane, NO_SIGNAL for the lanes within intersections
+        unsigned int signal;
+        // phase of the signal the lane drives in
+        unsigned int phase;
+    };
+
+    std::vector<Lane> lanes;
+    std::vector<unsigned int> successors;
+    // seconds into its cycle every signal started
+    std::vector<float> signalOffsets;
+    float carLength;
+    glm::mat4 carModel;
+    // seconds the signals have run
+    double time;
+
+    // the cars, sorted by lane and by falling position within a lane
+    std::vector<unsigned int> carLanes;
+    // lane taken at the end of the current one
+    std::vector<unsigned int> nextLanes;
+    // distance from the start of the lane
+    std::vector<float> positions;
+    std::vector<float> speeds;
+    std::vector<float> desiredSpeeds;
+    std::vector<float> accelerations;
+    // random state of the car's choices
+    std::vector<unsigned int> seeds;
+    // world positions after the last two steps and the heading after the last one
+    std::vector<float> previousX, previousY, previousZ;
+    std::vector<float> worldX, worldY, worldZ;
+    std::vector<float> headingX, headingZ;
+
+    // filled by every step: the distance to what's ahead and how fast it moves
+    std::vector<float> gaps;
+    std::vector<float> leaderSpeeds;
+    // first car of every lane, laneStarts[lane + 1] - laneStarts[lane] cars are on it
+    std::vector<unsigned int> laneStarts;
+    std::vector<unsigned int> laneCursors;
+    std::vector<unsigned int> order;
+    std::vector<unsigned char> visibility;
+    std::vector<float> floatScratch;
+    std::vector<unsigned int> indexScratch;
+
+    void buildLanes(const TrafficLayout& layout);
+    void placeCars(unsigned int carsCount);
+    bool isRed(unsigned int lane) const;
+    // whether a car can leave the intersection lane after the given one without waiting in it
+    bool hasRoomAfter(unsigned int lane) const;
+    unsigned int pickNextLane(unsigned int lane, unsigned int& seed) const;
+    void findGaps(size_t begin, size_t end);
+    void accelerate(size_t begin, size_t end, float timeStep);
+    void advanceLanes(size_t begin, size_t end);
+    void updateWorldPosition(size_t car);
+    void sortCars();
+};
+
+#endif
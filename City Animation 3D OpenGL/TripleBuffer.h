@@ -0,0 +1,55 @@
+#pragma once
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free exchange of values between one writer and one reader thread. The writer fills its
+// buffer and publishes it, the reader picks up the latest published one; neither ever waits and
+// each side keeps its buffer to itself until it swaps it for the shared middle one.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : middle(2), front(0), back(1) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer thread: the buffer to fill, its previous contents are stale
+    T& GetWriteBuffer() { return buffers[back]; }
+
+    // writer thread: makes the write buffer the latest value
+    void Publish()
+    {
+        unsigned int previous = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // reader thread: switches to the latest value, returns false if nothing was published since the last call
+    bool Acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+            return false;
+
+        unsigned int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        return true;
+    }
+
+    // reader thread: the value taken by the last successful Acquire
+    const T& GetReadBuffer() const { return buffers[front]; }
+
+private:
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int FRESH_BIT = 4;
+
+    T buffers[3];
+    // index of the shared buffer, with FRESH_BIT set while the reader hasn't taken it
+    alignas(64) std::atomic<unsigned int> middle;
+    // owned by the reader and the writer, on separate cache lines
+    alignas(64) unsigned int front;
+    alignas(64) unsigned int back;
+};
+
+#endif
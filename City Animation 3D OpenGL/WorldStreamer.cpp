@@ -0,0 +1,191 @@
+#include "WorldStreamer.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "ResourcePack.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+WorldStreamer::WorldStreamer(const std::vector<WorldChunk>& chunks, const StreamingBudget& budget, JobSystem& jobs) : jobs(jobs), budget(budget), slots(chunks.size())
+{
+    // the corners of the boxes around the chunks' spheres, the sphere through them holds every chunk
+    std::vector<glm::vec3> corners;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        slots[i].chunk = chunks[i];
+        corners.push_back(chunks[i].bounds.center - glm::vec3(chunks[i].bounds.radius));
+        corners.push_back(chunks[i].bounds.center + glm::vec3(chunks[i].bounds.radius));
+    }
+    bounds = BoundingSphere::FromPoints(corners);
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    Flush();
+    for (Slot& slot : slots)
+        delete slot.model;
+}
+
+bool WorldStreamer::LoadManifest(const std::string& path, std::vector<WorldChunk>& chunks)
+{
+    ResourceFile file;
+    if (!file.Open(path))
+    {
+        std::cout << "ERROR::WORLD_STREAMER::MANIFEST_NOT_FOUND: " << path << std::endl;
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::istringstream lines(std::string(file.GetData(), file.GetSize()));
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream values(line);
+        std::string modelPath;
+        glm::vec3 position;
+        float pitch, yaw, scale, radius;
+        if (!(values >> modelPath >> position.x >> position.y >> position.z >> pitch >> yaw >> scale >> radius))
+        {
+            std::cout << "ERROR::WORLD_STREAMER::INVALID_CHUNK: " << line << std::endl;
+            continue;
+        }
+
+        WorldChunk chunk;
+        chunk.modelPath = directory + modelPath;
+        chunk.transform = glm::translate(glm::mat4(1.0f), position);
+        chunk.transform = glm::rotate(chunk.transform, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+        chunk.transform = glm::rotate(chunk.transform, glm::radians(pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+        chunk.transform = glm::scale(chunk.transform, glm::vec3(scale));
+        chunk.bounds.center = position;
+        chunk.bounds.radius = radius;
+        chunks.push_back(chunk);
+    }
+
+    if (chunks.empty())
+    {
+        std::cout << "ERROR::WORLD_STREAMER::EMPTY_MANIFEST: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void WorldStreamer::Update(const glm::vec3& viewPosition)
+{
+    PROFILE_SCOPE("WorldStreamer::Update");
+    frame++;
+
+    // the models created by now count against the budget from this frame on
+    for (Slot& slot : slots)
+    {
+        if (slot.state != CHUNK_LOADING || !slot.loaded->IsDone())
+            continue;
+        slot.loaded.reset();
+        slot.state = CHUNK_RESIDENT;
+        slot.lastUsedFrame = frame;
+        loadsInFlight--;
+        residentCount++;
+        cpuBytes += slot.model->CpuBytes;
+        gpuBytes += slot.model->GpuBytes;
+        slot.model->PrintMemoryReport(std::cout);
+    }
+
+    // the chunks near the camera are kept, the missing ones wanted nearest first
+    std::vector<std::pair<float, size_t>> wanted;
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        Slot& slot = slots[i];
+        float distance = glm::length(slot.chunk.bounds.center - viewPosition) - slot.chunk.bounds.radius;
+        if (distance > budget.loadDistance)
+            continue;
+        if (slot.state == CHUNK_UNLOADED)
+            wanted.push_back(std::make_pair(distance, i));
+        else
+            slot.lastUsedFrame = frame;
+    }
+
+    while (cpuBytes > budget.cpuBytes || gpuBytes > budget.gpuBytes)
+    {
+        Slot* candidate = findEvictionCandidate();
+        if (candidate == NULL)
+            break;
+        evict(*candidate);
+    }
+
+    // no new loads while the chunks in use alone exceed the budget, they would only be evicted again
+    if (cpuBytes > budget.cpuBytes || gpuBytes > budget.gpuBytes)
+        return;
+
+    std::sort(wanted.begin(), wanted.end());
+    for (const std::pair<float, size_t>& chunk : wanted)
+    {
+        if (loadsInFlight >= budget.maxLoadsInFlight)
+            break;
+        startLoad(slots[chunk.second]);
+    }
+}
+
+void WorldStreamer::Flush()
+{
+    for (Slot& slot : slots)
+    {
+        if (slot.state == CHUNK_LOADING)
+            jobs.Wait(*slot.loaded);
+    }
+}
+
+void WorldStreamer::Draw(Shader& shader, const Frustum& frustum)
+{
+    for (Slot& slot : slots)
+    {
+        if (slot.state != CHUNK_RESIDENT || !frustum.Intersects(slot.chunk.bounds))
+            continue;
+        shader.setMat4("model", slot.chunk.transform);
+        slot.model->Draw(shader);
+    }
+}
+
+void WorldStreamer::startLoad(Slot& slot)
+{
+    // the worker reads and decodes the files, the OpenGL objects are created by the main thread
+    // when the render loop runs its jobs
+    slot.state = CHUNK_LOADING;
+    slot.loaded.reset(new JobCounter());
+    loadsInFlight++;
+    Slot* loading = &slot;
+    JobSystem* jobSystem = &jobs;
+    // the render and simulation threads must never pick a load up while they wait for their own jobs,
+    // it would wait for the main thread in turn
+    jobs.RunOnWorker([loading, jobSystem] { loading->model = new Model(loading->chunk.modelPath, jobSystem); }, slot.loaded.get());
+}
+
+void WorldStreamer::evict(Slot& slot)
+{
+    cpuBytes -= slot.model->CpuBytes;
+    gpuBytes -= slot.model->GpuBytes;
+    residentCount--;
+    evictionCount++;
+    delete slot.model;
+    slot.model = NULL;
+    slot.state = CHUNK_UNLOADED;
+}
+
+WorldStreamer::Slot* WorldStreamer::findEvictionCandidate()
+{
+    Slot* candidate = NULL;
+    for (Slot& slot : slots)
+    {
+        if (slot.state != CHUNK_RESIDENT || slot.lastUsedFrame == frame)
+            continue;
+        if (candidate == NULL || slot.lastUsedFrame < candidate->lastUsedFrame)
+            candidate = &slot;
+    }
+    return candidate;
+}
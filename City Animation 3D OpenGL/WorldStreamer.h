@@ -0,0 +1,106 @@
+#pragma once
+#ifndef WORLD_STREAMER_H
+#define WORLD_STREAMER_H
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Frustum.h"
+#include "JobSystem.h"
+
+class Model;
+class Shader;
+
+// a piece of the world loaded and dropped as a whole, placed by its transform; the bounds are in
+// world space
+struct WorldChunk
+{
+    std::string modelPath;
+    glm::mat4 transform = glm::mat4(1.0f);
+    BoundingSphere bounds;
+};
+
+// how much of the world may be loaded at once
+struct StreamingBudget
+{
+    // bytes of the meshes kept in memory and of the buffers and textures on the GPU
+    size_t cpuBytes = 256u << 20;
+    size_t gpuBytes = 512u << 20;
+    // chunks whose bounds come closer to the camera are loaded
+    float loadDistance = 60.0f;
+    unsigned int maxLoadsInFlight = 2;
+};
+
+// Loads the chunks of the world around the camera in the background and drops the least recently
+// used ones once the loaded chunks take more memory than the budget allows. The files are read and
+// decoded by the job system's workers, the OpenGL objects created by the main thread between frames,
+// so the render loop never waits for a chunk; a chunk shows up a few frames after it's wanted.
+class WorldStreamer
+{
+public:
+    WorldStreamer(const std::vector<WorldChunk>& chunks, const StreamingBudget& budget, JobSystem& jobs);
+    // waits for the loads in flight, then deletes the loaded models; needs the OpenGL context
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // reads the chunks of a manifest, one per line: model path relative to the manifest, position,
+    // pitch and yaw in degrees, scale and the radius of the chunk's bounds; # starts a comment
+    static bool LoadManifest(const std::string& path, std::vector<WorldChunk>& chunks);
+
+    // takes the finished loads, starts the nearest wanted ones and evicts down to the budget; must
+    // be called on the thread owning the context, once per frame
+    void Update(const glm::vec3& viewPosition);
+    // waits until every load in flight is done, the next update takes them
+    void Flush();
+    // draws the loaded chunks intersecting the frustum, setting the shader's model matrix for each
+    void Draw(Shader& shader, const Frustum& frustum);
+
+    // sphere around every chunk, loaded or not
+    const BoundingSphere& GetBounds() const { return bounds; }
+    size_t GetChunkCount() const { return slots.size(); }
+    size_t GetResidentCount() const { return residentCount; }
+    size_t GetCpuBytes() const { return cpuBytes; }
+    size_t GetGpuBytes() const { return gpuBytes; }
+    size_t GetEvictionCount() const { return evictionCount; }
+
+private:
+    enum ChunkState
+    {
+        CHUNK_UNLOADED,
+        CHUNK_LOADING,
+        CHUNK_RESIDENT
+    };
+
+    struct Slot
+    {
+        WorldChunk chunk;
+        ChunkState state = CHUNK_UNLOADED;
+        // written by the loading job, read once its counter is done
+        Model* model = NULL;
+        std::unique_ptr<JobCounter> loaded;
+        unsigned long long lastUsedFrame = 0;
+    };
+
+    JobSystem& jobs;
+    StreamingBudget budget;
+    std::vector<Slot> slots;
+    BoundingSphere bounds;
+    unsigned long long frame = 0;
+    size_t residentCount = 0;
+    size_t loadsInFlight = 0;
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+    size_t evictionCount = 0;
+
+    void startLoad(Slot& slot);
+    void evict(Slot& slot);
+    // the least recently used chunk not drawn this frame, NULL if there is none
+    Slot* findEvictionCandidate();
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include <iostream>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -10,10 +17,33 @@
 
 #include "stb_image.h"
 #include "Shader.h"
-#include "Camera.h"
+#include "ShaderCompiler.h"
+#include "RenderContext.h"
+#include "RenderStats.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "JobSystem.h"
+#include "JobSystemBenchmark.h"
+#include "BezierBenchmark.h"
+#include "ObjBenchmark.h"
+#include "BezierTessellationCheck.h"
+#include "TextOverlay.h"
+#include "SimulationThread.h"
+#include "SceneComponents.h"
+#include "FramePacket.h"
+#include "Frustum.h"
 #include "Model.h"
 #include "Bezier.h"
-
+#include "Terrain.h"
+#include "AnimatedSurface.h"
+#include "StreamBuffer.h"
+#include "Traffic.h"
+#include "WorldStreamer.h"
+#include "ResourcePack.h"
+
+void setLightingUniforms(Shader& shader, const FramePacket& packet);
+void drawStatsOverlay(TextOverlay& overlay, const FramePacket& packet);
 void processInput(GLFWwindow* window);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -21,25 +51,70 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 // settings
-const unsigned int SCR_WIDTH = 1920;
-const unsigned int SCR_HEIGHT = 1080;
-
-// cameras
-Camera* stationaryCamera;
-Camera* followingCamera;
-Camera* fppCamera;
-Camera* freeCamera;
-
-Camera* activeCamera;
-bool freeCameraActive;
+unsigned int screenWidth = 1920;
+unsigned int screenHeight = 1080;
+const int SHADER_COMPILER_THREADS = 2;
+// screen length of a segment of the hardware tessellated Bezier surface
+const float BEZIER_PIXELS_PER_SEGMENT = 8.0f;
+// the landscape around the city
+const int TERRAIN_PATCHES = 10;
+const float TERRAIN_PATCH_SIZE = 8.0f;
+// the lake in the hills, its waves are re-tessellated within the budget every frame
+const int WATER_PATCHES = 8;
+const float WATER_PATCH_SIZE = 3.0f;
+const double WATER_BUDGET_MILLISECONDS = 1.0;
+// the traffic on the streets around the city, cars farther away aren't drawn
+const float TRAFFIC_BLOCK_SIZE = 2.0f;
+const float TRAFFIC_DRAW_DISTANCE = 35.0f;
+// the car model is 2.9 units long and scaled by 0.1, its front lies towards -y
+const float CAR_LENGTH = 0.29f;
+const glm::vec3 CAR_LAMP_AXIS = glm::vec3(0.0f, -1.0f, 0.0f);
+const float CAR_HEADLIGHTS_START = 1.15f;
+const float CAR_BRAKE_LIGHTS_START = 1.35f;
+// speed of the car the cameras follow along its path, in model units per second
+const float CAR_PATH_SPEED = 9.0f;
+
+// command line options
+struct Settings
+{
+    bool isHeadless = false;
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+    unsigned int framesCount = 600;    // frames rendered in headless and benchmark mode
+    std::string outputPath;            // headless mode: the last frame is saved there as PPM
+    bool isBenchmark = false;
+    std::string reportPath = "benchmark.json";
+    std::string cameraPath;            // benchmark camera keyframes, the built-in path if empty
+    std::string tracePath;             // Chrome trace of the profiler scopes written at exit
+    std::string frameTablePath;        // per-frame profiler table written at exit
+    bool isStatsOverlayVisible = false;
+    bool isJobBenchmark = false;       // runs the job system micro-benchmarks instead of the animation
+    bool isBezierBenchmark = false;    // runs the Bezier evaluation micro-benchmark and accuracy check
+    bool isObjBenchmark = false;       // compares the import time of the OBJ loader with ASSIMP's
+    bool isTessellationCheck = false;  // compares the hardware tessellated Bezier surface with the CPU one
+    bool isCpuTessellation = false;    // tessellates the Bezier surface on the CPU even if the GPU could
+    unsigned int carsCount = 10000;    // cars of the traffic, fewer if the streets are full
+    std::string worldPath = "Resources/world.txt";  // manifest of the streamed world chunks
+    unsigned int cpuBudget = 256;      // megabytes of chunk meshes kept in memory
+    unsigned int gpuBudget = 512;      // megabytes of chunk buffers and textures on the GPU
+    std::string resourcePackPath;      // archive the resources are read from, the loose files if empty
+    std::string packDirectory;         // packs the directory into packOutputPath instead of running
+    std::string packOutputPath;
+};
+
+bool parseArguments(int argc, char* argv[], Settings& settings);
+void forEachUsedVariant(const Shader& shader, const std::function<void(const ShaderVariant&)>& function);
+
+// controls, taken over by the simulation thread once per frame
+UserInput userInput;
 
 // timing
 float deltaTime = 0.0f;	// Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
 
 // mouse
-float lastX = SCR_WIDTH / 2.0f;
-float lastY = SCR_HEIGHT / 2.0f;
+float lastX = 0.0f;
+float lastY = 0.0f;
 bool firstMouse = true;
 
 // lighting
@@ -47,83 +122,247 @@ Shader* PhongShaderProgram;
 Shader* GouraudShaderProgram;
 Shader* FlatShaderProgram;
 Shader* shaderProgram;
-int isDay = 1;
+Shader* requestedShaderProgram;
+// evaluates the Bezier surface in tessellation shaders, NULL below OpenGL 4.0
+Shader* bezierPatchShader = NULL;
+
+// simulation, cameras and scene traversal, one frame ahead of rendering
+SimulationThread* simulationThread = NULL;
 
-// reflectors
-float deltaRefPos = 0.0f;
+// workers for loading and per-frame work, jobs that need OpenGL are run by the render loop
+JobSystem* jobSystem = NULL;
 
-// fog
-int isFogEnabled = 0;
+// deterministic benchmark run, NULL in interactive mode
+Benchmark* benchmark = NULL;
 
-int main()
+// chunks of the world loaded around the camera
+WorldStreamer* worldStreamer = NULL;
+
+// archive of the resources, NULL when they're read from the loose files
+ResourcePack* resourcePack = NULL;
+
+// GPU time of the render passes and the overlay showing it
+GpuTimer* gpuTimer = NULL;
+bool isStatsOverlayVisible = false;
+float averageFrameTime = 0.0f;
+
+int main(int argc, char* argv[])
 {
-    // instantiate the GLFW window
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+    // named before the job system's workers start recording, they'd otherwise come first in the trace
+    PROFILE_THREAD("Main");
 
-    // create a window object
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "City Animation 3D", glfwGetPrimaryMonitor(), NULL);
-    if (window == NULL)
+    Settings settings;
+    if (!parseArguments(argc, argv, settings))
+        return -1;
+
+    if (settings.isJobBenchmark)
+    {
+        JobSystemBenchmark::Run(std::cout);
+        return 0;
+    }
+    if (settings.isBezierBenchmark)
+        return BezierBenchmark::Run(std::cout) ? 0 : -1;
+    if (settings.isObjBenchmark)
+        return ObjBenchmark::Run(std::cout) ? 0 : -1;
+    if (!settings.packOutputPath.empty())
+        return ResourcePack::Build(settings.packDirectory, settings.packOutputPath, true, std::cout) ? 0 : -1;
+
+    screenWidth = settings.width;
+    screenHeight = settings.height;
+    lastX = screenWidth / 2.0f;
+    lastY = screenHeight / 2.0f;
+
+    // create the OpenGL context, either in a fullscreen window or offscreen without any display
+    RenderContext* context;
+    if (settings.isHeadless)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+#ifdef HEADLESS_RENDERING_SUPPORTED
+        HeadlessRenderContext* headlessContext = new HeadlessRenderContext(screenWidth, screenHeight, settings.framesCount);
+        if (!headlessContext->IsValid())
+        {
+            delete headlessContext;
+            return -1;
+        }
+        context = headlessContext;
+#else
+        std::cout << "Headless rendering is not supported on this platform" << std::endl;
         return -1;
+#endif
     }
-    glfwMakeContextCurrent(window);
-    glfwSetKeyCallback(window, key_callback);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    else
+    {
+        WindowRenderContext* windowContext = new WindowRenderContext(screenWidth, screenHeight, "City Animation 3D");
+        if (!windowContext->IsValid())
+        {
+            delete windowContext;
+            return -1;
+        }
+        context = windowContext;
+    }
+
+    GLFWwindow* window = context->GetWindow();
+    if (window != NULL)
+    {
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    // enable capturing the mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // enable capturing the mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     // initialize GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (!gladLoadGLLoader(context->GetProcAddressLoader()))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
+        delete context;
         return -1;
     }
 
+#ifdef HEADLESS_RENDERING_SUPPORTED
+    if (settings.isHeadless && !((HeadlessRenderContext*)context)->CreateFramebuffer())
+    {
+        delete context;
+        return -1;
+    }
+#endif
+
     // configure global opengl state
     glEnable(GL_DEPTH_TEST);
 
-    // build and compile shaders
+    if (settings.isTessellationCheck)
+    {
+        bool isPassed = BezierTessellationCheck::Run(std::cout);
+        delete context;
+        return isPassed ? 0 : -1;
+    }
+
+    jobSystem = new JobSystem();
+
+    // the compressed entries are decompressed up front on every worker, before any load reads them;
+    // what the archive lacks is still read from the file system
+    if (!settings.resourcePackPath.empty())
+    {
+        resourcePack = new ResourcePack();
+        if (resourcePack->Open(settings.resourcePackPath))
+        {
+            ResourcePack::Mount(resourcePack);
+            resourcePack->Decompress("", jobSystem);
+        }
+        else
+        {
+            delete resourcePack;
+            resourcePack = NULL;
+        }
+    }
+
+    // compile shaders in the background: with KHR_parallel_shader_compile if available, otherwise
+    // on worker threads owning their own contexts shared with the main one
+    bool isParallelCompileEnabled = Shader::enableParallelCompile(context->GetProcAddressLoader());
+    ShaderCompiler* shaderCompiler = NULL;
+    if (!isParallelCompileEnabled)
+    {
+        std::vector<std::function<void(bool)>> compilerContexts;
+        for (int i = 0; i < SHADER_COMPILER_THREADS; i++)
+        {
+            std::function<void(bool)> compilerContext = context->CreateSharedContext();
+            if (!compilerContext)
+                break;
+            compilerContexts.push_back(compilerContext);
+        }
+        if (!compilerContexts.empty())
+        {
+            shaderCompiler = new ShaderCompiler(compilerContexts);
+            Shader::setCompiler(shaderCompiler);
+        }
+    }
+
+    // build shaders, programs are compiled on first use or loaded from the binary cache
+    Shader::setBinaryCacheDirectory("ShaderCache");
     PhongShaderProgram = new Shader("Shaders/PhongShader.vs.glsl", "Shaders/PhongShader.fs.glsl");
     GouraudShaderProgram = new Shader("Shaders/GouraudShader.vs.glsl", "Shaders/GouraudShader.fs.glsl");
     FlatShaderProgram = new Shader("Shaders/flatShader.vs.glsl", "Shaders/flatShader.fs.glsl");
+    std::vector<Shader*> precompiledShaders = { PhongShaderProgram, GouraudShaderProgram, FlatShaderProgram };
 
-    shaderProgram = PhongShaderProgram;
-    Shader lightShaderProgram("Shaders/lightShader.vs.glsl", "Shaders/lightShader.fs.glsl");
+    // the Bezier surface is tessellated by the GPU when it can, the patch shares Phong's lighting
+    if (GLAD_GL_VERSION_4_0 && !settings.isCpuTessellation)
+    {
+        bezierPatchShader = new Shader("Shaders/BezierPatch.vs.glsl", "Shaders/PhongShader.fs.glsl",
+            "Shaders/BezierPatch.tcs.glsl", "Shaders/BezierPatch.tes.glsl");
+        precompiledShaders.push_back(bezierPatchShader);
+    }
 
-    // initialize cameras
-    glm::vec3 startCameraPosition = glm::vec3(0.0f, 2.0f, 6.0f);
-    glm::vec3 startCameraTarget = glm::vec3(0.0f, 0.0f, 3.0f);
+    // start compiling every variant the keys can switch to, the render loop picks them up once they are ready
+    if (isParallelCompileEnabled || shaderCompiler)
+    {
+        for (Shader* shader : precompiledShaders)
+            forEachUsedVariant(*shader, [shader](const ShaderVariant& variant) { shader->precompile(variant); });
+    }
+
+    shaderProgram = PhongShaderProgram;
+    requestedShaderProgram = PhongShaderProgram;
+    Shader* lightShaderProgram = new Shader("Shaders/lightShader.vs.glsl", "Shaders/lightShader.fs.glsl");
 
-    stationaryCamera = new Camera(startCameraPosition);
-    followingCamera = new Camera(startCameraPosition);
-    fppCamera = new Camera(startCameraPosition);
-    freeCamera = new Camera(startCameraPosition);
+    gpuTimer = new GpuTimer();
+    TextOverlay* statsOverlay = new TextOverlay();
+    isStatsOverlayVisible = settings.isStatsOverlayVisible;
 
-    activeCamera = freeCamera;
-    freeCameraActive = true;
+    if (settings.isBenchmark)
+    {
+        benchmark = new Benchmark(settings.framesCount, *gpuTimer);
+        if (!settings.cameraPath.empty() && !benchmark->LoadCameraPath(settings.cameraPath))
+            std::cout << "Using the built-in benchmark camera path" << std::endl;
+
+        // measured frames must not depend on compilation progress or on the display refresh rate; the
+        // Bezier pass would switch from the CPU mesh to the patch program once it's ready
+        for (Shader* shader : precompiledShaders)
+        {
+            forEachUsedVariant(*shader, [shader](const ShaderVariant& variant) { shader->precompile(variant); });
+            shader->waitForPrograms();
+        }
+        if (window != NULL)
+            glfwSwapInterval(0);
+    }
 
-    stationaryCamera->UpdateFront(glm::normalize(startCameraTarget - startCameraPosition));
+    // initial camera pose
+    glm::vec3 startCameraPosition = glm::vec3(0.0f, 2.0f, 6.0f);
+    glm::vec3 startCameraTarget = glm::vec3(0.0f, 0.0f, 3.0f);
 
     // load models
-    Model cityModel("Resources/City/city.obj");
-    Model carModel("Resources/Car/car.obj");
-    Model lanternModel("Resources/Lantern/Lantern.obj");
-    Model spotlightModel("Resources/Spotlight/spotlight.obj");
+    // load models in parallel, the main thread creates their OpenGL objects while it waits for them
+    Model* carModel = NULL;
+    Model* lanternModel = NULL;
+    Model* spotlightModel = NULL;
+    {
+        PROFILE_SCOPE("Load models");
+        JobCounter modelsLoaded;
+        jobSystem->Run([&carModel] { carModel = new Model("Resources/Car/car.obj", jobSystem); }, &modelsLoaded);
+        jobSystem->Run([&lanternModel] { lanternModel = new Model("Resources/Lantern/Lantern.obj", jobSystem); }, &modelsLoaded);
+        jobSystem->Run([&spotlightModel] { spotlightModel = new Model("Resources/Spotlight/spotlight.obj", jobSystem); }, &modelsLoaded);
+        jobSystem->Wait(modelsLoaded);
+    }
+    // the meshes dropped their vertices after the upload, what's left is mostly on the GPU
+    for (const Model* model : { carModel, lanternModel, spotlightModel })
+        model->PrintMemoryReport(std::cout);
+
+    // the world is streamed in while the animation runs; a benchmark waits for the chunks around its
+    // first camera position so the measured frames don't depend on loading progress
+    std::vector<WorldChunk> worldChunks;
+    WorldStreamer::LoadManifest(settings.worldPath, worldChunks);
+    StreamingBudget streamingBudget;
+    streamingBudget.cpuBytes = (size_t)settings.cpuBudget << 20;
+    streamingBudget.gpuBytes = (size_t)settings.gpuBudget << 20;
+    worldStreamer = new WorldStreamer(worldChunks, streamingBudget, *jobSystem);
+    if (benchmark != NULL)
+    {
+        worldStreamer->Update(startCameraPosition);
+        worldStreamer->Flush();
+        worldStreamer->Update(startCameraPosition);
+    }
 
     // initialize Bezier surface
-    BezierSurface bezierSurface = BezierSurface();
+    BezierSurface<> bezierSurface;
 
     float controlPoints[] = {
         0.0f, 0.5f, 1.0f, 0.5f,
@@ -134,19 +373,37 @@ int main()
 
     bezierSurface.SetBaseZValues(controlPoints);
 
+    // the grid is tessellated straight into the mapped buffers, every vertex is evaluated once
     const int accuracy = 10;
-    const int length = accuracy * accuracy * 6 * 8;
-    float* bezierVertices = new float[length];
-    bezierSurface.FillArrayWithValues(bezierVertices, length, accuracy);
+    const int bezierVerticesCount = BezierSurface<>::GetGridVertexCount(accuracy);
+    const int bezierIndicesCount = BezierSurface<>::GetGridIndexCount(accuracy);
 
-    unsigned int bezierVBO, bezierVAO;
+    unsigned int bezierVBO, bezierEBO, bezierVAO;
     glGenVertexArrays(1, &bezierVAO);
     glGenBuffers(1, &bezierVBO);
+    glGenBuffers(1, &bezierEBO);
 
     glBindVertexArray(bezierVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, bezierVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(bezierVertices), bezierVertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, bezierVerticesCount * BezierSurface<>::VERTEX_SIZE * sizeof(float), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bezierEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bezierIndicesCount * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+    float* bezierVertices = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bezierVerticesCount * BezierSurface<>::VERTEX_SIZE * sizeof(float),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    unsigned int* bezierIndices = (unsigned int*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, bezierIndicesCount * sizeof(unsigned int),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (bezierVertices != NULL && bezierIndices != NULL)
+        bezierSurface.FillGrid(bezierVertices, bezierIndices, accuracy);
+    else
+        std::cout << "ERROR::BEZIER::BUFFER_NOT_MAPPED" << std::endl;
+
+    // the contents are undefined if the buffers were lost while mapped (e.g. a mode switch)
+    bool isVerticesUnmapped = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    bool isIndicesUnmapped = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE;
+    if (!isVerticesUnmapped || !isIndicesUnmapped)
+        std::cout << "ERROR::BEZIER::BUFFER_CORRUPTED" << std::endl;
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -160,6 +417,61 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
+    // the 16 control points as a single patch for the tessellation shaders
+    std::vector<float> bezierPatch;
+    for (int i = 0; i < bezierSurface.GetControlCount(); i++)
+    {
+        for (int j = 0; j < bezierSurface.GetControlCount(); j++)
+        {
+            float x, y, z;
+            bezierSurface.GetControlPoint(i, j, x, y, z);
+            bezierPatch.insert(bezierPatch.end(), { x, y, z });
+        }
+    }
+
+    unsigned int bezierPatchVBO, bezierPatchVAO;
+    glGenVertexArrays(1, &bezierPatchVAO);
+    glGenBuffers(1, &bezierPatchVBO);
+
+    glBindVertexArray(bezierPatchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, bezierPatchVBO);
+    glBufferData(GL_ARRAY_BUFFER, bezierPatch.size() * sizeof(float), bezierPatch.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // rolling hills around the city, flat and just below its ground within the city block
+    float terrainSide = TERRAIN_PATCHES * TERRAIN_PATCH_SIZE;
+    glm::vec3 terrainOrigin = glm::vec3(-0.5f * terrainSide, -0.05f, -0.5f * terrainSide);
+    auto groundHeight = [](float x, float z) {
+        float distance = sqrt(x * x + z * z);
+        float rise = glm::clamp((distance - 12.0f) / 18.0f, 0.0f, 1.0f);
+        rise = rise * rise * (3.0f - 2.0f * rise);
+        return rise * (3.0f + 2.0f * sin(x * 0.15f) * cos(z * 0.11f) + 1.2f * sin(x * 0.07f + z * 0.09f));
+    };
+    Terrain* terrain = new Terrain(TERRAIN_PATCHES, TERRAIN_PATCH_SIZE, terrainOrigin, groundHeight);
+
+    // a lake filling the valleys east of the city, ripples spread from two drops circling over it
+    // and fade out within a few patches, the calm patches aren't tessellated again
+    float waterSide = WATER_PATCHES * WATER_PATCH_SIZE;
+    AnimatedSurface* water = new AnimatedSurface(WATER_PATCHES, WATER_PATCH_SIZE, glm::vec3(16.0f, 1.5f, -0.5f * waterSide),
+        [waterSide](float x, float z, float time) {
+            float wave = 0.0f;
+            for (int drop = 0; drop < 2; drop++)
+            {
+                float angle = 0.3f * time + glm::radians(180.0f * drop);
+                float dx = x - (16.0f + 0.5f * waterSide + 6.0f * cos(angle));
+                float dz = z - 6.0f * sin(angle);
+                float distance = sqrt(dx * dx + dz * dz);
+                float fade = glm::clamp(1.0f - distance / 7.0f, 0.0f, 1.0f);
+                wave += 0.25f * fade * fade * sin(2.5f * distance - 3.0f * time);
+            }
+            return wave;
+        }, 0.5f, WATER_BUDGET_MILLISECONDS);
+
     //// set up vertices
     float vertices[] = {
         // positions          // normals           // texture coords
@@ -221,11 +533,6 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    // configure shader
-    shaderProgram->use();
-    shaderProgram->setInt("material.texture_diffuse", 0);
-    shaderProgram->setInt("material.texture_specular", 1);
-
     // define initial light positions and directions
     glm::vec3 pointlightPosition = glm::vec3(-5.0f, 0.2f, 3.0f);
 
@@ -235,250 +542,616 @@ int main()
     glm::vec3 reflector1InitialPosition = startCameraTarget + glm::vec3(-0.4f, -0.94f, -2.2f);
     glm::vec3 reflector2InitialPosition = startCameraTarget + glm::vec3(0.4f, -0.94f, -2.2f);
 
-    glm::vec3 reflector1Position = reflector1InitialPosition;
-    glm::vec3 reflector2Position = reflector2InitialPosition;
+    SceneDescription scene;
+    scene.startCameraPosition = startCameraPosition;
+    scene.startCameraTarget = startCameraTarget;
+    scene.aspectRatio = (float)screenWidth / (float)screenHeight;
+
+    // streets over the hills, around the city and the lake; the cars drive on the terrain
+    TrafficLayout trafficLayout;
+    trafficLayout.carsCount = settings.carsCount;
+    trafficLayout.side = terrainSide - TRAFFIC_BLOCK_SIZE;
+    trafficLayout.blockSize = TRAFFIC_BLOCK_SIZE;
+    trafficLayout.carLength = CAR_LENGTH;
+    trafficLayout.carModel = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+    trafficLayout.height = [groundHeight, terrainOrigin](float x, float z) { return terrainOrigin.y + groundHeight(x, z); };
+    trafficLayout.isOpen = [waterSide](float x, float z) {
+        bool isInCity = x * x + z * z < 12.0f * 12.0f;
+        bool isInLake = x > 15.0f && x < 17.0f + waterSide && std::abs(z) < 0.5f * waterSide + 1.0f;
+        return !isInCity && !isInLake;
+    };
+    scene.traffic = Traffic(trafficLayout);
+    scene.trafficDrawDistance = TRAFFIC_DRAW_DISTANCE;
+
+    // the visible cars' instances are written every frame, the GPU reads the previous frames' meanwhile
+    StreamBuffer* carInstanceStream = new StreamBuffer(std::max(scene.traffic.GetCarsCount(), (size_t)1) * sizeof(CarInstance));
+    unsigned int streamedCarsCount = 0;
+
+    // placement of the models, the scene graph computes the static ones once
+    SceneGraph& graph = scene.graph;
+    glm::quat noRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    SceneNode lanternNode = graph.AddNode(SceneGraph::NO_PARENT, pointlightPosition - glm::vec3(0.0f, 0.2f, 0.0f), noRotation, glm::vec3(0.02f));
+    SceneNode spotlightNode = graph.AddNode(SceneGraph::NO_PARENT, spotlightPosition - glm::vec3(0.0f, 0.1f, 0.0f),
+        glm::angleAxis(glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.05f));
+    SceneNode bezierNode = graph.AddNode(SceneGraph::NO_PARENT, glm::vec3(0.0f), noRotation, glm::vec3(2.0f, 1.0f, 1.0f));
+
+    // the car drives a loop around the point the camera starts looking at, lying in its model's x-y
+    // plane; the points and lights attached to it follow without any further code
+    std::vector<glm::vec3> carWaypoints = {
+        glm::vec3(12.0f, 0.0f, 0.0f), glm::vec3(9.0f, 8.0f, 0.0f), glm::vec3(0.0f, 11.0f, 0.0f), glm::vec3(-8.0f, 9.0f, 0.0f),
+        glm::vec3(-13.0f, 0.0f, 0.0f), glm::vec3(-9.0f, -7.0f, 0.0f), glm::vec3(0.0f, -9.0f, 0.0f), glm::vec3(10.0f, -8.0f, 0.0f)
+    };
+    scene.carPath = SplinePath::FromCatmullRom(carWaypoints, true);
+    scene.carSpeed = CAR_PATH_SPEED;
+    scene.carPivotNode = graph.AddNode(SceneGraph::NO_PARENT, startCameraTarget,
+        glm::angleAxis(glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(0.1f));
+    scene.carSpinNode = graph.AddNode(scene.carPivotNode);
+    scene.carNode = graph.AddNode(scene.carSpinNode);
+    scene.carEyeNode = graph.AddNode(scene.carNode, glm::vec3(0.0f, -1.0f, 1.0f));
+    scene.carFrontNode = graph.AddNode(scene.carNode, glm::vec3(0.0f, -1.0f, 0.0f));
+    scene.carBackNode = graph.AddNode(scene.carNode, glm::vec3(0.0f, 1.0f, 0.0f));
+    SceneNode reflector1Node = graph.AddNode(scene.carNode, reflector1InitialPosition);
+    SceneNode reflector2Node = graph.AddNode(scene.carNode, reflector2InitialPosition);
+    graph.Update();
+
+    // the surface lies within the convex hull of its control points
+    std::vector<glm::vec3> bezierPositions;
+    for (int i = 0; i < bezierSurface.GetControlCount(); i++)
+    {
+        for (int j = 0; j < bezierSurface.GetControlCount(); j++)
+        {
+            glm::vec3 point;
+            bezierSurface.GetControlPoint(i, j, point.x, point.y, point.z);
+            bezierPositions.push_back(point);
+        }
+    }
+    BoundingSphere bezierBounds = BoundingSphere::FromPoints(bezierPositions);
+
+    // the drawn objects with their model space bounds for culling; the static ones keep the
+    // transform their node has now, the car follows its node
+    EntityStore& entities = scene.entities;
+    entities.Create(Transform{ glm::mat4(1.0f) }, Renderable{ CITY_OBJECT, worldStreamer->GetBounds() });
+    entities.Create(Transform{ graph.GetWorldMatrix(scene.carNode) }, Renderable{ CAR_OBJECT, carModel->Bounds }, NodeLink{ scene.carNode });
+    entities.Create(Transform{ graph.GetWorldMatrix(lanternNode) }, Renderable{ LANTERN_OBJECT, lanternModel->Bounds });
+    entities.Create(Transform{ graph.GetWorldMatrix(spotlightNode) }, Renderable{ SPOTLIGHT_OBJECT, spotlightModel->Bounds });
+    entities.Create(Transform{ graph.GetWorldMatrix(bezierNode) }, Renderable{ BEZIER_SURFACE_OBJECT, bezierBounds });
+    entities.Create(Transform{ glm::mat4(1.0f) }, Renderable{ TERRAIN_OBJECT, terrain->GetBounds() });
+    entities.Create(Transform{ glm::mat4(1.0f) }, Renderable{ WATER_OBJECT, water->GetBounds() });
+
+    // the lights, each marked by a small cube; the reflectors ride on the car
+    PointLight pointlight = { pointlightPosition, glm::vec3(0.05f), glm::vec3(0.8f), glm::vec3(1.0f), 1.0f, 0.09f, 0.032f };
+    entities.Create(Transform{ glm::translate(glm::mat4(1.0f), pointlightPosition) }, pointlight, LightTag{ 0.025f });
 
-    glm::vec3 reflector1Target = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 reflector2Target = glm::vec3(0.0f, 0.0f, 1.0f);
+    SpotLight spotlight = { spotlightPosition, spotlightTarget, glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f), 1.0f, 0.09f, 0.032f,
+        glm::cos(glm::radians(12.5f)), glm::cos(glm::radians(15.0f)) };
+    entities.Create(Transform{ glm::translate(glm::mat4(1.0f), spotlightPosition) }, spotlight, LightTag{ 0.025f });
+
+    SpotLight reflector = spotlight;
+    reflector.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+    entities.Create(Transform{ graph.GetWorldMatrix(reflector1Node) }, reflector, LightTag{ 0.008f }, NodeLink{ reflector1Node }, CarReflector{});
+    entities.Create(Transform{ graph.GetWorldMatrix(reflector2Node) }, reflector, LightTag{ 0.008f }, NodeLink{ reflector2Node }, CarReflector{});
+
+    scene.lightTagBounds.radius = glm::length(glm::vec3(0.5f));
+
+    Shader* shaders[] = { FlatShaderProgram, GouraudShaderProgram, PhongShaderProgram };
+    simulationThread = new SimulationThread(scene, [context]() { return context->GetTime(); }, benchmark, *jobSystem);
 
     // render loop
-    while (!glfwWindowShouldClose(window))
+    while (!context->ShouldClose() && (benchmark == NULL || !benchmark->IsFinished()))
     {
-        // calculate frame time
-        float currentFrame = static_cast<float>(glfwGetTime());
+        PROFILE_FRAME();
+        renderStats.Reset();
+        gpuTimer->BeginFrame();
+        if (benchmark != NULL)
+            benchmark->BeginFrame();
+
+        // measure frame time for the overlay, the simulation thread keeps its own clock
+        float currentFrame = static_cast<float>(context->GetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        averageFrameTime += (deltaTime - averageFrameTime) * 0.05f;
 
         // input
-        processInput(window);
+        if (window != NULL)
+            processInput(window);
+
+        // hand the controls over and take the frame the simulation thread built meanwhile
+        simulationThread->PostInput(userInput);
+        userInput.mouseOffsetX = 0.0f;
+        userInput.mouseOffsetY = 0.0f;
+        userInput.scrollOffset = 0.0f;
+
+        jobSystem->ExecuteMainThreadJobs();
+
+        const FramePacket& packet = simulationThread->WaitForPacket();
+
+        // every frame, the world behind the camera is evicted even while none of it is visible
+        worldStreamer->Update(packet.viewPosition);
+
+        // the terrain and the water are re-tessellated every frame, whether or not they're visible, so they
+        // are current when they come into view; their uploads stay out of the draw passes' GPU times.
+        // The patches near the camera are finer, the farther ones coarser; the waves move with the
+        // simulation's time, so the benchmark sees the same ones every run
+        terrain->Update(packet.viewPosition, *jobSystem);
+        water->Update((float)packet.time, *jobSystem);
 
         // clear color and depth buffers
-        if (isDay)
+        if (packet.isDay)
             glClearColor(0.529f, 0.808f, 0.922f, 1.0f);
         else
             glClearColor(0.128f, 0.171f, 0.700f, 1.0f);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // activate main shader and set uniforms
+        // select the shader variant specialized for the current modes and set uniforms
+        ShaderVariant variant;
+        variant.isDay = packet.isDay;
+        variant.fogEquation = packet.isFogEnabled ? FOG_EXP2 : FOG_DISABLED;
+        // the entities may hold more lights than a variant can, the first ones in the packet are lit
+        variant.pointLightsCount = std::min((int)packet.pointLights.size(), MAX_VARIANT_LIGHTS);
+        variant.spotLightsCount = std::min((int)packet.spotLights.size(), MAX_VARIANT_LIGHTS);
+        static bool isLightLimitReported = false;
+        if (!isLightLimitReported && (variant.pointLightsCount < (int)packet.pointLights.size() || variant.spotLightsCount < (int)packet.spotLights.size()))
+        {
+            std::cout << "ERROR::LIGHTS::TOO_MANY_LIGHTS: only " << MAX_VARIANT_LIGHTS << " point and spot lights of each kind are lit" << std::endl;
+            isLightLimitReported = true;
+        }
+
+        // switch the shading mode once the requested program is compiled, until then keep the current one
+        requestedShaderProgram = shaders[packet.shading];
+        if (requestedShaderProgram != shaderProgram && requestedShaderProgram->setVariant(variant))
+            shaderProgram = requestedShaderProgram;
+
+        shaderProgram->setVariant(variant);
         shaderProgram->use();
+        setLightingUniforms(*shaderProgram, packet);
+        // the passes that switch variants go back to this one, an older one while the requested one compiles
+        const ShaderVariant sharedVariant = shaderProgram->getVariant();
+
+        // draw the visible objects in the order the simulation thread sorted them
+        for (const DrawItem& item : packet.drawItems)
+        {
+            switch (item.object)
+            {
+            case CITY_OBJECT:
+            {
+                PROFILE_SCOPE("Draw city");
+                gpuTimer->BeginPass("City");
+                worldStreamer->Draw(*shaderProgram, Frustum(packet.projection * packet.view));
+                gpuTimer->EndPass();
+                break;
+            }
+            case CAR_OBJECT:
+            {
+                PROFILE_SCOPE("Draw car");
+                gpuTimer->BeginPass("Car");
+                shaderProgram->setMat4("model", item.model);
+                carModel->Draw(*shaderProgram);
+                gpuTimer->EndPass();
+                break;
+            }
+            case LANTERN_OBJECT:
+            {
+                PROFILE_SCOPE("Draw lantern");
+                gpuTimer->BeginPass("Lantern");
+                shaderProgram->setMat4("model", item.model);
+                lanternModel->Draw(*shaderProgram);
+                gpuTimer->EndPass();
+                break;
+            }
+            case SPOTLIGHT_OBJECT:
+            {
+                PROFILE_SCOPE("Draw spotlight");
+                gpuTimer->BeginPass("Spotlight");
+                shaderProgram->setMat4("model", item.model);
+                spotlightModel->Draw(*shaderProgram);
+                gpuTimer->EndPass();
+                break;
+            }
+            case BEZIER_SURFACE_OBJECT:
+            {
+                // render Bezier surface, it has no textures so it uses the untextured variant
+                ShaderVariant untexturedVariant = variant;
+                untexturedVariant.isTextured = false;
+
+                // with Phong shading the GPU tessellates the patch once its program is ready, the other
+                // modes light the vertices differently and draw the mesh tessellated on the CPU
+                bool isTessellated = bezierPatchShader != NULL && packet.shading == PHONG_SHADING && bezierPatchShader->setVariant(untexturedVariant);
+                Shader* surfaceShader = isTessellated ? bezierPatchShader : shaderProgram;
+                if (!isTessellated && !surfaceShader->setVariant(untexturedVariant))
+                    break;
+                surfaceShader->use();
+                setLightingUniforms(*surfaceShader, packet);
+                surfaceShader->setVec3("material.diffuseColor", 0.6f, 0.6f, 0.6f);
+                surfaceShader->setVec3("material.specularColor", 0.3f, 0.3f, 0.3f);
+                surfaceShader->setMat4("model", item.model);
+
+                gpuTimer->BeginPass("Bezier surface");
+                if (isTessellated)
+                {
+                    surfaceShader->setVec2("viewportSize", (float)screenWidth, (float)screenHeight);
+                    surfaceShader->setFloat("pixelsPerSegment", BEZIER_PIXELS_PER_SEGMENT);
+                    surfaceShader->setFloat("fixedTessLevel", 0.0f);
+
+                    glBindVertexArray(bezierPatchVAO);
+                    glPatchParameteri(GL_PATCH_VERTICES, 16);
+                    glDrawArrays(GL_PATCHES, 0, 16);
+                    // the triangles are generated on the GPU, the statistics don't know how many
+                    renderStats.vertexArrayBinds++;
+                    renderStats.AddDraw(0);
+                }
+                else
+                {
+                    glBindVertexArray(bezierVAO);
+                    glDrawElements(GL_TRIANGLES, bezierIndicesCount, GL_UNSIGNED_INT, 0);
+                    renderStats.vertexArrayBinds++;
+                    renderStats.AddDraw(bezierIndicesCount / 3);
+                }
+                gpuTimer->EndPass();
+
+                shaderProgram->setVariant(sharedVariant);
+                shaderProgram->use();
+                break;
+            }
+            case TERRAIN_OBJECT:
+            {
+                PROFILE_SCOPE("Draw terrain");
+                // the textured program would sample whatever texture is bound instead of the diffuse
+                // color, the terrain waits until the untextured one is compiled
+                ShaderVariant untexturedVariant = variant;
+                untexturedVariant.isTextured = false;
+                if (!shaderProgram->setVariant(untexturedVariant))
+                    break;
+                shaderProgram->use();
+                setLightingUniforms(*shaderProgram, packet);
+                shaderProgram->setVec3("material.diffuseColor", 0.35f, 0.55f, 0.25f);
+                shaderProgram->setVec3("material.specularColor", 0.05f, 0.05f, 0.05f);
+                shaderProgram->setMat4("model", item.model);
+
+                gpuTimer->BeginPass("Terrain");
+                terrain->Draw(Frustum(packet.projection * packet.view));
+                gpuTimer->EndPass();
+
+                shaderProgram->setVariant(sharedVariant);
+                shaderProgram->use();
+                break;
+            }
+            case WATER_OBJECT:
+            {
+                PROFILE_SCOPE("Draw water");
+                // like the terrain, the water waits for the untextured program
+                ShaderVariant untexturedVariant = variant;
+                untexturedVariant.isTextured = false;
+                if (!shaderProgram->setVariant(untexturedVariant))
+                    break;
+                shaderProgram->use();
+                setLightingUniforms(*shaderProgram, packet);
+                shaderProgram->setVec3("material.diffuseColor", 0.15f, 0.35f, 0.6f);
+                shaderProgram->setVec3("material.specularColor", 0.6f, 0.6f, 0.6f);
+                shaderProgram->setMat4("model", item.model);
+
+                gpuTimer->BeginPass("Water");
+                water->Draw(Frustum(packet.projection * packet.view));
+                gpuTimer->EndPass();
+
+                shaderProgram->setVariant(sharedVariant);
+                shaderProgram->use();
+                break;
+            }
+            case TRAFFIC_OBJECT:
+            {
+                PROFILE_SCOPE("Draw traffic");
+                // every car in a single draw per mesh, with the model matrix and lamps of the instance;
+                // the cars wait until the instanced program is ready
+                ShaderVariant instancedVariant = variant;
+                instancedVariant.isTextured = true;
+                instancedVariant.isInstanced = true;
+                if (!shaderProgram->setVariant(instancedVariant))
+                    break;
+                shaderProgram->use();
+                setLightingUniforms(*shaderProgram, packet);
+                shaderProgram->setVec3("lampAxis", CAR_LAMP_AXIS);
+                shaderProgram->setVec2("lampRange", CAR_HEADLIGHTS_START, CAR_BRAKE_LIGHTS_START);
+
+                // while the GPU still reads the next region, the cars of the last frame are drawn again
+                void* region = carInstanceStream->BeginWrite();
+                if (region != NULL)
+                {
+                    streamedCarsCount = (unsigned int)packet.carInstances.size();
+                    memcpy(region, packet.carInstances.data(), streamedCarsCount * sizeof(CarInstance));
+                    carInstanceStream->EndWrite(streamedCarsCount * sizeof(CarInstance));
+                }
+
+                gpuTimer->BeginPass("Traffic");
+                carModel->DrawInstanced(*shaderProgram, streamedCarsCount, carInstanceStream->GetBuffer(), carInstanceStream->GetOffset(), sizeof(CarInstance));
+                gpuTimer->EndPass();
+                carInstanceStream->Fence();
+
+                shaderProgram->setVariant(sharedVariant);
+                shaderProgram->use();
+                break;
+            }
+            case LIGHT_TAGS_OBJECT:
+            {
+                // activate second shader for rendering tag cubes
+                gpuTimer->BeginPass("Light tags");
+                lightShaderProgram->use();
+                lightShaderProgram->setMat4("projection", packet.projection);
+                lightShaderProgram->setMat4("view", packet.view);
+
+                glBindVertexArray(lightVAO);
+                renderStats.vertexArrayBinds++;
+                for (const glm::mat4& tagModel : packet.lightTagModels)
+                {
+                    lightShaderProgram->setMat4("model", tagModel);
+                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                    renderStats.AddDraw(12);
+                }
+                gpuTimer->EndPass();
+                break;
+            }
+            }
+        }
+
+
+        // draw the frame statistics over the scene
+        if (isStatsOverlayVisible)
+        {
+            gpuTimer->BeginPass("Overlay");
+            drawStatsOverlay(*statsOverlay, packet);
+            gpuTimer->EndPass();
+        }
 
-        shaderProgram->setInt("isDay", isDay);
-        shaderProgram->setVec3("viewPos", activeCamera->Position);
-        shaderProgram->setFloat("material.shininess", 32.0f);
-
-        // directional light (sun)
-        shaderProgram->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        shaderProgram->setVec3("dirLight.ambient", 0.4f, 0.4f, 0.4f);
-        shaderProgram->setVec3("dirLight.diffuse", 0.8f, 0.8f, 0.8f);
-        shaderProgram->setVec3("dirLight.specular", 0.8f, 0.8f, 0.8f);
-
-        // pointlight
-        shaderProgram->setVec3("pointLight.position", pointlightPosition);
-        shaderProgram->setVec3("pointLight.ambient", 0.05f, 0.05f, 0.05f);
-        shaderProgram->setVec3("pointLight.diffuse", 0.8f, 0.8f, 0.8f);
-        shaderProgram->setVec3("pointLight.specular", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setFloat("pointLight.constant", 1.0f);
-        shaderProgram->setFloat("pointLight.linear", 0.09f);
-        shaderProgram->setFloat("pointLight.quadratic", 0.032f);
-
-        // spotlight
-        shaderProgram->setVec3("spotLights[0].position", spotlightPosition);
-        shaderProgram->setVec3("spotLights[0].direction", spotlightTarget);
-        shaderProgram->setVec3("spotLights[0].ambient", 0.0f, 0.0f, 0.0f);
-        shaderProgram->setVec3("spotLights[0].diffuse", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setVec3("spotLights[0].specular", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setFloat("spotLights[0].constant", 1.0f);
-        shaderProgram->setFloat("spotLights[0].linear", 0.09f);
-        shaderProgram->setFloat("spotLights[0].quadratic", 0.032f);
-        shaderProgram->setFloat("spotLights[0].cutOff", glm::cos(glm::radians(12.5f)));
-        shaderProgram->setFloat("spotLights[0].outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        // car reflector 1
-        shaderProgram->setVec3("spotLights[1].position", reflector1Position);
-        shaderProgram->setVec3("spotLights[1].direction", reflector1Target);
-        shaderProgram->setVec3("spotLights[1].ambient", 0.0f, 0.0f, 0.0f);
-        shaderProgram->setVec3("spotLights[1].diffuse", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setVec3("spotLights[1].specular", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setFloat("spotLights[1].constant", 1.0f);
-        shaderProgram->setFloat("spotLights[1].linear", 0.09f);
-        shaderProgram->setFloat("spotLights[1].quadratic", 0.032f);
-        shaderProgram->setFloat("spotLights[1].cutOff", glm::cos(glm::radians(12.5f)));
-        shaderProgram->setFloat("spotLights[1].outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        // car reflector 2
-        shaderProgram->setVec3("spotLights[2].position", reflector2Position);
-        shaderProgram->setVec3("spotLights[2].direction", reflector2Target);
-        shaderProgram->setVec3("spotLights[2].ambient", 0.0f, 0.0f, 0.0f);
-        shaderProgram->setVec3("spotLights[2].diffuse", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setVec3("spotLights[2].specular", 1.0f, 1.0f, 1.0f);
-        shaderProgram->setFloat("spotLights[2].constant", 1.0f);
-        shaderProgram->setFloat("spotLights[2].linear", 0.09f);
-        shaderProgram->setFloat("spotLights[2].quadratic", 0.032f);
-        shaderProgram->setFloat("spotLights[2].cutOff", glm::cos(glm::radians(12.5f)));
-        shaderProgram->setFloat("spotLights[2].outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        // fog parameters
-        shaderProgram->setVec3("fogParams.color", 0.75f, 0.75f, 0.75f);
-        shaderProgram->setFloat("fogParams.linearStart", 50.0f);
-        shaderProgram->setFloat("fogParams.linearEnd", 100.0f);
-        shaderProgram->setFloat("fogParams.density", 0.25f);
-        shaderProgram->setInt("fogParams.equation", 2);
-        shaderProgram->setInt("fogParams.isEnabled", isFogEnabled);
-
-        // create projection matrix
-        glm::mat4 projection = glm::perspective(glm::radians(activeCamera->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        shaderProgram->setMat4("projection", projection);
-
-        // create view matrix
-        glm::mat4 view = activeCamera->GetViewMatrix();
-        shaderProgram->setMat4("view", view);
-
-
-        // render the city model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -5.0f));
-        model = glm::scale(model, glm::vec3(0.001f, 0.001f, 0.001f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        shaderProgram->setMat4("model", model);
-        cityModel.Draw(*shaderProgram);
-
-
-        // render the car model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, startCameraTarget);
-        model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::translate(model, glm::vec3(cos(glfwGetTime() / 20.0f) * 10.0f, sin(glfwGetTime() / 20.0f) * 10.0f, 0.0f));
-
-        shaderProgram->setMat4("model", model);
-        carModel.Draw(*shaderProgram);
-
-        glm::vec3 carPosition = model * glm::vec4(0.0f, -1.0f, 1.0f, 1.0f);
-        glm::vec3 carFront = model * glm::vec4(0.0f, -1.0f, 0.0f, 1.0f);
-        glm::vec3 carBack = model * glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
-
-        reflector1Position = model * glm::vec4(reflector1InitialPosition, 1.0);
-        reflector2Position = model * glm::vec4(reflector2InitialPosition, 1.0);
-
-        glm::mat4 rotMatrix = glm::rotate(glm::mat4(1.0f), deltaRefPos, glm::vec3(0.0f, 1.0f, 0.0f));
-        reflector1Target = rotMatrix * glm::vec4(carFront - carBack, 1.0f) + glm::vec4(0.0f, -0.05f, 0.0f, 1.0f);
-        reflector2Target = rotMatrix * glm::vec4(carFront - carBack, 1.0f) + glm::vec4(0.0f, -0.05f, 0.0f, 1.0f);
-
-
-        // update following camera
-        followingCamera->UpdateFront(glm::normalize(carPosition - startCameraPosition));
-
-        // update first person perspective camera
-        fppCamera->UpdatePositionAndFront(carPosition, carFront - carBack);
-
-
-        // render the lantern model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointlightPosition - glm::vec3(0.0f, 0.2f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.02f, 0.02f, 0.02f));
-
-        shaderProgram->setMat4("model", model);
-        lanternModel.Draw(*shaderProgram);
-
-
-        // render the spotlight model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, spotlightPosition - glm::vec3(0.0f, 0.1f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-
-        shaderProgram->setMat4("model", model);
-        spotlightModel.Draw(*shaderProgram);
 
+        // check and call events and swap the buffers
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            context->SwapBuffers();
+        }
+        context->PollEvents();
+
+        if (benchmark != NULL)
+            benchmark->EndFrame(packet.trafficMilliseconds);
+    }
 
-        // render Bezier surface
-        model = glm::mat4(1.0f);
-        //model = glm::translate(model, glm::vec3(0.0f, 0.1f, 0.0f));
-        model = glm::scale(model, glm::vec3(2.0f, 1.0f, 1.0f));
-        shaderProgram->setMat4("model", model);
+    // the simulation thread reads the benchmark script, stop it first
+    delete simulationThread;
+    // waits for its loads, which need the workers and the context
+    delete worldStreamer;
+    delete jobSystem;
+    ResourcePack::Mount(NULL);
+    delete resourcePack;
 
-        glBindVertexArray(bezierVAO);
-        glDrawArrays(GL_TRIANGLES, 0, accuracy * accuracy * 6);
+    if (benchmark != NULL)
+    {
+        benchmark->WriteReport(settings.reportPath);
+        delete benchmark;
+    }
 
+    delete statsOverlay;
+    delete gpuTimer;
 
-        // activate second shader for rendering tag cubes
-        lightShaderProgram.use();
-        lightShaderProgram.setMat4("projection", projection);
-        lightShaderProgram.setMat4("view", view);
+#ifdef HEADLESS_RENDERING_SUPPORTED
+    if (settings.isHeadless && !settings.outputPath.empty())
+        ((HeadlessRenderContext*)context)->SaveFrame(settings.outputPath);
+#endif
 
+    // stop the compiler threads before deleting the programs they might still be building
+    Shader::setCompiler(NULL);
+    delete shaderCompiler;
 
-        // create model matrix for pointlight tag cube
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointlightPosition);
-        model = glm::scale(model, glm::vec3(0.025f));
-        lightShaderProgram.setMat4("model", model);
+    // the compiler threads are gone, so every profiler buffer can be read
+    if (!settings.tracePath.empty())
+        Profiler::WriteChromeTrace(settings.tracePath);
+    if (!settings.frameTablePath.empty())
+        Profiler::WriteFrameTable(settings.frameTablePath);
 
-        // render pointlight tag cube
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    delete PhongShaderProgram;
+    delete GouraudShaderProgram;
+    delete FlatShaderProgram;
+    delete lightShaderProgram;
+    delete bezierPatchShader;
 
+    delete carModel;
+    delete lanternModel;
+    delete spotlightModel;
+    delete terrain;
+    delete water;
+    delete carInstanceStream;
 
-        // create model matrix for spotlight tag cube
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, spotlightPosition);
-        model = glm::scale(model, glm::vec3(0.025f));
-        lightShaderProgram.setMat4("model", model);
+    // delete OpenGL's resources
+    glDeleteVertexArrays(1, &bezierVAO);
+    glDeleteBuffers(1, &bezierVBO);
+    glDeleteBuffers(1, &bezierEBO);
+    glDeleteVertexArrays(1, &bezierPatchVAO);
+    glDeleteBuffers(1, &bezierPatchVBO);
 
-        // render spotlight tag cube
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    glDeleteVertexArrays(1, &lightVAO);
+    glDeleteBuffers(1, &VBO);
 
+    // release the context together with the window system's resources
+    delete context;
+    return 0;
+}
 
-        // create model matrix for reflector 1 tag cube
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, reflector1Position);
-        model = glm::scale(model, glm::vec3(0.008f));
-        lightShaderProgram.setMat4("model", model);
+bool parseArguments(int argc, char* argv[], Settings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--headless")
+            settings.isHeadless = true;
+        else if (argument == "--width" && hasValue)
+            settings.width = std::stoul(argv[++i]);
+        else if (argument == "--height" && hasValue)
+            settings.height = std::stoul(argv[++i]);
+        else if (argument == "--frames" && hasValue)
+            settings.framesCount = std::stoul(argv[++i]);
+        else if (argument == "--output" && hasValue)
+            settings.outputPath = argv[++i];
+        else if (argument == "--benchmark")
+            settings.isBenchmark = true;
+        else if (argument == "--report" && hasValue)
+            settings.reportPath = argv[++i];
+        else if (argument == "--camera-path" && hasValue)
+            settings.cameraPath = argv[++i];
+        else if (argument == "--profile" && hasValue)
+            settings.tracePath = argv[++i];
+        else if (argument == "--profile-table" && hasValue)
+            settings.frameTablePath = argv[++i];
+        else if (argument == "--stats-overlay")
+            settings.isStatsOverlayVisible = true;
+        else if (argument == "--job-benchmark")
+            settings.isJobBenchmark = true;
+        else if (argument == "--bezier-benchmark")
+            settings.isBezierBenchmark = true;
+        else if (argument == "--obj-benchmark")
+            settings.isObjBenchmark = true;
+        else if (argument == "--tessellation-check")
+            settings.isTessellationCheck = true;
+        else if (argument == "--cpu-tessellation")
+            settings.isCpuTessellation = true;
+        else if (argument == "--cars" && hasValue)
+            settings.carsCount = std::stoul(argv[++i]);
+        else if (argument == "--world" && hasValue)
+            settings.worldPath = argv[++i];
+        else if (argument == "--cpu-budget" && hasValue)
+            settings.cpuBudget = std::stoul(argv[++i]);
+        else if (argument == "--gpu-budget" && hasValue)
+            settings.gpuBudget = std::stoul(argv[++i]);
+        else if (argument == "--resource-pack" && hasValue)
+            settings.resourcePackPath = argv[++i];
+        else if (argument == "--pack" && i + 2 < argc)
+        {
+            settings.packDirectory = argv[++i];
+            settings.packOutputPath = argv[++i];
+        }
+        else
+        {
+            std::cout << "Unknown argument: " << argument << std::endl;
+            std::cout << "Usage: [--headless] [--width W] [--height H] [--frames N] [--output frame.ppm]"
+                << " [--benchmark] [--report benchmark.json|.csv] [--camera-path keyframes.txt]"
+                << " [--profile trace.json] [--profile-table frames.txt] [--stats-overlay] [--job-benchmark] [--bezier-benchmark] [--obj-benchmark]"
+                << " [--tessellation-check] [--cpu-tessellation] [--cars N]"
+                << " [--world world.txt] [--cpu-budget MB] [--gpu-budget MB] [--resource-pack resources.pack]"
+                << " [--pack Resources resources.pack]" << std::endl;
+            return false;
+        }
+    }
 
-        // render reflector 1 tag cube
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    if (settings.width == 0 || settings.height == 0)
+    {
+        std::cout << "Invalid resolution: " << settings.width << "x" << settings.height << std::endl;
+        return false;
+    }
+    return true;
+}
 
+// every variant the keys can switch the shader to; only the textured car model is drawn instanced,
+// the Bezier patch only untextured
+void forEachUsedVariant(const Shader& shader, const std::function<void(const ShaderVariant&)>& function)
+{
+    for (int variantIndex = 0; variantIndex < 16; variantIndex++)
+    {
+        ShaderVariant variant;
+        variant.isDay = (variantIndex & 1) == 0;
+        variant.fogEquation = (variantIndex & 2) ? FOG_EXP2 : FOG_DISABLED;
+        variant.isTextured = (variantIndex & 4) == 0;
+        variant.isInstanced = (variantIndex & 8) != 0;
+        if (variant.isInstanced && !variant.isTextured)
+            continue;
+        if (&shader == bezierPatchShader && (variant.isInstanced || variant.isTextured))
+            continue;
+        function(variant);
+    }
+}
 
-        // create model matrix for reflector 2 tag cube
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, reflector2Position);
-        model = glm::scale(model, glm::vec3(0.008f));
-        lightShaderProgram.setMat4("model", model);
+void setLightingUniforms(Shader& shader, const FramePacket& packet)
+{
+    PROFILE_SCOPE("setLightingUniforms");
 
-        // render reflector 2 tag cube
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    shader.setVec3("viewPos", packet.viewPosition);
+    shader.setInt("material.texture_diffuse", 0);
+    shader.setInt("material.texture_specular", 1);
+    shader.setFloat("material.shininess", 32.0f);
 
+    // directional light (sun)
+    shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+    shader.setVec3("dirLight.ambient", 0.4f, 0.4f, 0.4f);
+    shader.setVec3("dirLight.diffuse", 0.8f, 0.8f, 0.8f);
+    shader.setVec3("dirLight.specular", 0.8f, 0.8f, 0.8f);
 
-        // check and call events and swap the buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // point and spot lights in the packet's order, the variant declares as many of each
+    for (size_t i = 0; i < std::min(packet.pointLights.size(), (size_t)MAX_VARIANT_LIGHTS); i++)
+    {
+        const PointLight& light = packet.pointLights[i];
+        std::string name = "pointLights[" + std::to_string(i) + "].";
+        shader.setVec3(name + "position", light.position);
+        shader.setVec3(name + "ambient", light.ambient);
+        shader.setVec3(name + "diffuse", light.diffuse);
+        shader.setVec3(name + "specular", light.specular);
+        shader.setFloat(name + "constant", light.constant);
+        shader.setFloat(name + "linear", light.linear);
+        shader.setFloat(name + "quadratic", light.quadratic);
+    }
+    for (size_t i = 0; i < std::min(packet.spotLights.size(), (size_t)MAX_VARIANT_LIGHTS); i++)
+    {
+        const SpotLight& light = packet.spotLights[i];
+        std::string name = "spotLights[" + std::to_string(i) + "].";
+        shader.setVec3(name + "position", light.position);
+        shader.setVec3(name + "direction", light.direction);
+        shader.setVec3(name + "ambient", light.ambient);
+        shader.setVec3(name + "diffuse", light.diffuse);
+        shader.setVec3(name + "specular", light.specular);
+        shader.setFloat(name + "constant", light.constant);
+        shader.setFloat(name + "linear", light.linear);
+        shader.setFloat(name + "quadratic", light.quadratic);
+        shader.setFloat(name + "cutOff", light.cutOff);
+        shader.setFloat(name + "outerCutOff", light.outerCutOff);
     }
 
-    delete []bezierVertices;
+    // fog parameters, the equation itself is compiled into the variant
+    shader.setVec3("fogParams.color", 0.75f, 0.75f, 0.75f);
+    shader.setFloat("fogParams.linearStart", 50.0f);
+    shader.setFloat("fogParams.linearEnd", 100.0f);
+    shader.setFloat("fogParams.density", 0.25f);
 
-    delete PhongShaderProgram;
-    delete GouraudShaderProgram;
-    delete FlatShaderProgram;
+    shader.setMat4("projection", packet.projection);
+    shader.setMat4("view", packet.view);
+}
 
-    delete stationaryCamera;
-    delete followingCamera;
-    delete fppCamera;
-    delete freeCamera;
+void drawStatsOverlay(TextOverlay& overlay, const FramePacket& packet)
+{
+    std::stringstream text;
+    text << std::fixed << std::setprecision(2);
+    text << "CPU " << averageFrameTime * 1000.0f << " MS  " << std::setprecision(0) << 1.0f / std::max(averageFrameTime, 0.0001f) << " FPS\n";
+    text << std::setprecision(2);
 
-    // delete OpenGL's resources
-    glDeleteVertexArrays(1, &bezierVAO);
-    glDeleteBuffers(1, &bezierVBO);
+    // GPU times are a few frames old, the queries are read only once they are surely done
+    if (gpuTimer->HasResults())
+    {
+        const GpuFrameTimes& gpuTimes = gpuTimer->GetResults();
+        text << "GPU " << gpuTimes.totalMilliseconds << " MS\n";
+        for (const GpuPassTime& pass : gpuTimes.passes)
+            text << "  " << std::left << std::setw(16) << pass.name << std::right << std::setw(7) << pass.milliseconds << "\n";
+    }
+    else
+    {
+        text << "GPU --\n";
+    }
 
-    glDeleteVertexArrays(1, &lightVAO);
-    glDeleteBuffers(1, &VBO);
+    text << "DRAWS " << renderStats.drawCalls << "  TRIANGLES " << renderStats.triangles << "\n";
+    text << "PROGRAMS " << renderStats.programBinds << "  VAOS " << renderStats.vertexArrayBinds << "\n";
+    text << "TEXTURES " << renderStats.textureBinds << "  UNIFORMS " << renderStats.uniformUpdates << "\n";
+    // the traffic is stepped on the simulation thread, its time isn't part of the frame's above
+    text << "TRAFFIC " << packet.carsCount << " CARS  " << packet.carInstances.size() << " DRAWN  " << packet.trafficMilliseconds << " MS\n";
+    text << "WORLD " << worldStreamer->GetResidentCount() << "/" << worldStreamer->GetChunkCount() << " CHUNKS  "
+        << worldStreamer->GetCpuBytes() / 1048576.0f << " MB CPU  " << worldStreamer->GetGpuBytes() / 1048576.0f << " MB GPU";
 
-    // terminate GLFW's resources
-    glfwTerminate();
-    return 0;
+    overlay.AddText(16.0f, 16.0f, text.str());
+    overlay.Draw(screenWidth, screenHeight);
 }
 
 void processInput(GLFWwindow* window)
@@ -486,77 +1159,55 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (freeCameraActive)
-    {
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            activeCamera->ProcessKeyboard(FORWARD, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            activeCamera->ProcessKeyboard(BACKWARD, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            activeCamera->ProcessKeyboard(LEFT, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            activeCamera->ProcessKeyboard(RIGHT, deltaTime);
-    }
+    // the benchmark script drives everything else
+    if (benchmark != NULL)
+        return;
+
+    // movement and the reflectors are applied by the simulation at its own rate
+    bool freeCameraActive = userInput.camera == FREE_CAMERA;
+    userInput.simulation.isMovingForward = freeCameraActive && glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    userInput.simulation.isMovingBackward = freeCameraActive && glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    userInput.simulation.isMovingLeft = freeCameraActive && glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    userInput.simulation.isMovingRight = freeCameraActive && glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
 
     if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
-    {
-        activeCamera = stationaryCamera;
-        freeCameraActive = false;
-    }
+        userInput.camera = STATIONARY_CAMERA;
     if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
-    {
-        activeCamera = followingCamera;
-        freeCameraActive = false;
-    }
+        userInput.camera = FOLLOWING_CAMERA;
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
-    {
-        activeCamera = fppCamera;
-        freeCameraActive = false;
-    }
+        userInput.camera = FPP_CAMERA;
     if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
     {
-        activeCamera = freeCamera;
-        freeCameraActive = true;
+        userInput.camera = FREE_CAMERA;
         firstMouse = true;
     }
 
     if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS)
-        shaderProgram = FlatShaderProgram;
+        userInput.shading = FLAT_SHADING;
     if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
-        shaderProgram = GouraudShaderProgram;
+        userInput.shading = GOURAUD_SHADING;
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
-        shaderProgram = PhongShaderProgram;
+        userInput.shading = PHONG_SHADING;
 
+    userInput.simulation.reflectorTurn = 0;
     if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
-    {
-        if (deltaRefPos < 0.5f)
-            deltaRefPos += 0.005f;
-    }
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
-        deltaRefPos = 0.0f;
+        userInput.simulation.reflectorTurn++;
     if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
-    {
-        if (deltaRefPos > -0.5f)
-            deltaRefPos -= 0.005f;
-    }
+        userInput.simulation.reflectorTurn--;
+    userInput.simulation.isReflectorReset = glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    if (benchmark != NULL)
+        return;
+
     if (key == GLFW_KEY_N && action == GLFW_PRESS)
-    {
-        if (isDay == 1)
-            isDay = 0;
-        else
-            isDay = 1;
-    }
+        userInput.isDay = !userInput.isDay;
     if (key == GLFW_KEY_M && action == GLFW_PRESS)
-    {
-        if (isFogEnabled == 0)
-            isFogEnabled = 1;
-        else
-            isFogEnabled = 0;
-    }
+        userInput.isFogEnabled = !userInput.isFogEnabled;
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+        isStatsOverlayVisible = !isStatsOverlayVisible;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -566,7 +1217,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
-    if (!freeCameraActive)
+    if (userInput.camera != FREE_CAMERA || benchmark != NULL)
         return;
 
     float xpos = static_cast<float>(xposIn);
@@ -585,10 +1236,15 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
-    activeCamera->ProcessMouseMovement(xoffset, yoffset);
+    // the simulation thread turns the camera by everything that was summed up since its last frame
+    userInput.mouseOffsetX += xoffset;
+    userInput.mouseOffsetY += yoffset;
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    activeCamera->ProcessMouseScroll(static_cast<float>(yoffset));
+    if (benchmark != NULL)
+        return;
+
+    userInput.scrollOffset += static_cast<float>(yoffset);
 }